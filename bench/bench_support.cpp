@@ -0,0 +1,82 @@
+// Shared benchmark plumbing
+// Copyright (C) 2025 enXov
+// License: GPLv3
+
+#include "bench_support.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+double now_us() {
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p * (values.size() - 1))];
+}
+
+BenchArgs& BenchArgs::option(const char* name, const char* metavar, int& value, int min) {
+    options_.push_back({name, metavar, &value, nullptr, nullptr, double(min)});
+    return *this;
+}
+
+BenchArgs& BenchArgs::option(const char* name, const char* metavar, double& value, double min) {
+    options_.push_back({name, metavar, nullptr, &value, nullptr, min});
+    return *this;
+}
+
+BenchArgs& BenchArgs::flag(const char* name, bool& value) {
+    options_.push_back({name, nullptr, nullptr, nullptr, &value, 0});
+    return *this;
+}
+
+bool BenchArgs::parse(int argc, char* argv[]) const {
+    for (int i = 1; i < argc; ++i) {
+        auto option = std::find_if(options_.begin(), options_.end(),
+                                   [&](const Option& o) { return std::strcmp(o.name, argv[i]) == 0; });
+        if (option != options_.end() && option->flag_value) {
+            *option->flag_value = true;
+        } else if (option != options_.end() && i + 1 < argc) {
+            const char* text = argv[++i];
+            if (option->int_value) {
+                *option->int_value = std::max(static_cast<int>(option->min), std::atoi(text));
+            } else {
+                *option->double_value = std::max(option->min, std::atof(text));
+            }
+        } else {
+            std::string usage;
+            for (const auto& o : options_) {
+                usage += std::string(" [") + o.name + (o.metavar ? std::string(" ") + o.metavar : "") + "]";
+            }
+            std::fprintf(stderr, "usage: %s%s\n", argv[0], usage.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+ScratchDir::~ScratchDir() {
+    if (!keep_) {
+        remove_tree(path_);
+    }
+}
+
+std::string ScratchDir::host(const std::string& name, const SyntheticHostOptions& options) const {
+    std::string root = path_ + "/" + name;
+    build_synthetic_host(root, options);
+    return root;
+}
+
+std::string ScratchDir::host(const std::string& name, int cards) const {
+    SyntheticHostOptions options;
+    options.cards = cards;
+    return host(name, options);
+}
@@ -0,0 +1,104 @@
+// Shared benchmark plumbing
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Every benchmark takes a few numeric options, builds synthetic hosts in
+// a scratch directory and times a loop after one warm-up call. These are
+// those pieces, so each benchmark only holds what it measures.
+
+#pragma once
+
+#include "io_counters.h"
+#include "synthetic_host.h"
+
+#include <string>
+#include <vector>
+
+// Monotonic clock in microseconds, for differences only
+double now_us();
+
+// Value at fraction p (0 to 1) of `values`, which are sorted in place
+double percentile(std::vector<double>& values, double p);
+
+// Make `value` look read and all memory look written, so a timed call
+// whose inputs never change is not hoisted out of the loop
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Microseconds per call of fn(): one untimed call first to warm the dentry
+// cache and size reusable buffers, then `reps` timed calls
+template <typename Fn>
+double time_per_call_us(int reps, Fn&& fn) {
+    fn();
+    double t0 = now_us();
+    for (int r = 0; r < reps; ++r) {
+        fn();
+    }
+    return (now_us() - t0) / reps;
+}
+
+// Time and I/O of `reps` calls of fn(), after the same warm-up call. Only
+// for benchmarks, which link gpu_io_counters.
+struct Measurement {
+    double us;       // Wall time per call
+    IoCounters io;   // Summed over the timed calls
+    int reps;
+
+    double per_call(uint64_t count) const { return double(count) / reps; }
+};
+
+template <typename Fn>
+Measurement measure(int reps, Fn&& fn) {
+    fn();
+    io_counters_reset();
+    double t0 = now_us();
+    for (int r = 0; r < reps; ++r) {
+        fn();
+    }
+    double us = (now_us() - t0) / reps;
+    return {us, io_counters_read(), reps};
+}
+
+// "--name VALUE" options and bare flags. parse() prints the usage line
+// built from the declarations and returns false on anything else.
+class BenchArgs {
+public:
+    BenchArgs& option(const char* name, const char* metavar, int& value, int min = 1);
+    BenchArgs& option(const char* name, const char* metavar, double& value, double min);
+    BenchArgs& flag(const char* name, bool& value);
+    bool parse(int argc, char* argv[]) const;
+
+private:
+    struct Option {
+        const char* name;
+        const char* metavar;   // Null for flags
+        int* int_value;
+        double* double_value;
+        bool* flag_value;
+        double min;
+    };
+    std::vector<Option> options_;
+};
+
+// A scratch directory under $TMPDIR, removed with everything in it when
+// this goes out of scope unless keep() was called
+class ScratchDir {
+public:
+    explicit ScratchDir(const char* tag) : path_(make_scratch_dir(tag)) {}
+    ~ScratchDir();
+    ScratchDir(const ScratchDir&) = delete;
+    ScratchDir& operator=(const ScratchDir&) = delete;
+
+    const std::string& path() const { return path_; }
+    void keep() { keep_ = true; }
+
+    // Build a synthetic host in `name` below the directory; returns its root
+    std::string host(const std::string& name, const SyntheticHostOptions& options) const;
+    std::string host(const std::string& name, int cards) const;
+
+private:
+    std::string path_;
+    bool keep_ = false;
+};
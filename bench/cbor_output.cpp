@@ -0,0 +1,164 @@
+// Binary output benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Encodes a synthetic host with --format=cbor and decodes it again with
+// tools/cbor_decode.h:
+//   - bytes of the inventory and of one watch sample as plain text, JSON
+//     and CBOR (a CBOR sample leaves names to the one "channels" record),
+//     and of the inventory of as many identical cards (one model per host);
+//   - encode and decode time and heap allocations per record, both of
+//     which should allocate nothing once the buffer has grown.
+// tests/cbor_roundtrip.cpp checks that every decoded field matches.
+//
+// Usage: gpu_cbor_output [--cards N] [--reps R]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+#include "tools/cbor_decode.h"
+
+#include <cstdio>
+
+namespace {
+
+namespace wire = whatsmy_gpu_cbor;
+
+// Bytes print_telemetry() writes for one tick
+size_t text_sample_bytes(const std::vector<GPUInfo>& gpus, const TelemetrySampler& sampler,
+                         const TelemetrySample& sample) {
+    TextBuffer text;
+    print_telemetry(text, gpus, sampler.reads(), sample, 1.5, 0);
+    return text.view().size();
+}
+
+// Bytes of `gpus` as the text `all` view, JSON and CBOR
+void report_inventory(const char* label, const std::vector<GPUInfo>& gpus) {
+    TextBuffer text, json, cbor;
+    print_header(text, "All GPUs");
+    for (const auto& gpu : gpus) {
+        display_gpu(text, gpu, true);
+    }
+    write_gpus_json(json, gpus);
+    write_gpus_cbor(cbor, gpus);
+    std::printf("%-10s %8zu %8zu %8zu %8.1fx\n", label, text.view().size(), json.view().size(), cbor.view().size(),
+                double(text.view().size()) / cbor.view().size());
+}
+
+// Decode an inventory record; returns the number of GPUs, 0 if malformed
+size_t decode_inventory(std::string_view data) {
+    wire::CborReader reader(data.data(), data.size());
+    wire::CborRecordHead head;
+    size_t decoded = 0;
+    if (!wire::read_record_head(reader, head) || head.type != wire::kInventoryRecord) {
+        return 0;
+    }
+    for (uint64_t f = 0; f < head.fields; ++f) {
+        uint64_t key, count = 0, pairs;
+        if (!reader.read_key(key)) {
+            return 0;
+        }
+        if (key != wire::kGpus) {
+            reader.skip();
+            continue;
+        }
+        reader.read_container(wire::CborItem::Array, count);
+        wire::CborGpu gpu;
+        for (uint64_t i = 0; i < count; ++i) {
+            if (!reader.read_container(wire::CborItem::Map, pairs) || !wire::read_gpu(reader, pairs, gpu)) {
+                return 0;
+            }
+            ++decoded;
+        }
+    }
+    return reader.at_end() ? decoded : 0;
+}
+
+// Decode a sample record; returns the number of values, 0 if malformed
+size_t decode_sample(std::string_view data) {
+    wire::CborReader reader(data.data(), data.size());
+    wire::CborRecordHead head;
+    wire::CborSample decoded;
+    wire::CborReader values(nullptr, 0);
+    if (!wire::read_record_head(reader, head) || head.type != wire::kSampleRecord ||
+        !wire::read_sample(reader, head.fields, decoded, values)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < decoded.count; ++i) {
+        int64_t value;
+        if (!values.read_int(value, kTelemetryMissing)) {
+            return 0;
+        }
+    }
+    return decoded.count;
+}
+
+void report_cost(const char* label, const Measurement& m) {
+    std::printf("%-10s %10.2f %10.2f\n", label, m.per_call(m.io.allocs), m.us);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int cards = 64, reps = 5000;
+    if (!BenchArgs().option("--cards", "N", cards).option("--reps", "R", reps).parse(argc, argv)) {
+        return 2;
+    }
+    
+    ScratchDir scratch("cbor");
+    const std::string root = scratch.host("host", cards);
+    std::vector<GPUInfo> gpus = detect_gpus_linux(posix_sysfs(), root, 1);
+    TelemetrySampler sampler(root);
+    sampler.discover(gpus);
+    TelemetrySample sample{};
+    sampler.sample();
+    for (const auto& read : sampler.reads()) {
+        if (sample.count < kTelemetrySampleValues) {
+            sample.values[sample.count++] = *read.value;
+        }
+    }
+    sample.tick = 42;
+    
+    // Sizes against what a pipe gets from the other formats
+    Color::init(false, false);
+    output_format = OutputFormat::Json;
+    std::vector<GPUInfo> uniform(gpus.size(), gpus[0]);
+    for (size_t i = 0; i < uniform.size(); ++i) {
+        uniform[i].index = static_cast<int>(i);
+        uniform[i].is_active = i == 0;
+        uniform[i].node = "card" + std::to_string(i);
+    }
+    TextBuffer inventory, record, sample_json, sample_cbor;
+    write_gpus_cbor(inventory, gpus);
+    write_sample_json(sample_json, sampler.reads(), sample, 1.5, 0);
+    write_sample_cbor(sample_cbor, sample, 1.5, 0);
+    const size_t sample_text = text_sample_bytes(gpus, sampler, sample);
+    
+    // Encoding and decoding
+    Measurement encode_inventory = measure(reps, [&] {
+        record.clear();
+        write_gpus_cbor(record, gpus);
+    });
+    Measurement encode_sample = measure(reps, [&] {
+        record.clear();
+        write_sample_cbor(record, sample, 1.5, 0);
+    });
+    size_t gpus_decoded = 0, values_decoded = 0;
+    Measurement decode_gpus = measure(reps, [&] { gpus_decoded = decode_inventory(inventory.view()); });
+    Measurement decode_values = measure(reps, [&] { values_decoded = decode_sample(sample_cbor.view()); });
+    
+    std::printf("# %zu cards, %u sensor values per sample, %d runs each\n", gpus.size(), sample.count, reps);
+    std::printf("%-10s %8s %8s %8s %8s\n", "record", "text", "json", "cbor", "text/cbor");
+    report_inventory("inventory", gpus);
+    report_inventory("uniform", uniform);
+    std::printf("%-10s %8zu %8zu %8zu %8.1fx\n", "sample", sample_text, sample_json.view().size(),
+                sample_cbor.view().size(), double(sample_text) / sample_cbor.view().size());
+    std::printf("%-10s %10s %10s\n", "", "allocs", "us");
+    report_cost("encode inv", encode_inventory);
+    report_cost("encode smp", encode_sample);
+    report_cost("decode inv", decode_gpus);
+    report_cost("decode smp", decode_values);
+    std::printf("# decoded %zu gpus, %zu values\n", gpus_decoded, values_decoded);
+    return 0;
+}
@@ -0,0 +1,58 @@
+// Inventory daemon throughput benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Runs an InventoryServer for a synthetic host on a background thread and
+// hammers it with query_daemon() from the main thread, one connection per
+// query like the short-lived processes it exists for.
+//
+// Usage: gpu_daemon_qps [--cards N] [--queries Q]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+int main(int argc, char* argv[]) {
+    int cards = 8, queries = 20000;
+    if (!BenchArgs().option("--cards", "N", cards).option("--queries", "Q", queries).parse(argc, argv)) {
+        return 2;
+    }
+    unsetenv("WHATSMY_GPU_NO_DAEMON");
+
+    ScratchDir scratch("daemon");
+    ResidentInventory inventory(scratch.host("host", cards));
+    inventory.scan();
+    InventoryServer server(inventory, nullptr);
+    std::string error;
+    const std::string socket_path = scratch.path() + "/gpu.sock";
+    if (!server.listen(socket_path, error)) {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+    std::thread serving([&] { server.run(); });
+
+    std::vector<double> latencies;
+    latencies.reserve(queries);
+    std::vector<GPUInfo> gpus;
+    int failed = 0;
+    double start = now_us();
+    for (int i = 0; i < queries; ++i) {
+        double t0 = now_us();
+        gpus.clear();
+        failed += !query_daemon(gpus, socket_path);
+        latencies.push_back(now_us() - t0);
+    }
+    double seconds = (now_us() - start) / 1e6;
+
+    server.stop();
+    serving.join();
+
+    std::printf("# %d cards, %d queries, one connection each (%d failed)\n", cards, queries, failed);
+    std::printf("queries/s: %.0f\n", queries / seconds);
+    std::printf("latency us: p50 %.1f  p99 %.1f  max %.1f\n", percentile(latencies, 0.5),
+                percentile(latencies, 0.99), percentile(latencies, 1.0));
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Detection scaling benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Generates synthetic hosts with N = 1, 2, 4, ... cards and reports the
+// cost of one full detect_gpus_linux() pass per card: wall time, libc I/O
+// calls (see io_counters.h) and heap allocations. Each size is measured
+// with serial probing, with the parallel worker pool, served from a warm
+// inventory cache, and for the default single-GPU view (enumerate all
+// cards, populate only the active one).
+//
+// Usage: gpu_detect_scaling [--max N] [--reps R] [--threads T] [--keep]
+
+// The plugin is a single translation unit; compiling it in directly lets the
+// benchmark drive the detection functions without going through plugin_run.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+namespace {
+
+struct Sample {
+    double wall_us;
+    IoCounters counters;
+};
+
+enum class Mode { Serial, Parallel, Cached, Single };
+
+const char* mode_name(Mode mode) {
+    switch (mode) {
+        case Mode::Serial: return "serial";
+        case Mode::Parallel: return "parallel";
+        case Mode::Cached: return "cached";
+        case Mode::Single: return "single";
+    }
+    return "?";
+}
+
+// Enumerate every card but populate only the active one, bypassing the cache
+std::vector<GPUInfo> detect_active_gpu(const std::string& root) {
+    SysfsDir root_dir(root);
+    SysfsDir drm_dir(root_dir, "sys/class/drm", true);
+    std::vector<GPUInfo> gpus = enumerate_gpus_linux(list_drm_entries(drm_dir));
+    if (!gpus.empty()) {
+        populate_gpus_linux(root_dir, drm_dir, DriverRegistry::for_root(root), {&gpus[0]}, 1);
+    }
+    return gpus;
+}
+
+Sample run_once(const std::string& root, Mode mode, unsigned threads) {
+    io_counters_reset();
+    double t0 = now_us();
+    switch (mode) {
+        case Mode::Serial: detect_gpus_linux(root, 1); break;
+        case Mode::Parallel: detect_gpus_linux(root, threads); break;
+        case Mode::Cached: detect_gpus_linux_cached(root); break;
+        case Mode::Single: detect_active_gpu(root); break;
+    }
+    return {now_us() - t0, io_counters_read()};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int max_cards = 4096, reps = 5;
+    int threads = static_cast<int>(probe_workers());
+    bool keep = false;
+    if (!BenchArgs()
+             .option("--max", "N", max_cards)
+             .option("--reps", "R", reps)
+             .option("--threads", "T", threads)
+             .flag("--keep", keep)
+             .parse(argc, argv)) {
+        return 2;
+    }
+
+    ScratchDir scratch("detect-scaling");
+    if (keep) {
+        scratch.keep();
+    }
+    setenv("XDG_CACHE_HOME", (scratch.path() + "/cache").c_str(), 1);
+    unsetenv("WHATSMY_GPU_NO_CACHE");
+    std::printf("# synthetic hosts under %s, median of %d runs\n", scratch.path().c_str(), reps);
+    std::printf("# parallel mode uses up to %d workers\n", threads);
+    std::printf("%6s %8s %12s %10s %9s %7s %7s %7s %7s %9s %9s\n",
+                "cards", "mode", "wall_us", "us/card", "io/card", "open", "read", "stat", "dir",
+                "allocs/c", "bytes/c");
+
+    for (int cards = 1; cards <= max_cards; cards *= 2) {
+        const std::string root = scratch.host("n" + std::to_string(cards), cards);
+
+        std::vector<Mode> modes = {Mode::Serial};
+        if (threads > 1) {
+            modes.push_back(Mode::Parallel);
+        }
+        modes.push_back(Mode::Cached);
+        modes.push_back(Mode::Single);
+        for (Mode mode : modes) {
+            run_once(root, mode, threads); // warm the dentry cache
+            std::vector<Sample> samples;
+            for (int r = 0; r < reps; ++r) {
+                samples.push_back(run_once(root, mode, threads));
+            }
+            std::sort(samples.begin(), samples.end(),
+                      [](const Sample& a, const Sample& b) { return a.wall_us < b.wall_us; });
+            const Sample& median = samples[samples.size() / 2];
+
+            const double n = cards;
+            const IoCounters& c = median.counters;
+            std::printf("%6d %8s %12.1f %10.2f %9.2f %7.2f %7.2f %7.2f %7.2f %9.2f %9.1f\n",
+                        cards, mode_name(mode), median.wall_us,
+                        median.wall_us / n, c.syscalls() / n, c.opens / n, c.reads / n,
+                        c.stats / n, c.dir_ops / n, c.allocs / n, c.alloc_bytes / n);
+            std::fflush(stdout);
+        }
+
+        if (!keep) {
+            remove_tree(root);
+        }
+    }
+    return 0;
+}
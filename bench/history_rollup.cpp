@@ -0,0 +1,83 @@
+// Telemetry history benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Feeds a day of 1 Hz samples per series into TelemetryHistory, then times
+// window summaries against a brute-force scan of every sample. Reports the
+// fixed memory the configuration implies. tests/history_rollup.cpp checks
+// that the summaries are exact.
+//
+// Usage: gpu_history_rollup [--series N] [--hours H]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+#include <random>
+
+int main(int argc, char* argv[]) {
+    int series_arg = 96, hours = 25;
+    if (!BenchArgs().option("--series", "N", series_arg).option("--hours", "H", hours).parse(argc, argv)) {
+        return 2;
+    }
+    const size_t series = static_cast<size_t>(series_arg);
+    
+    HistoryConfig config;
+    TelemetryHistory history(config, series);
+    std::printf("# %zu series, %d h at 1 Hz; fixed memory %.1f KiB (%zu B per series)\n", series, hours,
+                TelemetryHistory::memory_bytes(config, series) / 1024.0,
+                TelemetryHistory::memory_bytes(config, 1));
+    
+    // Series 0 is also kept raw for the brute-force scan
+    const int64_t start = 1700000000 - 1700000000 % 3600;
+    const int64_t seconds = int64_t(hours) * 3600;
+    std::vector<int64_t> raw;
+    raw.reserve(seconds);
+    std::mt19937_64 rng(1);
+    double t0 = now_us();
+    for (int64_t t = 0; t < seconds; ++t) {
+        for (size_t s = 0; s < series; ++s) {
+            int64_t value = 200000000 + static_cast<int64_t>(rng() % 100000000);
+            history.record(s, start + t, value);
+            if (s == 0) {
+                raw.push_back(value);
+            }
+        }
+    }
+    double per_sample = (now_us() - t0) * 1000 / (double(seconds) * series);
+    std::printf("record:      %6.1f ns/sample\n", per_sample);
+    
+    const int64_t now = start + seconds - 1;
+    static const struct { const char* label; int64_t seconds; } windows[] = {
+        {"last 5 min", 300}, {"last 1 h", 3600}, {"last 24 h", 86400}};
+    for (const auto& window : windows) {
+        // Windows longer than --hours cover what was recorded
+        const int64_t from = std::max(start, now - window.seconds + 1);
+        HistoryBucket summary{};
+        double query = time_per_call_us(1000, [&] {
+            history.summarize(0, from, now, summary);
+            keep(summary);
+        });
+        
+        int64_t lo, hi, sum, count;
+        double scan = time_per_call_us(1, [&] {
+            lo = INT64_MAX;
+            hi = INT64_MIN;
+            sum = count = 0;
+            for (int64_t t = from; t <= now; ++t) {
+                int64_t value = raw[t - start];
+                lo = std::min(lo, value);
+                hi = std::max(hi, value);
+                sum += value;
+                ++count;
+            }
+        });
+        std::printf("%-11s  tier %zu  query %8.0f ns  scan %10.0f ns  (%lld samples, %lld..%lld mean %lld)\n",
+                    window.label, history.tier_for(0, from), query * 1000, scan * 1000,
+                    static_cast<long long>(count), static_cast<long long>(lo), static_cast<long long>(hi),
+                    static_cast<long long>(sum / count));
+    }
+    return 0;
+}
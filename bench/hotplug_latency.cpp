@@ -0,0 +1,66 @@
+// Resident inventory hotplug benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Seeds a ResidentInventory from a synthetic host, then repeatedly detaches
+// and re-attaches one card (renaming its sysfs entry away and back) and
+// feeds the matching drm uevents through apply(). Reports how long each
+// event takes to become visible and what a snapshot() query costs.
+// tests/hotplug_replay.cpp checks what apply() reports.
+//
+// Usage: gpu_hotplug_latency [--cards N] [--events E]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+int main(int argc, char* argv[]) {
+    int cards = 8, events = 2000;
+    if (!BenchArgs().option("--cards", "N", cards, 2).option("--events", "E", events, 2).parse(argc, argv)) {
+        return 2;
+    }
+
+    ScratchDir scratch("hotplug");
+    const std::string root = scratch.host("host", cards);
+    ResidentInventory inventory(root);
+    inventory.scan();
+
+    // The last card plays the eGPU that comes and goes
+    const std::string node = "card" + std::to_string(cards - 1);
+    const std::string drm = root + "/sys/class/drm/";
+    UeventMessage attach{"add", "/devices/pci0000:00/0000:00:1c.0/0000:09:00.0/drm/" + node, "drm", "dri/" + node};
+    UeventMessage detach = attach;
+    detach.action = "remove";
+
+    std::vector<double> attach_us, detach_us;
+    uint64_t attach_io = 0;
+    for (int i = 0; i < events / 2; ++i) {
+        std::rename((drm + node).c_str(), (drm + "parked").c_str());
+        double t0 = now_us();
+        inventory.apply(detach);
+        detach_us.push_back(now_us() - t0);
+        std::rename((drm + "parked").c_str(), (drm + node).c_str());
+
+        io_counters_reset();
+        t0 = now_us();
+        inventory.apply(attach);
+        attach_us.push_back(now_us() - t0);
+        attach_io += io_counters_read().syscalls();
+    }
+
+    size_t seen = 0;
+    double query_us = time_per_call_us(1000000, [&] { seen = inventory.snapshot()->size(); });
+
+    std::printf("# %d cards, %d hotplug events\n", cards, events);
+    std::printf("%-10s %10s %10s %10s\n", "event", "p50_us", "p99_us", "max_us");
+    std::printf("%-10s %10.2f %10.2f %10.2f\n", "attach", percentile(attach_us, 0.5),
+                percentile(attach_us, 0.99), percentile(attach_us, 1.0));
+    std::printf("%-10s %10.2f %10.2f %10.2f\n", "detach", percentile(detach_us, 0.5),
+                percentile(detach_us, 0.99), percentile(detach_us, 1.0));
+    std::printf("attach libc I/O calls per event: %.1f\n", attach_io / (events / 2.0));
+    std::printf("snapshot() query: %.1f ns (%zu cards)\n", query_us * 1000, seen);
+    return 0;
+}
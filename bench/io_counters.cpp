@@ -0,0 +1,316 @@
+// I/O and allocation counters for the benchmarks
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Deliberately avoids <sys/stat.h>, <dirent.h> and <stdio.h> so the
+// interposers below can be declared without fighting glibc's prototypes.
+
+#include "io_counters.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdlib>
+#include <initializer_list>
+#include <new>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+namespace {
+
+std::atomic<uint64_t> g_opens{0};
+std::atomic<uint64_t> g_reads{0};
+std::atomic<uint64_t> g_stats{0};
+std::atomic<uint64_t> g_closes{0};
+std::atomic<uint64_t> g_dir_ops{0};
+std::atomic<uint64_t> g_uring{0};
+std::atomic<uint64_t> g_bytes_read{0};
+std::atomic<uint64_t> g_allocs{0};
+std::atomic<uint64_t> g_alloc_bytes{0};
+
+void bump(std::atomic<uint64_t>& counter, uint64_t by = 1) {
+    counter.fetch_add(by, std::memory_order_relaxed);
+}
+
+// Resolve the next definition of a libc symbol once
+template <typename Fn>
+Fn next_symbol(const char* name) {
+    return reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+}
+
+// open/openat only carry a mode argument when they may create a file
+bool has_mode(int flags) {
+    return (flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE;
+}
+
+void count_read(ssize_t result) {
+    bump(g_reads);
+    if (result > 0) {
+        bump(g_bytes_read, static_cast<uint64_t>(result));
+    }
+}
+
+} // namespace
+
+void io_counters_reset() {
+    for (auto* counter : {&g_opens, &g_reads, &g_stats, &g_closes, &g_dir_ops, &g_uring,
+                          &g_bytes_read, &g_allocs, &g_alloc_bytes}) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+}
+
+IoCounters io_counters_read() {
+    IoCounters c;
+    c.opens = g_opens.load(std::memory_order_relaxed);
+    c.reads = g_reads.load(std::memory_order_relaxed);
+    c.stats = g_stats.load(std::memory_order_relaxed);
+    c.closes = g_closes.load(std::memory_order_relaxed);
+    c.dir_ops = g_dir_ops.load(std::memory_order_relaxed);
+    c.uring = g_uring.load(std::memory_order_relaxed);
+    c.bytes_read = g_bytes_read.load(std::memory_order_relaxed);
+    c.allocs = g_allocs.load(std::memory_order_relaxed);
+    c.alloc_bytes = g_alloc_bytes.load(std::memory_order_relaxed);
+    return c;
+}
+
+struct stat;
+struct statx;
+struct __dirstream;
+struct dirent;
+struct dirent64;
+struct _IO_FILE;
+
+extern "C" {
+
+// Opening files
+#define WHATSMY_INTERPOSE_OPEN(fn)                                                \
+    int fn(const char* path, int flags, ...) {                                    \
+        static auto real = next_symbol<int (*)(const char*, int, ...)>(#fn);      \
+        mode_t mode = 0;                                                          \
+        if (has_mode(flags)) {                                                    \
+            va_list ap;                                                           \
+            va_start(ap, flags);                                                  \
+            mode = va_arg(ap, mode_t);                                            \
+            va_end(ap);                                                           \
+        }                                                                         \
+        bump(g_opens);                                                            \
+        return real(path, flags, mode);                                           \
+    }
+WHATSMY_INTERPOSE_OPEN(open)
+WHATSMY_INTERPOSE_OPEN(open64)
+#undef WHATSMY_INTERPOSE_OPEN
+
+#define WHATSMY_INTERPOSE_OPENAT(fn)                                              \
+    int fn(int dirfd, const char* path, int flags, ...) {                         \
+        static auto real = next_symbol<int (*)(int, const char*, int, ...)>(#fn); \
+        mode_t mode = 0;                                                          \
+        if (has_mode(flags)) {                                                    \
+            va_list ap;                                                           \
+            va_start(ap, flags);                                                  \
+            mode = va_arg(ap, mode_t);                                            \
+            va_end(ap);                                                           \
+        }                                                                         \
+        bump(g_opens);                                                            \
+        return real(dirfd, path, flags, mode);                                    \
+    }
+WHATSMY_INTERPOSE_OPENAT(openat)
+WHATSMY_INTERPOSE_OPENAT(openat64)
+#undef WHATSMY_INTERPOSE_OPENAT
+
+_IO_FILE* fopen(const char* path, const char* mode) {
+    static auto real = next_symbol<_IO_FILE* (*)(const char*, const char*)>("fopen");
+    bump(g_opens);
+    return real(path, mode);
+}
+
+_IO_FILE* fopen64(const char* path, const char* mode) {
+    static auto real = next_symbol<_IO_FILE* (*)(const char*, const char*)>("fopen64");
+    bump(g_opens);
+    return real(path, mode);
+}
+
+// Reading
+ssize_t read(int fd, void* buf, size_t count) {
+    static auto real = next_symbol<ssize_t (*)(int, void*, size_t)>("read");
+    ssize_t result = real(fd, buf, count);
+    count_read(result);
+    return result;
+}
+
+ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+    static auto real = next_symbol<ssize_t (*)(int, void*, size_t, off_t)>("pread");
+    ssize_t result = real(fd, buf, count, offset);
+    count_read(result);
+    return result;
+}
+
+ssize_t pread64(int fd, void* buf, size_t count, off_t offset) {
+    static auto real = next_symbol<ssize_t (*)(int, void*, size_t, off_t)>("pread64");
+    ssize_t result = real(fd, buf, count, offset);
+    count_read(result);
+    return result;
+}
+
+ssize_t readlink(const char* path, char* buf, size_t size) {
+    static auto real = next_symbol<ssize_t (*)(const char*, char*, size_t)>("readlink");
+    bump(g_stats);
+    return real(path, buf, size);
+}
+
+ssize_t readlinkat(int dirfd, const char* path, char* buf, size_t size) {
+    static auto real = next_symbol<ssize_t (*)(int, const char*, char*, size_t)>("readlinkat");
+    bump(g_stats);
+    return real(dirfd, path, buf, size);
+}
+
+int close(int fd) {
+    static auto real = next_symbol<int (*)(int)>("close");
+    bump(g_closes);
+    return real(fd);
+}
+
+int fclose(_IO_FILE* file) {
+    static auto real = next_symbol<int (*)(_IO_FILE*)>("fclose");
+    bump(g_closes);
+    return real(file);
+}
+
+// Metadata
+#define WHATSMY_INTERPOSE_STAT(fn)                                                \
+    int fn(const char* path, struct stat* buf) {                                  \
+        static auto real = next_symbol<int (*)(const char*, struct stat*)>(#fn);  \
+        bump(g_stats);                                                            \
+        return real(path, buf);                                                   \
+    }
+WHATSMY_INTERPOSE_STAT(stat)
+WHATSMY_INTERPOSE_STAT(stat64)
+WHATSMY_INTERPOSE_STAT(lstat)
+WHATSMY_INTERPOSE_STAT(lstat64)
+#undef WHATSMY_INTERPOSE_STAT
+
+int fstat(int fd, struct stat* buf) {
+    static auto real = next_symbol<int (*)(int, struct stat*)>("fstat");
+    bump(g_stats);
+    return real(fd, buf);
+}
+
+int fstat64(int fd, struct stat* buf) {
+    static auto real = next_symbol<int (*)(int, struct stat*)>("fstat64");
+    bump(g_stats);
+    return real(fd, buf);
+}
+
+int fstatat(int dirfd, const char* path, struct stat* buf, int flags) {
+    static auto real = next_symbol<int (*)(int, const char*, struct stat*, int)>("fstatat");
+    bump(g_stats);
+    return real(dirfd, path, buf, flags);
+}
+
+int fstatat64(int dirfd, const char* path, struct stat* buf, int flags) {
+    static auto real = next_symbol<int (*)(int, const char*, struct stat*, int)>("fstatat64");
+    bump(g_stats);
+    return real(dirfd, path, buf, flags);
+}
+
+int statx(int dirfd, const char* path, int flags, unsigned int mask, struct statx* buf) {
+    static auto real = next_symbol<int (*)(int, const char*, int, unsigned int, struct statx*)>("statx");
+    bump(g_stats);
+    return real(dirfd, path, flags, mask, buf);
+}
+
+int access(const char* path, int mode) {
+    static auto real = next_symbol<int (*)(const char*, int)>("access");
+    bump(g_stats);
+    return real(path, mode);
+}
+
+// Directory iteration
+__dirstream* opendir(const char* path) {
+    static auto real = next_symbol<__dirstream* (*)(const char*)>("opendir");
+    bump(g_opens);
+    return real(path);
+}
+
+__dirstream* fdopendir(int fd) {
+    static auto real = next_symbol<__dirstream* (*)(int)>("fdopendir");
+    bump(g_dir_ops);
+    return real(fd);
+}
+
+dirent* readdir(__dirstream* dir) {
+    static auto real = next_symbol<dirent* (*)(__dirstream*)>("readdir");
+    bump(g_dir_ops);
+    return real(dir);
+}
+
+dirent64* readdir64(__dirstream* dir) {
+    static auto real = next_symbol<dirent64* (*)(__dirstream*)>("readdir64");
+    bump(g_dir_ops);
+    return real(dir);
+}
+
+ssize_t getdents64(int fd, void* buf, size_t count) {
+    static auto real = next_symbol<ssize_t (*)(int, void*, size_t)>("getdents64");
+    bump(g_dir_ops);
+    return real(fd, buf, count);
+}
+
+off_t lseek(int fd, off_t offset, int whence) {
+    static auto real = next_symbol<off_t (*)(int, off_t, int)>("lseek");
+    bump(g_dir_ops);
+    return real(fd, offset, whence);
+}
+
+int closedir(__dirstream* dir) {
+    static auto real = next_symbol<int (*)(__dirstream*)>("closedir");
+    bump(g_closes);
+    return real(dir);
+}
+
+// io_uring has no libc wrapper; the plugin reaches it through syscall()
+long syscall(long number, ...) {
+    static auto real = next_symbol<long (*)(long, ...)>("syscall");
+    va_list ap;
+    va_start(ap, number);
+    long args[6];
+    for (long& arg : args) {
+        arg = va_arg(ap, long);
+    }
+    va_end(ap);
+    if (number == SYS_io_uring_setup || number == SYS_io_uring_enter) {
+        bump(g_uring);
+    }
+    return real(number, args[0], args[1], args[2], args[3], args[4], args[5]);
+}
+
+} // extern "C"
+
+// Heap allocations made anywhere in the process
+void* operator new(size_t size) {
+    bump(g_allocs);
+    bump(g_alloc_bytes, size);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    bump(g_allocs);
+    bump(g_alloc_bytes, size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
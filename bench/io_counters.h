@@ -0,0 +1,33 @@
+// I/O and allocation counters for the benchmarks
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// io_counters.cpp interposes the libc entry points that the detection code
+// (and libstdc++ underneath it) reaches for, plus the global operator new.
+// Every interposed call maps to one system call, except readdir, which is
+// counted per call even though glibc batches getdents64 underneath, and
+// syscall(), which counts io_uring_setup/io_uring_enter only.
+
+#pragma once
+
+#include <cstdint>
+
+struct IoCounters {
+    uint64_t opens;
+    uint64_t reads;
+    uint64_t stats;
+    uint64_t closes;
+    uint64_t dir_ops;
+    uint64_t uring;       // io_uring_setup and io_uring_enter calls
+    uint64_t bytes_read;
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+
+    uint64_t syscalls() const { return opens + reads + stats + closes + dir_ops + uring; }
+};
+
+// Zero every counter
+void io_counters_reset();
+
+// Snapshot the counters accumulated since the last reset
+IoCounters io_counters_read();
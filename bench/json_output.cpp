@@ -0,0 +1,86 @@
+// Structured output benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Serializes a synthetic host with the JsonWriter behind --json/--ndjson
+// and reports bytes, heap allocations and time per document for:
+//   - the inventory of `whatsmy gpu all --json`, against the text renderer;
+//   - the same GPUs as --ndjson lines;
+//   - one `watch --json` sample record for every sensor of the host.
+// Allocations should be zero once the reusable buffer has grown.
+//
+// Usage: gpu_json_output [--cards N] [--reps R]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+namespace {
+
+struct Result {
+    size_t bytes;
+    double allocs;
+    double us;
+};
+
+// Render into `out` `reps` times, clearing it in between as flush() does
+template <typename Fn>
+Result measure_render(TextBuffer& out, int reps, Fn render) {
+    size_t bytes = 0;
+    Measurement m = measure(reps, [&] {
+        render();
+        bytes = out.view().size();
+        out.clear();
+    });
+    return {bytes, m.per_call(m.io.allocs), m.us};
+}
+
+void report(const char* label, const Result& result) {
+    std::printf("%-10s %10zu %10.2f %10.2f\n", label, result.bytes, result.allocs, result.us);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int cards = 64, reps = 5000;
+    if (!BenchArgs().option("--cards", "N", cards).option("--reps", "R", reps).parse(argc, argv)) {
+        return 2;
+    }
+    
+    ScratchDir scratch("json");
+    const std::string root = scratch.host("host", cards);
+    std::vector<GPUInfo> gpus = detect_gpus_linux(posix_sysfs(), root, 1);
+    TelemetrySampler sampler(root);
+    sampler.discover(gpus);
+    TelemetrySample sample{};
+    sampler.sample();
+    for (const auto& read : sampler.reads()) {
+        if (sample.count < kTelemetrySampleValues) {
+            sample.values[sample.count++] = *read.value;
+        }
+    }
+    
+    TextBuffer out;
+    Result text = measure_render(out, reps, [&] {
+        print_header(out, "All GPUs");
+        for (const auto& gpu : gpus) {
+            display_gpu(out, gpu, true);
+        }
+    });
+    output_format = OutputFormat::Json;
+    Result json = measure_render(out, reps, [&] { write_gpus_json(out, gpus); });
+    output_format = OutputFormat::Ndjson;
+    Result ndjson = measure_render(out, reps, [&] { write_gpus_json(out, gpus); });
+    Result samples = measure_render(out, reps, [&] { write_sample_json(out, sampler.reads(), sample, 1.5, 0); });
+    
+    std::printf("# %zu cards, %u sensor values per sample, %d renders each\n", gpus.size(), sample.count, reps);
+    std::printf("%-10s %10s %10s %10s\n", "document", "bytes", "allocs", "us");
+    report("text", text);
+    report("json", json);
+    report("ndjson", ndjson);
+    report("sample", samples);
+    return 0;
+}
@@ -0,0 +1,39 @@
+// In-memory backend benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Runs detect_gpus_linux() against MemorySysfs to separate the cost of
+// parsing from the cost of the kernel: the same synthetic host read from
+// disk (PosixSysfs) and from a MemorySysfs copy of it, serial probing.
+// tests/memory_backend.cpp checks what detection reports over both.
+//
+// Usage: gpu_memory_backend [--cards N] [--reps R]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+int main(int argc, char* argv[]) {
+    int cards = 32, reps = 50;
+    if (!BenchArgs().option("--cards", "N", cards).option("--reps", "R", reps).parse(argc, argv)) {
+        return 2;
+    }
+    
+    // One host, two backends
+    ScratchDir scratch("memory-backend");
+    const std::string root = scratch.host("host", cards);
+    MemorySysfs memory;
+    memory.load(root);
+    
+    std::vector<GPUInfo> on_disk, in_memory;
+    double posix_us = time_per_call_us(reps, [&] { on_disk = detect_gpus_linux(posix_sysfs(), root, 1); });
+    double memory_us = time_per_call_us(reps, [&] { in_memory = detect_gpus_linux(memory, "", 1); });
+    std::printf("# %d cards, %zu nodes in memory\n", cards, memory.node_count());
+    std::printf("posix:   %8.1f us/pass  %6.2f us/card\n", posix_us, posix_us / cards);
+    std::printf("memory:  %8.1f us/pass  %6.2f us/card  (parsing and lookups only; %.0f%% of posix)\n",
+                memory_us, memory_us / cards, 100.0 * memory_us / posix_us);
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Runtime pci.ids resolver benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Generates a pci.ids of roughly the size distributions ship (the vendored
+// display subset plus synthetic vendors) and times, for the same file:
+//   - a naive getline/std::map text parse, the cost the index avoids;
+//   - building the binary index and storing it in the cache;
+//   - opening the cached index in a later "process";
+//   - single lookups against the mapped index.
+//
+// Usage: gpu_pciids_lookup [--vendors N] [--lookups L] [--keep]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+#include <random>
+
+namespace {
+
+double elapsed_ms(double since_us) {
+    return (now_us() - since_us) / 1000;
+}
+
+// Vendored subset followed by `vendors` synthetic vendors, each with
+// devices and subsystems. Returns the keys that were written.
+std::vector<uint64_t> write_pci_ids(const std::string& path, int vendors) {
+    std::ifstream subset(PCI_IDS_SUBSET);
+    std::ofstream out(path, std::ios::trunc);
+    out << subset.rdbuf();
+    
+    std::vector<uint64_t> keys;
+    std::mt19937 rng(42);
+    char line[128];
+    for (int v = 0; v < vendors; ++v) {
+        uint16_t vendor = static_cast<uint16_t>(0x2000 + v);
+        std::snprintf(line, sizeof(line), "%04x  Synthetic Semiconductor Corporation %d\n", vendor, v);
+        out << line;
+        keys.push_back(pci_key(vendor, kPciAny, kPciAny, kPciAny));
+        int devices = 4 + static_cast<int>(rng() % 12);
+        for (int d = 0; d < devices; ++d) {
+            uint16_t device = static_cast<uint16_t>(0x1000 + d * 7);
+            std::snprintf(line, sizeof(line), "\t%04x  SY%d%02d Graphics Controller [Series %d Model %d]\n",
+                          device, v, d, v % 9, d);
+            out << line;
+            keys.push_back(pci_key(vendor, device, kPciAny, kPciAny));
+            for (int s = 0; s < static_cast<int>(rng() % 4); ++s) {
+                uint16_t subdevice = static_cast<uint16_t>(0x0100 + s);
+                std::snprintf(line, sizeof(line), "\t\t%04x %04x  Board Partner Edition %d-%d\n", vendor,
+                              subdevice, d, s);
+                out << line;
+                keys.push_back(pci_key(vendor, device, vendor, subdevice));
+            }
+        }
+    }
+    return keys;
+}
+
+// What a straightforward resolver would do on every run
+size_t naive_parse(const std::string& path) {
+    std::ifstream in(path);
+    std::map<uint64_t, std::string> names;
+    std::string line;
+    uint16_t vendor = 0, device = 0;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line.compare(0, 2, "C ") == 0) {
+            break;
+        }
+        uint16_t subvendor, subdevice;
+        if (line.compare(0, 2, "\t\t") == 0 && parse_hex16(line.substr(2), subvendor) &&
+            parse_hex16(line.substr(7), subdevice)) {
+            names[pci_key(vendor, device, subvendor, subdevice)] = line.substr(13);
+        } else if (line[0] == '\t' && parse_hex16(line.substr(1), device)) {
+            names[pci_key(vendor, device, kPciAny, kPciAny)] = line.substr(7);
+        } else if (parse_hex16(line, vendor)) {
+            names[pci_key(vendor, kPciAny, kPciAny, kPciAny)] = line.substr(6);
+        }
+    }
+    return names.size();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int vendors = 1300, lookups = 1000000;
+    bool keep = false;
+    if (!BenchArgs()
+             .option("--vendors", "N", vendors, 0)
+             .option("--lookups", "L", lookups)
+             .flag("--keep", keep)
+             .parse(argc, argv)) {
+        return 2;
+    }
+    
+    ScratchDir scratch("pciids");
+    if (keep) {
+        scratch.keep();
+    }
+    const std::string source = scratch.path() + "/pci.ids";
+    const std::string index_path = scratch.path() + "/cache/pci-ids.idx";
+    std::vector<uint64_t> keys = write_pci_ids(source, vendors);
+    struct stat st;
+    ::stat(source.c_str(), &st);
+    std::printf("# %s: %.1f KB, %zu synthetic keys\n", source.c_str(), st.st_size / 1024.0, keys.size());
+    
+    double t0 = now_us();
+    size_t naive_entries = naive_parse(source);
+    std::printf("naive text parse:     %8.3f ms  (%zu entries)\n", elapsed_ms(t0), naive_entries);
+    
+    t0 = now_us();
+    {
+        PciIdsIndex index(source, index_path);
+        std::printf("build + store index:  %8.3f ms\n", elapsed_ms(t0));
+    }
+    
+    t0 = now_us();
+    PciIdsIndex index(source, index_path);
+    std::printf("open cached index:    %8.3f ms\n", elapsed_ms(t0));
+    if (!index.available()) {
+        std::fprintf(stderr, "error: index not available\n");
+        return 1;
+    }
+    
+    std::mt19937 rng(7);
+    std::vector<uint64_t> probes(4096);
+    for (auto& probe : probes) {
+        probe = keys[rng() % keys.size()];
+    }
+    size_t found = 0, i = 0;
+    std::string_view name;
+    double us = time_per_call_us(lookups, [&] { found += index.lookup(probes[i++ & 4095], name); });
+    std::printf("lookup:               %8.1f ns  (%.0f%% found)\n", us * 1000, 100.0 * found / (lookups + 1));
+    return 0;
+}
@@ -0,0 +1,74 @@
+// Prompt mode latency benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Runs `whatsmy gpu prompt` in-process against a synthetic host, the way a
+// shell prompt or tmux status line does on every redraw:
+//   - once cold (no inventory cache, no remembered hwmon directory);
+//   - --runs times warm, with p50/p90/p99/max against the 1 ms budget.
+// stdout goes to /dev/null for the timed runs; the last line is echoed.
+//
+// Usage: gpu_prompt_latency [--cards N] [--runs R]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+namespace {
+
+// One prompt run with stdout sent to `fd`; returns microseconds
+double run_once(int fd) {
+    int saved = ::dup(STDOUT_FILENO);
+    ::dup2(fd, STDOUT_FILENO);
+    char command[] = "gpu", mode[] = "prompt";
+    char* argv[] = {command, mode, nullptr};
+    double t0 = now_us();
+    int result = run_command(2, argv);
+    double elapsed = now_us() - t0;
+    ::dup2(saved, STDOUT_FILENO);
+    ::close(saved);
+    return result == 0 ? elapsed : -1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int cards = 4, runs = 2000;
+    if (!BenchArgs().option("--cards", "N", cards).option("--runs", "R", runs).parse(argc, argv)) {
+        return 2;
+    }
+    
+    ScratchDir scratch("prompt");
+    setenv("WHATSMY_GPU_ROOT", scratch.host("host", cards).c_str(), 1);
+    setenv("XDG_CACHE_HOME", (scratch.path() + "/cache").c_str(), 1);
+    unsetenv("WHATSMY_GPU_NO_CACHE");
+    
+    int null_fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    double cold = run_once(null_fd);
+    std::vector<double> latencies;
+    latencies.reserve(runs);
+    for (int i = 0; i < runs; ++i) {
+        double elapsed = run_once(null_fd);
+        if (elapsed < 0) {
+            std::fprintf(stderr, "error: run %d failed\n", i);
+            return 1;
+        }
+        latencies.push_back(elapsed);
+    }
+    ::close(null_fd);
+    
+    std::printf("# %d cards, %d warm runs\n", cards, runs);
+    std::fflush(stdout);
+    std::printf("line: ");
+    std::fflush(stdout);
+    run_once(STDOUT_FILENO);
+    
+    const double p99 = percentile(latencies, 0.99);
+    std::printf("cold us: %.1f\n", cold);
+    std::printf("warm us: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f  (%s 1 ms at p99)\n", percentile(latencies, 0.5),
+                percentile(latencies, 0.9), p99, percentile(latencies, 1.0), p99 < 1000 ? "under" : "OVER");
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Output rendering benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Renders `whatsmy gpu all` for a synthetic host into /dev/null and
+// reports, per render, the write() syscalls (from /proc/self/io), heap
+// allocations and time for:
+//   - the TextBuffer renderer (display_all_gpus), one write() expected;
+//   - the iostream renderer it replaced, kept here as the reference.
+//
+// Usage: gpu_render_output [--cards N] [--reps R]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+namespace {
+
+// write() syscalls made by this process so far
+uint64_t write_syscalls() {
+    SysfsAttr attr;
+    ssize_t n = PosixSysfs::read_file_at(AT_FDCWD, "/proc/self/io", attr.data, sizeof(attr.data));
+    std::string_view text(attr.data, n > 0 ? static_cast<size_t>(n) : 0);
+    size_t at = text.find("syscw: ");
+    return at == std::string_view::npos ? 0 : std::strtoull(attr.data + at + 7, nullptr, 10);
+}
+
+// The renderer before TextBuffer: every piece through std::cout
+void legacy_header(const std::string& text) {
+    std::cout << "\n" << Color::BOLD << Color::CYAN << text << Color::RESET << "\n";
+    std::cout << std::string(50, '=') << "\n";
+}
+
+void legacy_field(const std::string& key, const std::string& value) {
+    std::cout << "  " << Color::GREEN << key << ": " << Color::RESET << value << "\n";
+}
+
+void legacy_display_all(const std::vector<GPUInfo>& gpus) {
+    legacy_header("All GPUs (" + std::to_string(gpus.size()) + " detected)");
+    for (const auto& gpu : gpus) {
+        std::cout << Color::BOLD << "GPU " << gpu.index << Color::RESET;
+        if (gpu.is_active) {
+            std::cout << " " << Color::GREEN << "(Active)" << Color::RESET;
+        }
+        std::cout << "\n";
+        legacy_field("Name", gpu.name);
+        legacy_field("Vendor", gpu.vendor);
+        if (!gpu.board.empty()) {
+            legacy_field("Board", gpu.board);
+        }
+        if (!gpu.pci_id.empty()) {
+            legacy_field("PCI ID", gpu.pci_id);
+        }
+        if (&gpu != &gpus.back()) {
+            std::cout << "\n";
+        }
+    }
+    std::cout << std::flush;
+}
+
+struct Result {
+    double writes;
+    double allocs;
+    double us;
+};
+
+// write() calls are counted across measure()'s warm-up render as well,
+// hence reps + 1 renders
+template <typename Fn>
+Result measure_render(int reps, Fn render) {
+    uint64_t writes = write_syscalls();
+    Measurement m = measure(reps, render);
+    return {double(write_syscalls() - writes) / (reps + 1), m.per_call(m.io.allocs), m.us};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int cards = 64, reps = 2000;
+    if (!BenchArgs().option("--cards", "N", cards).option("--reps", "R", reps).parse(argc, argv)) {
+        return 2;
+    }
+    
+    std::vector<GPUInfo> gpus;
+    {
+        ScratchDir scratch("render");
+        gpus = detect_gpus_linux(posix_sysfs(), scratch.host("host", cards), 1);
+    }
+    
+    // Renders go to /dev/null, which stdio buffers like a pipe
+    std::fflush(stdout);
+    int saved = ::dup(STDOUT_FILENO);
+    int null_fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    ::dup2(null_fd, STDOUT_FILENO);
+    ::close(null_fd);
+    Result buffered = measure_render(reps, [&] { display_all_gpus(gpus); });
+    Result legacy = measure_render(reps, [&] { legacy_display_all(gpus); });
+    std::fflush(stdout);
+    ::dup2(saved, STDOUT_FILENO);
+    ::close(saved);
+    
+    TextBuffer sizing;
+    print_header(sizing, "All GPUs");
+    for (const auto& gpu : gpus) {
+        display_gpu(sizing, gpu, true);
+    }
+    std::printf("# %zu cards, ~%zu bytes per render, %d renders each\n", gpus.size(), sizing.view().size(), reps);
+    std::printf("%-10s %10s %10s %10s\n", "renderer", "writes", "allocs", "us");
+    std::printf("%-10s %10.2f %10.2f %10.2f\n", "buffered", buffered.writes, buffered.allocs, buffered.us);
+    std::printf("%-10s %10.2f %10.2f %10.2f\n", "iostream", legacy.writes, legacy.allocs, legacy.us);
+    return 0;
+}
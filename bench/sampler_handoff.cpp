@@ -0,0 +1,114 @@
+// Sampler/output handoff benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Measures the SPSC ring that carries TelemetrySample records from the
+// sampler thread to the output thread:
+//   - push and pop cost per record, and allocations on the push path;
+//   - sample-interval jitter of a SamplerThread on a synthetic host while
+//     the consumer keeps up, and while it stalls for --stall-ms at a time
+//     (a blocked pipe or terminal), with the records dropped meanwhile.
+// tests/sampler_handoff.cpp checks that every record is either delivered
+// in order or counted dropped.
+//
+// Usage: gpu_sampler_handoff [--cards N] [--hz H] [--seconds T] [--stall-ms M]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+namespace {
+
+struct RunResult {
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    TelemetrySample last{};
+};
+
+// Drain a SamplerThread like run_watch does, sleeping `stall_ms` after
+// every batch to stand in for a slow writer
+RunResult consume(TelemetrySampler& sampler, int hz, double seconds, int stall_ms) {
+    const uint64_t ticks = static_cast<uint64_t>(seconds * hz);
+    SamplerThread thread(sampler, nullptr, std::chrono::nanoseconds(1000000000 / hz), ticks);
+    RunResult result;
+    if (!thread.start()) {
+        return result;
+    }
+    bool done = false;
+    while (!done) {
+        pollfd pfd{thread.ready_fd(), POLLIN, 0};
+        ::poll(&pfd, 1, -1);
+        thread.acknowledge();
+        done = thread.finished();
+        while (thread.pop(result.last)) {
+            ++result.delivered;
+        }
+        if (stall_ms > 0 && !done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(stall_ms));
+        }
+    }
+    thread.stop();
+    result.dropped = thread.dropped();
+    return result;
+}
+
+void report(const char* label, const RunResult& result) {
+    std::printf("%-14s delivered %5llu  dropped %5llu  jitter %6.1f us avg / %7.1f us max\n", label,
+                static_cast<unsigned long long>(result.delivered), static_cast<unsigned long long>(result.dropped),
+                result.last.jitter_mean_ns / 1000.0, result.last.jitter_max_ns / 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int cards = 8, hz = 200, stall_ms = 500;
+    double seconds = 2;
+    if (!BenchArgs()
+             .option("--cards", "N", cards)
+             .option("--hz", "H", hz)
+             .option("--seconds", "T", seconds, 0.1)
+             .option("--stall-ms", "M", stall_ms)
+             .parse(argc, argv)) {
+        return 2;
+    }
+    
+    // Ring alone: one thread, so this is the uncontended copy cost
+    std::unique_ptr<SpscRing<TelemetrySample, SamplerThread::kRingRecords>> ring(
+        new SpscRing<TelemetrySample, SamplerThread::kRingRecords>());
+    TelemetrySample sample{};
+    sample.count = 64;
+    const int reps = 200000;
+    Measurement push = measure(reps, [&] {
+        ++sample.tick;
+        ring->push(sample);
+    });
+    double t0 = now_us();
+    uint64_t popped = 0;
+    while (ring->pop(sample)) {
+        ++popped;
+    }
+    double pop = (now_us() - t0) * 1000 / std::max<uint64_t>(popped, 1);
+    std::printf("# %zu-byte records, %zu slots (%.0f KiB)\n", sizeof(TelemetrySample), SamplerThread::kRingRecords,
+                sizeof(*ring) / 1024.0);
+    std::printf("push:   %6.1f ns/record  %.2f allocs  %.2f syscalls\n", push.us * 1000,
+                push.per_call(push.io.allocs), push.per_call(push.io.syscalls()));
+    std::printf("pop:    %6.1f ns/record  (%llu kept, %llu dropped of %d)\n", pop,
+                static_cast<unsigned long long>(popped), static_cast<unsigned long long>(ring->dropped()), reps + 1);
+    
+    ScratchDir scratch("sampler-handoff");
+    const std::string root = scratch.host("host", cards);
+    std::vector<GPUInfo> gpus = enumerate_gpus_linux(list_drm_entries(SysfsDir(root + "/sys/class/drm", true)));
+    TelemetrySampler sampler(root);
+    sampler.discover(gpus);
+    std::printf("# %d cards, %zu reads per tick, %d Hz for %.1f s\n", cards, sampler.reads_per_sample(), hz,
+                seconds);
+    
+    report("keeping up:", consume(sampler, hz, seconds, 0));
+    char label[32];
+    std::snprintf(label, sizeof(label), "stall %d ms:", stall_ms);
+    report(label, consume(sampler, hz, seconds, stall_ms));
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Shared-memory snapshot benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// A writer thread republishes two alternating inventories as fast as it
+// can while the main thread reads snapshots; reports read latency and how
+// many torn reads the seqlock caught and retried. tests/shm_snapshot.cpp
+// checks that no torn snapshot gets through.
+//
+// Usage: gpu_shm_read [--cards N] [--reads R]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+namespace {
+
+std::vector<GPUInfo> make_inventory(int cards, const char* tag) {
+    std::vector<GPUInfo> gpus(cards);
+    for (int i = 0; i < cards; ++i) {
+        gpus[i].index = i;
+        gpus[i].is_active = i == 0;
+        gpus[i].name = std::string(tag) + " GPU " + std::to_string(i);
+        gpus[i].vendor = "NVIDIA";
+        gpus[i].driver_version = "550.54.15";
+        gpus[i].pci_id = "10DE:2330";
+        gpus[i].node = "card" + std::to_string(i);
+    }
+    return gpus;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int cards = 8, reads = 200000;
+    if (!BenchArgs().option("--cards", "N", cards).option("--reads", "R", reads).parse(argc, argv)) {
+        return 2;
+    }
+
+    const std::string name = "/whatsmy-gpu-bench-" + std::to_string(::getpid());
+    const std::vector<GPUInfo> even = make_inventory(cards, "Even");
+    const std::vector<GPUInfo> odd = make_inventory(cards + 1, "Odd");
+
+    ShmInventoryPublisher publisher;
+    std::string error;
+    if (!publisher.create(name, error)) {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+    publisher.publish(even);
+
+    ShmInventoryReader reader;
+    if (!reader.open(name)) {
+        std::fprintf(stderr, "error: cannot map %s\n", name.c_str());
+        return 1;
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> publishes{0};
+    std::thread writer([&] {
+        for (uint64_t n = 0; !done.load(std::memory_order_relaxed); ++n) {
+            publisher.publish(n & 1 ? odd : even);
+            publishes.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    std::vector<GPUInfo> gpus;
+    uint64_t torn = 0, failed = 0;
+    std::vector<double> latencies;
+    latencies.reserve(reads);
+    for (int i = 0; i < reads; ++i) {
+        unsigned retries = 0;
+        double t0 = now_us();
+        failed += !reader.read(gpus, &retries);
+        latencies.push_back((now_us() - t0) * 1000);
+        torn += retries;
+    }
+    done = true;
+    writer.join();
+
+    std::printf("# %d/%d cards alternating, %d reads, %llu concurrent publishes\n", cards,
+                cards + 1, reads, static_cast<unsigned long long>(publishes.load()));
+    std::printf("read ns: p50 %.0f  p99 %.0f  max %.0f\n", percentile(latencies, 0.5),
+                percentile(latencies, 0.99), percentile(latencies, 1.0));
+    std::printf("torn reads retried: %llu, reads given up: %llu\n",
+                static_cast<unsigned long long>(torn), static_cast<unsigned long long>(failed));
+    return 0;
+}
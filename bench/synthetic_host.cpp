@@ -0,0 +1,165 @@
+// Synthetic sysfs/procfs trees for the benchmarks
+// Copyright (C) 2025 enXov
+// License: GPLv3
+
+#include "synthetic_host.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct VendorTemplate {
+    const char* vendor_id;
+    const char* driver;
+    const char* device_ids[4];
+    const char* label;
+};
+
+const VendorTemplate kVendors[] = {
+    {"10DE", "nvidia", {"2330", "2684", "20B0", "1DB4"}, "NVIDIA H100 80GB HBM3"},
+    {"1002", "amdgpu", {"740C", "744C", "73BF", "74A1"}, "AMD Instinct MI250X"},
+    {"8086", "i915", {"56A0", "A780", "4680", "0BD5"}, "Intel Arc A770"},
+};
+
+void write_file(const fs::path& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("cannot write " + path.string());
+    }
+    out << contents;
+}
+
+} // namespace
+
+void build_synthetic_host(const std::string& root, const SyntheticHostOptions& options) {
+    const fs::path base(root);
+    fs::remove_all(base);
+
+    const fs::path drm = base / "sys/class/drm";
+    fs::create_directories(drm);
+    write_file(drm / "version", "drm 1.1.0 20060810\n");
+
+    static const char* connector_kinds[] = {"DP", "HDMI-A", "eDP"};
+    for (int card = 0; card < options.cards; ++card) {
+        const VendorTemplate& vendor = kVendors[card % 3];
+        const char* device_id = vendor.device_ids[(card / 3) % 4];
+        char slot[32];
+        std::snprintf(slot, sizeof(slot), "0000:%02x:%02x.0", (card >> 5) & 0xff, card & 0x1f);
+        // Alternate reference boards and ASUS-built ones
+        char subsystem[16];
+        std::snprintf(subsystem, sizeof(subsystem), "%s:%04X", card % 2 ? "1043" : vendor.vendor_id,
+                      0x1000 + card % 0x1000);
+
+        const fs::path card_dir = drm / ("card" + std::to_string(card));
+        const fs::path device = card_dir / "device";
+        fs::create_directories(device);
+        write_file(card_dir / "dev", "226:" + std::to_string(card) + "\n");
+        write_file(card_dir / "uevent", "MAJOR=226\nMINOR=" + std::to_string(card) +
+                   "\nDEVNAME=dri/card" + std::to_string(card) + "\nDEVTYPE=drm_minor\n");
+
+        write_file(device / "uevent",
+                   std::string("DRIVER=") + vendor.driver + "\n" +
+                   "PCI_CLASS=30000\n" +
+                   "PCI_ID=" + vendor.vendor_id + ":" + device_id + "\n" +
+                   "PCI_SUBSYS_ID=" + subsystem + "\n" +
+                   "PCI_SLOT_NAME=" + slot + "\n" +
+                   "MODALIAS=pci:v0000" + vendor.vendor_id + "d0000" + device_id +
+                   "sv00001043sd00008A0Ebc03sc00i00\n");
+        write_file(device / "vendor", std::string("0x") + vendor.vendor_id + "\n");
+        write_file(device / "device", std::string("0x") + device_id + "\n");
+        if (card % 3 == 2) {
+            write_file(device / "label", std::string(vendor.label) + "\n");
+        }
+
+        // device/driver -> sys/bus/pci/drivers/<driver>, whose module link
+        // leads to sys/module/<driver>
+        const fs::path driver_dir = base / "sys/bus/pci/drivers" / vendor.driver;
+        if (!fs::exists(driver_dir)) {
+            fs::create_directories(driver_dir);
+            fs::create_directories(base / "sys/module" / vendor.driver);
+            fs::create_directory_symlink(fs::path("../../../../module") / vendor.driver, driver_dir / "module");
+        }
+        fs::create_directory_symlink(fs::path("../../../../bus/pci/drivers") / vendor.driver, device / "driver");
+
+        // amdgpu's utilization and memory accounting (64 GiB VRAM, 32 GiB GTT)
+        if (std::string(vendor.driver) == "amdgpu") {
+            write_file(device / "gpu_busy_percent", std::to_string(card * 13 % 101) + "\n");
+            write_file(device / "mem_busy_percent", std::to_string(card * 7 % 101) + "\n");
+            write_file(device / "mem_info_vram_total", "68719476736\n");
+            write_file(device / "mem_info_vram_used", std::to_string(13207400448LL + card * 1048576LL) + "\n");
+            write_file(device / "mem_info_gtt_total", "34359738368\n");
+            write_file(device / "mem_info_gtt_used", "104857600\n");
+        }
+
+        const fs::path hwmon = device / "hwmon" / ("hwmon" + std::to_string(card));
+        fs::create_directories(hwmon);
+        write_file(hwmon / "name", std::string(vendor.driver) + "\n");
+        // Name and a plausible reading in sysfs units (millidegrees,
+        // microwatts, RPM, millivolts)
+        static const struct { const char* file; long value; } sensors[] = {
+            {"temp1_input", 45000}, {"power1_average", 250000000}, {"fan1_input", 1200},
+            {"in0_input", 850}, {"temp2_input", 52000}, {"temp3_input", 61000},
+            {"power2_average", 35000000}, {"fan2_input", 1150}, {"in1_input", 1350},
+            {"in2_input", 12000},
+        };
+        for (int s = 0; s < options.hwmon_sensors && s < 10; ++s) {
+            write_file(hwmon / sensors[s].file, std::to_string(sensors[s].value + card * 7) + "\n");
+        }
+
+        for (int c = 0; c < options.connectors_per_card; ++c) {
+            const fs::path connector = drm / ("card" + std::to_string(card) + "-" +
+                                               connector_kinds[c % 3] + "-" + std::to_string(c / 3 + 1));
+            fs::create_directories(connector);
+            write_file(connector / "status", c == 0 ? "connected\n" : "disconnected\n");
+            write_file(connector / "enabled", c == 0 ? "enabled\n" : "disabled\n");
+        }
+
+        fs::create_directories(drm / ("renderD" + std::to_string(128 + card)));
+    }
+
+    const fs::path random = base / "proc/sys/kernel/random";
+    fs::create_directories(random);
+    write_file(random / "boot_id", "3f1c2a9e-5b7d-4e21-9c0a-6d8e2f41b7c3\n");
+    write_file(base / "proc/sys/kernel/osrelease", "6.8.0-synthetic\n");
+
+    // Out-of-tree nvidia carries a version, amdgpu only a srcversion, and
+    // in-tree i915 neither
+    const fs::path modules = base / "sys/module";
+    if (fs::exists(modules / "nvidia")) {
+        write_file(modules / "nvidia/version", "550.54.15\n");
+    }
+    if (fs::exists(modules / "amdgpu")) {
+        write_file(modules / "amdgpu/srcversion", "5D4C1B0F3E2A9876F01A2B3\n");
+    }
+
+    if (options.nvidia_proc) {
+        const fs::path proc = base / "proc/driver/nvidia";
+        fs::create_directories(proc);
+        write_file(proc / "version",
+                   "NVRM version: NVIDIA UNIX x86_64 Kernel Module  550.54.15  Tue Mar  5 22:23:56 UTC 2024\n"
+                   "GCC version:  gcc version 12.2.0 (Debian 12.2.0-14)\n");
+    }
+}
+
+std::string make_scratch_dir(const char* tag) {
+    const char* tmp = std::getenv("TMPDIR");
+    std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/whatsmy-" + tag + "-XXXXXX";
+    std::vector<char> buffer(pattern.begin(), pattern.end());
+    buffer.push_back('\0');
+    if (!mkdtemp(buffer.data())) {
+        throw std::runtime_error("mkdtemp failed for " + pattern);
+    }
+    return buffer.data();
+}
+
+void remove_tree(const std::string& root) {
+    std::error_code ec;
+    fs::remove_all(root, ec);
+}
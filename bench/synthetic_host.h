@@ -0,0 +1,26 @@
+// Synthetic sysfs/procfs trees for the benchmarks
+// Copyright (C) 2025 enXov
+// License: GPLv3
+
+#pragma once
+
+#include <string>
+
+// Shape of a generated host
+struct SyntheticHostOptions {
+    int cards = 1;               // card* entries under sys/class/drm
+    int connectors_per_card = 3; // card*-DP-n / card*-HDMI-A-n entries
+    int hwmon_sensors = 4;       // temp/power/fan/in inputs per card (up to 10)
+    bool nvidia_proc = true;     // write proc/driver/nvidia/version
+};
+
+// Build a fake host below `root` (created if needed, wiped first).
+// Cards rotate through NVIDIA, AMD and Intel; every third card carries a
+// sysfs label so both naming paths get exercised.
+void build_synthetic_host(const std::string& root, const SyntheticHostOptions& options);
+
+// Make a fresh scratch directory under $TMPDIR (or /tmp)
+std::string make_scratch_dir(const char* tag);
+
+// Recursively delete a scratch directory
+void remove_tree(const std::string& root);
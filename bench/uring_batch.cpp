@@ -0,0 +1,78 @@
+// io_uring batch benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Compares the synchronous sysfs path with SysfsBatch on io_uring on
+// synthetic hosts of increasing size:
+//   - a full probe round (uevent and name attributes of every card):
+//     serial, the default worker threads, and one batched round;
+//   - one telemetry tick (every hwmon/amdgpu pread) held-fd sync vs one
+//     io_uring submission.
+// Syscalls include io_uring_setup/io_uring_enter; ring mmaps are not counted.
+//
+// Usage: gpu_uring_batch [--max N] [--reps R]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+namespace {
+
+// "<us> us <syscalls>" columns for one measurement
+void print_cost(const Measurement& m) {
+    std::printf("  %8.1f us %7.1f", m.us, m.per_call(m.io.syscalls()));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int max_cards = 64, reps = 50;
+    if (!BenchArgs().option("--max", "N", max_cards).option("--reps", "R", reps).parse(argc, argv)) {
+        return 2;
+    }
+    
+    if (!IoUring(8).valid()) {
+        std::printf("# io_uring unavailable here (%s); the batch falls back to syscalls\n", std::strerror(errno));
+    }
+    
+    std::printf("# probe round: us / syscalls per round\n");
+    std::printf("%6s  %18s  %18s  %18s\n", "cards", "serial", "threads", "io_uring");
+    ScratchDir scratch("uring-batch");
+    for (int cards = 2; cards <= max_cards; cards *= 2) {
+        const std::string root = scratch.host("n" + std::to_string(cards), cards);
+        SysfsDir root_dir(root);
+        SysfsDir drm_dir(root_dir, "sys/class/drm", true);
+        DriverRegistry& drivers = DriverRegistry::for_root(root);
+        std::vector<GPUInfo> gpus = enumerate_gpus_linux(list_drm_entries(drm_dir));
+        std::vector<GPUInfo*> targets;
+        for (auto& gpu : gpus) {
+            targets.push_back(&gpu);
+        }
+        
+        // The warm-up call also fills the driver registry
+        std::printf("%6d", cards);
+        print_cost(measure(reps, [&] { populate_gpus_linux(root_dir, drm_dir, drivers, targets, 1); }));
+        print_cost(measure(reps, [&] { populate_gpus_linux(root_dir, drm_dir, drivers, targets); }));
+        print_cost(measure(reps, [&] { populate_gpus_batched(root_dir, drm_dir, drivers, targets); }));
+        std::printf("\n");
+    }
+    
+    std::printf("# telemetry tick: us / syscalls per tick\n");
+    std::printf("%6s  %6s  %18s  %18s\n", "cards", "reads", "pread", "io_uring");
+    for (int cards = 2; cards <= max_cards; cards *= 2) {
+        const std::string root = scratch.path() + "/n" + std::to_string(cards);
+        std::vector<GPUInfo> gpus = enumerate_gpus_linux(list_drm_entries(SysfsDir(root + "/sys/class/drm", true)));
+        TelemetrySampler sync_sampler(root, false);
+        TelemetrySampler uring_sampler(root, true);
+        sync_sampler.discover(gpus);
+        uring_sampler.discover(gpus);
+        std::printf("%6d  %6zu", cards, sync_sampler.reads_per_sample());
+        print_cost(measure(reps * 10, [&] { sync_sampler.sample(); }));
+        print_cost(measure(reps * 10, [&] { uring_sampler.sample(); }));
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Telemetry sampling overhead benchmark
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Discovers the hwmon sensors of a synthetic host once, then reports:
+//   - the cost of one TelemetrySampler::sample() (pread on held fds)
+//     against reopening every sensor path each tick;
+//   - the CPU share of sampling at a fixed rate for a few seconds.
+//
+// Usage: gpu_watch_overhead [--cards N] [--sensors S] [--hz H] [--seconds T]
+
+// The plugin is a single translation unit; see detect_scaling.cpp.
+#include "plugin.cpp"
+
+#include "bench_support.h"
+
+#include <cstdio>
+
+int main(int argc, char* argv[]) {
+    int cards = 8, sensors = 10, hz = 10;
+    double seconds = 3;
+    if (!BenchArgs()
+             .option("--cards", "N", cards)
+             .option("--sensors", "S", sensors)
+             .option("--hz", "H", hz)
+             .option("--seconds", "T", seconds, 0.1)
+             .parse(argc, argv)) {
+        return 2;
+    }
+    
+    ScratchDir scratch("watch-overhead");
+    SyntheticHostOptions options;
+    options.cards = cards;
+    options.hwmon_sensors = sensors;
+    const std::string root = scratch.host("host", options);
+    
+    std::vector<GPUInfo> gpus = enumerate_gpus_linux(list_drm_entries(SysfsDir(root + "/sys/class/drm", true)));
+    TelemetrySampler sampler(root);
+    sampler.discover(gpus);
+    const size_t reads = sampler.reads_per_sample();
+    std::printf("# %d cards, %zu hwmon channels, %zu amdgpu cards, %zu reads per tick, %d Hz for %.1f s\n",
+                cards, sampler.channels().size(), sampler.amdgpu().size(), reads, hz, seconds);
+    
+    // Per-tick cost: held fds
+    const int reps = 2000;
+    Measurement held = measure(reps, [&] { sampler.sample(); });
+    std::printf("held fds:   %7.1f us/tick  %5.2f syscalls/read  %5.2f allocs/tick\n", held.us,
+                held.per_call(held.io.syscalls()) / reads, held.per_call(held.io.allocs));
+    
+    // Per-tick cost: reopening each hwmon path, as a naive poller would
+    std::vector<std::string> paths;
+    for (const auto& gpu : gpus) {
+        std::string dir = root + "/sys/class/drm/" + gpu.node + "/device/hwmon/hwmon" + std::to_string(gpu.index);
+        for (const auto& entry : fs::directory_iterator(dir)) {
+            std::string name = entry.path().filename().string();
+            if (name != "name") {
+                paths.push_back(entry.path().string());
+            }
+        }
+    }
+    Measurement reopen = measure(reps, [&] {
+        for (const auto& path : paths) {
+            std::ifstream in(path);
+            long long value;
+            in >> value;
+        }
+    });
+    std::printf("reopen:     %7.1f us/tick  %5.2f syscalls/read  %5.2f allocs/tick  (hwmon only)\n", reopen.us,
+                reopen.per_call(reopen.io.syscalls()) / paths.size(), reopen.per_call(reopen.io.allocs));
+    
+    // CPU share at the target rate, same fixed schedule as run_watch
+    const auto interval = std::chrono::nanoseconds(1000000000 / hz);
+    const int ticks = static_cast<int>(seconds * hz);
+    int64_t cpu0 = self_cpu_micros();
+    auto start = std::chrono::steady_clock::now();
+    auto next = start;
+    for (int i = 0; i < ticks; ++i) {
+        sampler.sample();
+        next += interval;
+        std::this_thread::sleep_until(next);
+    }
+    double wall = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::printf("at %d Hz:   %7.3f %% of one core\n", hz, 100.0 * (self_cpu_micros() - cpu0) / wall);
+    return 0;
+}
@@ -9,7 +9,27 @@
 #include <sstream>
 #include <filesystem>
 #include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
+#include <string_view>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <map>
+#include <memory>
+#include <functional>
+#include <cerrno>
+#include <chrono>
+#include <ctime>
+#include <climits>
+#include <condition_variable>
+#include <type_traits>
+#include <new>
+#include <charconv>
+#include <cmath>
 
 // Platform detection
 #if defined(_WIN32) || defined(_WIN64)
@@ -23,6 +43,33 @@
     #include <IOKit/IOKitLib.h>
 #elif defined(__linux__)
     #define PLATFORM_LINUX
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <dirent.h>
+    #include <sys/stat.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/signalfd.h>
+    #include <sys/mman.h>
+    #include <sys/resource.h>
+    #include <malloc.h>
+    #include <signal.h>
+    #include <linux/netlink.h>
+    #include <linux/io_uring.h>
+    #include <sys/syscall.h>
+    #include <dlfcn.h>
+    #include <poll.h>
+    // USDT probe points (see "Static probe points" below) when the
+    // systemtap header is there; it is header-only, no runtime library
+    #if defined(__has_include) && !defined(WHATSMY_GPU_NO_USDT)
+        #if __has_include(<sys/sdt.h>)
+            #define _SDT_HAS_SEMAPHORES 1
+            #include <sys/sdt.h>
+            #define WHATSMY_GPU_USDT
+        #endif
+    #endif
 #endif
 
 // Plugin API export macro
@@ -38,362 +85,5995 @@ namespace fs = std::filesystem;
 struct GPUInfo {
     std::string name;
     std::string vendor;
+    std::string driver;      // Kernel driver bound to the device, e.g. "amdgpu"
     std::string driver_version;
     std::string pci_id;
+    std::string board;       // Board partner and model from the PCI subsystem, if not the chip vendor
+    std::string node;        // DRM card entry on Linux, e.g. "card0"
     int index;
     bool is_active;
+    bool populated = false;  // Identity fields above have been filled in
 };
 
 // ANSI color codes
 namespace Color {
-    const char* RESET = "\033[0m";
-    const char* BOLD = "\033[1m";
-    const char* CYAN = "\033[36m";
-    const char* GREEN = "\033[32m";
-    const char* YELLOW = "\033[33m";
-    const char* BLUE = "\033[34m";
-    const char* DIM = "\033[2m";
+    namespace Ansi {
+        constexpr const char* RESET = "\033[0m";
+        constexpr const char* BOLD = "\033[1m";
+        constexpr const char* CYAN = "\033[36m";
+        constexpr const char* GREEN = "\033[32m";
+        constexpr const char* YELLOW = "\033[33m";
+        constexpr const char* BLUE = "\033[34m";
+        constexpr const char* DIM = "\033[2m";
+    }
+    
+    // What stdout gets
+    const char* RESET = Ansi::RESET;
+    const char* BOLD = Ansi::BOLD;
+    const char* CYAN = Ansi::CYAN;
+    const char* GREEN = Ansi::GREEN;
+    const char* YELLOW = Ansi::YELLOW;
+    const char* BLUE = Ansi::BLUE;
+    const char* DIM = Ansi::DIM;
+    // What stderr messages get
+    const char* WARN = Ansi::YELLOW;
+    const char* WARN_END = Ansi::RESET;
+    
+    // Pick the codes for this run: ANSI for a terminal, "" for pipes and
+    // files. The host may run us on a terminal once and into a pipe the
+    // next, so every run decides afresh, and stderr by stderr alone.
+    void init(bool stdout_colors, bool stderr_colors) {
+        auto pick = [](bool colors, const char* code) { return colors ? code : ""; };
+        RESET = pick(stdout_colors, Ansi::RESET);
+        BOLD = pick(stdout_colors, Ansi::BOLD);
+        CYAN = pick(stdout_colors, Ansi::CYAN);
+        GREEN = pick(stdout_colors, Ansi::GREEN);
+        YELLOW = pick(stdout_colors, Ansi::YELLOW);
+        BLUE = pick(stdout_colors, Ansi::BLUE);
+        DIM = pick(stdout_colors, Ansi::DIM);
+        WARN = pick(stderr_colors, Ansi::YELLOW);
+        WARN_END = pick(stderr_colors, Ansi::RESET);
+    }
+}
+
+// Output formatter. Rendering appends to one buffer that keeps its
+// capacity between uses, and flush() hands it to stdout in a single
+// write() (looping only on a short write), so a whole report costs one
+// syscall however many GPUs and fields it has, with no iostream and no
+// temporary strings.
+class TextBuffer {
+public:
+    TextBuffer() { buffer_.reserve(16384); }
+    
+    TextBuffer& operator<<(std::string_view text) {
+        buffer_.append(text.data(), text.size());
+        return *this;
+    }
+    TextBuffer& operator<<(const char* text) { return *this << std::string_view(text); }
+    TextBuffer& operator<<(char c) {
+        buffer_.push_back(c);
+        return *this;
+    }
+    TextBuffer& operator<<(long long value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer_.append(digits, result.ptr);
+        return *this;
+    }
+    TextBuffer& operator<<(int value) { return *this << static_cast<long long>(value); }
+    TextBuffer& operator<<(size_t value) { return *this << static_cast<long long>(value); }
+    
+    void fill(char c, size_t count) { buffer_.append(count, c); }
+    std::string_view view() const { return buffer_; }
+    void clear() { buffer_.clear(); }
+    
+    // Write everything to stdout and start over. Text already queued in
+    // stdio (std::cout included) goes out first to keep the order.
+    void flush() {
+        std::fflush(stdout);
+#ifdef PLATFORM_LINUX
+        size_t done = 0;
+        while (done < buffer_.size()) {
+            ssize_t n = ::write(STDOUT_FILENO, buffer_.data() + done, buffer_.size() - done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+#else
+        std::fwrite(buffer_.data(), 1, buffer_.size(), stdout);
+        std::fflush(stdout);
+#endif
+        buffer_.clear();
+    }
+    
+private:
+    std::string buffer_;
+};
+
+// The buffer every report renders into
+TextBuffer& output_buffer() {
+    static TextBuffer buffer;
+    return buffer;
+}
+
+// Machine-readable output (--json, --ndjson; --format=cbor further down).
+//
+// Records are written field by field straight into a TextBuffer: strings
+// are escaped in place and numbers go through std::to_chars, with no DOM
+// and no intermediate std::string. Every record opens with "schema"
+// (kJsonSchema, bumped on any incompatible change) and "type", and fields
+// always come in the order below, null when unknown, so consumers can
+// take fast paths on fixed prefixes. --json writes one document per
+// command (per tick or event for watch and monitor); --ndjson writes one
+// record per line, e.g. one "gpu" per GPU instead of an "inventory".
+//
+//   gpu        index, active, node, name, vendor, board, driver, driver_version, pci_id
+//   inventory  gpus: [gpu fields...]
+//   prompt     index, name, temperature_c, busy_percent
+//   sample     tick, time, read_ns, jitter_ns, jitter_mean_ns, jitter_max_ns,
+//              cpu_percent, dropped, values: [{gpu, name, kind, unit, value, total}...]
+//   history    series: [{gpu, name, kind, unit, windows: [{window, seconds, min, mean, max}...]}...]
+//   change     time_ms, kind (added/removed/changed), node, gpu (gpu fields or null)
+//   daemon     socket, shm, gpus, hotplug
+enum class OutputFormat { Text, Json, Ndjson, Cbor };
+
+OutputFormat output_format = OutputFormat::Text;
+
+constexpr int kJsonSchema = 1;
+
+class JsonWriter {
+public:
+    explicit JsonWriter(TextBuffer& out) : out_(out) {}
+    
+    // {"schema":N,"type":"<type>" ... close with end_object()
+    JsonWriter& begin_record(const char* type) {
+        begin_object();
+        field("schema", kJsonSchema);
+        return field("type", type);
+    }
+    
+    JsonWriter& begin_object() { return open('{'); }
+    JsonWriter& end_object() { return close('}'); }
+    JsonWriter& begin_array() { return open('['); }
+    JsonWriter& end_array() { return close(']'); }
+    
+    JsonWriter& key(const char* name) {
+        separate();
+        out_ << '"' << name << "\":";
+        after_key_ = true;
+        return *this;
+    }
+    
+    JsonWriter& value(std::string_view text) {
+        separate();
+        out_ << '"';
+        size_t plain = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            out_ << text.substr(plain, i - plain);
+            plain = i + 1;
+            if (c == '"' || c == '\\') {
+                out_ << '\\' << static_cast<char>(c);
+            } else if (c == '\n') {
+                out_ << "\\n";
+            } else if (c == '\t') {
+                out_ << "\\t";
+            } else {
+                static const char hex[] = "0123456789abcdef";
+                out_ << "\\u00" << hex[c >> 4] << hex[c & 15];
+            }
+        }
+        out_ << text.substr(plain) << '"';
+        return *this;
+    }
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(long long number) {
+        separate();
+        out_ << number;
+        return *this;
+    }
+    JsonWriter& value(int number) { return value(static_cast<long long>(number)); }
+    JsonWriter& value(double number) {
+        separate();
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number, std::chars_format::fixed, 2);
+        out_ << std::string_view(digits, result.ptr - digits);
+        return *this;
+    }
+    JsonWriter& value(bool flag) {
+        separate();
+        out_ << (flag ? "true" : "false");
+        return *this;
+    }
+    JsonWriter& null() {
+        separate();
+        out_ << "null";
+        return *this;
+    }
+    
+    template <typename T>
+    JsonWriter& field(const char* name, const T& v) {
+        return key(name).value(v);
+    }
+    // Empty text is unknown, written as null
+    JsonWriter& text_field(const char* name, std::string_view text) {
+        key(name);
+        return text.empty() ? null() : value(text);
+    }
+    
+    // End of a --ndjson record (or of a --json document)
+    void end_line() { out_ << '\n'; }
+    
+private:
+    // Only the innermost container's state is needed: a container is empty
+    // when opened, and its parent holds at least one value (it) once closed
+    JsonWriter& open(char bracket) {
+        separate();
+        out_ << bracket;
+        ++depth_;
+        first_ = true;
+        return *this;
+    }
+    
+    JsonWriter& close(char bracket) {
+        out_ << bracket;
+        --depth_;
+        first_ = false;
+        return *this;
+    }
+    
+    // Comma before every value but the first of its container
+    void separate() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (depth_ > 0 && !first_) {
+            out_ << ',';
+        }
+        first_ = false;
+    }
+    
+    TextBuffer& out_;
+    bool first_ = true;
+    int depth_ = 0;
+    bool after_key_ = false;
+};
+
+// "N/A" is the text view's placeholder, not a value
+std::string_view known(const std::string& text) {
+    return text == "N/A" ? std::string_view() : std::string_view(text);
+}
+
+// The fields of a "gpu" record, into an open object
+void write_gpu_fields(JsonWriter& json, const GPUInfo& gpu) {
+    json.field("index", gpu.index);
+    json.field("active", gpu.is_active);
+    json.text_field("node", gpu.node);
+    json.text_field("name", gpu.name);
+    json.text_field("vendor", gpu.vendor);
+    json.text_field("board", gpu.board);
+    json.text_field("driver", gpu.driver);
+    json.text_field("driver_version", known(gpu.driver_version));
+    json.text_field("pci_id", known(gpu.pci_id));
+}
+
+void write_gpu_json(TextBuffer& out, const GPUInfo& gpu) {
+    JsonWriter json(out);
+    json.begin_record("gpu");
+    write_gpu_fields(json, gpu);
+    json.end_object().end_line();
+}
+
+// GPUs as one "inventory" document (--json) or a "gpu" line each (--ndjson)
+void write_gpus_json(TextBuffer& out, const std::vector<GPUInfo>& gpus) {
+    JsonWriter json(out);
+    if (output_format == OutputFormat::Ndjson) {
+        for (const auto& gpu : gpus) {
+            write_gpu_json(out, gpu);
+        }
+        return;
+    }
+    json.begin_record("inventory").key("gpus").begin_array();
+    for (const auto& gpu : gpus) {
+        json.begin_object();
+        write_gpu_fields(json, gpu);
+        json.end_object();
+    }
+    json.end_array().end_object().end_line();
+}
+
+// Binary output (--format=cbor).
+//
+// The records above as CBOR maps with integer keys; docs/cbor-schema.md is
+// the reference and tools/cbor_decode.h reads it. Every record is a tag
+// 55799 (self-described CBOR) around a definite-length map whose first keys
+// are kCborSchema and kCborType. Unknown values are null, so each record
+// type has a fixed shape. Samples carry bare value arrays described once
+// by a "channels" record. Every value is written out, so any generic CBOR
+// decoder reads the records without knowing the schema.
+enum CborKey : uint8_t {
+    kCborSchema, kCborType, kCborIndex, kCborActive, kCborNode, kCborName, kCborVendor, kCborBoard,
+    kCborDriver, kCborDriverVersion, kCborPciId, kCborGpus, kCborTick, kCborTime, kCborReadNs,
+    kCborJitterNs, kCborJitterMeanNs, kCborJitterMaxNs, kCborCpu, kCborDropped, kCborValues,
+    kCborChannels, kCborGpu, kCborKind, kCborTotal, kCborSeries, kCborChannel, kCborWindows,
+    kCborSeconds, kCborMin, kCborMean, kCborMax, kCborTimeMs, kCborSocket, kCborShm, kCborGpuCount,
+    kCborHotplug, kCborTemperatureC, kCborBusyPercent,
+};
+
+enum CborRecord : uint8_t {
+    kCborGpuRecord = 1, kCborInventoryRecord, kCborChannelsRecord, kCborSampleRecord, kCborHistoryRecord,
+    kCborChangeRecord, kCborDaemonRecord, kCborPromptRecord,
+};
+
+constexpr int kCborSchemaVersion = 1;
+
+class CborWriter {
+public:
+    explicit CborWriter(TextBuffer& out) : out_(out) {}
+    
+    // Tag 55799 and a map of `fields` pairs after schema and type
+    CborWriter& begin_record(CborRecord type, size_t fields) {
+        out_ << std::string_view("\xd9\xd9\xf7", 3);
+        map(fields + 2);
+        key(kCborSchema).value(static_cast<uint64_t>(kCborSchemaVersion));
+        return key(kCborType).value(static_cast<uint64_t>(type));
+    }
+    
+    CborWriter& map(size_t pairs) { return head(5, pairs); }
+    CborWriter& array(size_t items) { return head(4, items); }
+    CborWriter& key(CborKey id) { return head(0, id); }
+    
+    CborWriter& value(uint64_t number) { return head(0, number); }
+    CborWriter& value(long long number) {
+        return number < 0 ? head(1, static_cast<uint64_t>(-(number + 1))) : head(0, static_cast<uint64_t>(number));
+    }
+    CborWriter& value(int number) { return value(static_cast<long long>(number)); }
+    CborWriter& value(bool flag) {
+        out_ << static_cast<char>(flag ? 0xf5 : 0xf4);
+        return *this;
+    }
+    CborWriter& value(std::string_view text) {
+        head(3, text.size());
+        out_ << text;
+        return *this;
+    }
+    CborWriter& null() {
+        out_ << static_cast<char>(0xf6);
+        return *this;
+    }
+    template <typename T>
+    CborWriter& field(CborKey id, const T& v) {
+        return key(id).value(v);
+    }
+    // Empty text is unknown, written as null
+    CborWriter& text_field(CborKey id, std::string_view text) {
+        key(id);
+        return text.empty() ? null() : value(text);
+    }
+    
+private:
+    // Major type and argument in the shortest form
+    CborWriter& head(uint8_t major, uint64_t argument) {
+        char bytes[9];
+        size_t size = 1;
+        const uint8_t type = static_cast<uint8_t>(major << 5);
+        if (argument < 24) {
+            bytes[0] = static_cast<char>(type | argument);
+        } else {
+            const int width = argument <= 0xff ? 1 : argument <= 0xffff ? 2 : argument <= 0xffffffff ? 4 : 8;
+            bytes[0] = static_cast<char>(type | (width == 1 ? 24 : width == 2 ? 25 : width == 4 ? 26 : 27));
+            for (int i = width - 1; i >= 0; --i) {
+                bytes[size++] = static_cast<char>(argument >> (8 * i));
+            }
+        }
+        out_ << std::string_view(bytes, size);
+        return *this;
+    }
+    
+    TextBuffer& out_;
+};
+
+// The nine fields of a GPU map (keys kCborIndex to kCborPciId)
+void write_gpu_fields(CborWriter& cbor, const GPUInfo& gpu) {
+    cbor.field(kCborIndex, gpu.index);
+    cbor.field(kCborActive, gpu.is_active);
+    cbor.text_field(kCborNode, gpu.node);
+    cbor.text_field(kCborName, gpu.name);
+    cbor.text_field(kCborVendor, gpu.vendor);
+    cbor.text_field(kCborBoard, gpu.board);
+    cbor.text_field(kCborDriver, gpu.driver);
+    cbor.text_field(kCborDriverVersion, known(gpu.driver_version));
+    cbor.text_field(kCborPciId, known(gpu.pci_id));
+}
+
+void write_gpu_cbor(TextBuffer& out, const GPUInfo& gpu) {
+    CborWriter cbor(out);
+    cbor.begin_record(kCborGpuRecord, 9);
+    write_gpu_fields(cbor, gpu);
+}
+
+void write_gpus_cbor(TextBuffer& out, const std::vector<GPUInfo>& gpus) {
+    CborWriter cbor(out);
+    cbor.begin_record(kCborInventoryRecord, 1).key(kCborGpus).array(gpus.size());
+    for (const auto& gpu : gpus) {
+        cbor.map(9);
+        write_gpu_fields(cbor, gpu);
+    }
+}
+
+// GPUs in the selected format
+void write_gpus(TextBuffer& out, const std::vector<GPUInfo>& gpus) {
+    if (output_format == OutputFormat::Cbor) {
+        write_gpus_cbor(out, gpus);
+    } else {
+        write_gpus_json(out, gpus);
+    }
+}
+
+void write_gpu(TextBuffer& out, const GPUInfo& gpu) {
+    if (output_format == OutputFormat::Cbor) {
+        write_gpu_cbor(out, gpu);
+    } else {
+        write_gpu_json(out, gpu);
+    }
+}
+
+// Helper function to print section headers
+void print_header(TextBuffer& out, std::string_view text) {
+    out << '\n' << Color::BOLD << Color::CYAN << text << Color::RESET << '\n';
+    out.fill('=', 50);
+    out << '\n';
+}
+
+// Helper function to print key-value pairs
+void print_field(TextBuffer& out, std::string_view key, std::string_view value) {
+    out << "  " << Color::GREEN << key << ": " << Color::RESET << value << '\n';
+}
+
+// Get vendor name from PCI ID
+std::string get_vendor_name(const std::string& vendor_id) {
+    std::string id = vendor_id;
+    // Convert to lowercase for comparison
+    std::transform(id.begin(), id.end(), id.begin(), ::tolower);
+    
+    if (id == "0x10de" || id == "10de") return "NVIDIA";
+    if (id == "0x1002" || id == "1002") return "AMD";
+    if (id == "0x8086" || id == "8086") return "Intel";
+    return "Unknown";
+}
+
+// Phase tracing.
+//
+// With WHATSMY_GPU_TRACE=<file> set, TraceSpan records one complete event
+// per scope into a buffer allocated once up front, and trace_flush()
+// writes them out as Chrome trace-event JSON (chrome://tracing, Perfetto).
+// Unset, a span costs the one well-predicted branch on trace_enabled.
+struct TraceEvent {
+    const char* name;      // Static string
+    int64_t start_ns;      // Since trace_epoch()
+    int64_t duration_ns;
+    uint32_t tid;
+    int card;              // GPU index, or -1
+    char detail[48];       // Attribute, driver or command; may be empty
+};
+
+constexpr size_t kTraceCapacity = 16384;
+
+bool trace_enabled = false;
+TraceEvent* trace_events = nullptr;
+std::atomic<size_t> trace_count{0};
+std::string trace_path;   // $WHATSMY_GPU_TRACE as this run saw it
+
+// Zero point of every timestamp: static initialization of the plugin
+const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+
+int64_t trace_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_epoch)
+        .count();
+}
+
+uint32_t trace_tid() {
+    static std::atomic<uint32_t> next{1};
+    thread_local uint32_t tid = next++;
+    return tid;
+}
+
+// Arm tracing from the environment for this run, before its first span.
+// The host may run us many times with the variable set, changed or unset,
+// so every run starts from an empty buffer; only the buffer itself is kept.
+void trace_init() {
+    const char* path = std::getenv("WHATSMY_GPU_TRACE");
+    trace_enabled = path && *path;
+    trace_path = trace_enabled ? path : "";
+    trace_count.store(0);
+    if (trace_enabled && !trace_events) {
+        trace_events = new TraceEvent[kTraceCapacity];
+    }
+}
+
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, int card = -1, std::string_view detail = {}) {
+        if (trace_enabled) {
+            begin(name, card, detail);
+        }
+    }
+    
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    
+    ~TraceSpan() {
+        if (event_) {
+            event_->duration_ns = trace_now_ns() - event_->start_ns;
+        }
+    }
+    
+private:
+    void begin(const char* name, int card, std::string_view detail) {
+        size_t slot = trace_count.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= kTraceCapacity) {
+            return;   // Counted, reported as dropped by trace_flush()
+        }
+        event_ = &trace_events[slot];
+        event_->name = name;
+        event_->tid = trace_tid();
+        event_->card = card;
+        size_t size = std::min(detail.size(), sizeof(event_->detail) - 1);
+        std::memcpy(event_->detail, detail.data(), size);
+        event_->detail[size] = '\0';
+        event_->duration_ns = 0;
+        event_->start_ns = trace_now_ns();
+    }
+    
+    TraceEvent* event_ = nullptr;
+};
+
+// Record a span that began before tracing could, e.g. at static init
+void trace_complete(const char* name, int64_t start_ns, int64_t end_ns) {
+    if (!trace_enabled) {
+        return;
+    }
+    size_t slot = trace_count.fetch_add(1, std::memory_order_relaxed);
+    if (slot < kTraceCapacity) {
+        trace_events[slot] = TraceEvent{name, start_ns, end_ns - start_ns, trace_tid(), -1, ""};
+    }
+}
+
+// Write every finished span to the file trace_init() was given, and disarm
+// until the next run. Spans still open (duration 0) are written as instants.
+void trace_flush() {
+    if (!trace_enabled || trace_path.empty()) {
+        return;
+    }
+    trace_enabled = false;
+    FILE* out = std::fopen(trace_path.c_str(), "w");
+    if (!out) {
+        std::cerr << Color::WARN << "Error: Cannot write trace to " << trace_path << "." << Color::WARN_END << "\n";
+        return;
+    }
+    const size_t recorded = trace_count.load();
+    const size_t count = std::min(recorded, kTraceCapacity);
+    std::fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    std::fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"whatsmy gpu\"}}");
+    for (size_t i = 0; i < count; ++i) {
+        const TraceEvent& event = trace_events[i];
+        std::fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+                     event.name, event.start_ns / 1000.0, event.duration_ns / 1000.0, event.tid);
+        if (event.card >= 0 || event.detail[0]) {
+            std::fprintf(out, ",\"args\":{");
+            if (event.card >= 0) {
+                std::fprintf(out, "\"card\":%d%s", event.card, event.detail[0] ? "," : "");
+            }
+            if (event.detail[0]) {
+                // Details are sysfs names and commands; escape the two JSON specials anyway
+                std::fprintf(out, "\"detail\":\"");
+                for (const char* c = event.detail; *c; ++c) {
+                    if (*c == '"' || *c == '\\') {
+                        std::fputc('\\', out);
+                    }
+                    std::fputc(static_cast<unsigned char>(*c) < 0x20 ? ' ' : *c, out);
+                }
+                std::fprintf(out, "\"");
+            }
+            std::fprintf(out, "}");
+        }
+        std::fprintf(out, "}");
+    }
+    if (recorded > count) {
+        std::fprintf(out, ",\n{\"name\":\"dropped %zu spans\",\"ph\":\"i\",\"s\":\"g\",\"ts\":0,\"pid\":1,\"tid\":0}",
+                     recorded - count);
+    }
+    std::fprintf(out, "\n]}\n");
+    std::fclose(out);
+}
+
+// Self-reported I/O and heap counters (whatsmy gpu --stats).
+//
+// Every sysfs/procfs I/O site charges its opens, reads, stats (stat,
+// fstat, access, readlink) and bytes read to the current phase. Heap use
+// is how glibc's mallinfo2() figures moved over the run; they cover the
+// whole process, so allocations the host makes meanwhile count too. The
+// test build of the plugin also counts its own allocations with the
+// operator new/delete below (WHATSMY_GPU_ALLOC_HOOKS). With --stats the
+// totals go to stderr when the command exits as plain "stats:" lines, so
+// a regression test can hold a release to budgets. Without it every site
+// costs one branch on stats_enabled.
+enum StatsPhase { kPhaseStartup, kPhaseCache, kPhaseEnumerate, kPhaseProbe, kPhaseTelemetry, kPhaseOutput, kPhaseCount };
+
+const char* const kPhaseNames[kPhaseCount] = {"startup", "cache", "enumerate", "probe", "telemetry", "output"};
+
+struct PhaseIo {
+    std::atomic<uint64_t> opens{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> stats{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+// All constant-initialized, so allocations made during static init count too
+bool stats_enabled = false;
+std::atomic<int> stats_phase{kPhaseStartup};
+PhaseIo stats_io[kPhaseCount];
+std::atomic<uint64_t> stats_allocs{0};
+std::atomic<uint64_t> stats_alloc_bytes{0};
+std::atomic<uint64_t> stats_frees{0};
+
+#if defined(PLATFORM_LINUX) && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define WHATSMY_GPU_MALLINFO2
+#endif
+
+// Bytes in allocated blocks, and bytes taken from the system for the heap
+// (mmapped blocks included in both)
+struct HeapUse {
+    int64_t in_use = 0;
+    int64_t arena = 0;
+};
+
+HeapUse heap_use() {
+    HeapUse use;
+#ifdef WHATSMY_GPU_MALLINFO2
+    struct mallinfo2 info = ::mallinfo2();
+    use.in_use = static_cast<int64_t>(info.uordblks + info.hblkhd);
+    use.arena = static_cast<int64_t>(info.arena + info.hblkhd);
+#endif
+    return use;
+}
+
+HeapUse stats_heap_start;   // When --stats was seen
+
+inline PhaseIo& stats_current() {
+    return stats_io[stats_phase.load(std::memory_order_relaxed)];
+}
+
+inline void stats_open() {
+    if (stats_enabled) {
+        stats_current().opens.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+inline void stats_stat() {
+    if (stats_enabled) {
+        stats_current().stats.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// One read() (or pread, getdents64, io_uring read); `result` as it returned
+inline void stats_read(int64_t result) {
+    if (stats_enabled) {
+        PhaseIo& io = stats_current();
+        io.reads.fetch_add(1, std::memory_order_relaxed);
+        if (result > 0) {
+            io.bytes.fetch_add(static_cast<uint64_t>(result), std::memory_order_relaxed);
+        }
+    }
+}
+
+// Charge I/O to `phase` until the end of the scope. The phase is global,
+// not per thread: probe workers and the sampler thread charge whatever
+// the command is doing, which is the phase that started them.
+class StatsPhaseScope {
+public:
+    explicit StatsPhaseScope(StatsPhase phase)
+        : previous_(stats_phase.exchange(phase, std::memory_order_relaxed)) {}
+    ~StatsPhaseScope() { stats_phase.store(previous_, std::memory_order_relaxed); }
+    
+    StatsPhaseScope(const StatsPhaseScope&) = delete;
+    StatsPhaseScope& operator=(const StatsPhaseScope&) = delete;
+    
+private:
+    int previous_;
+};
+
+// Turn the counters off and zero them, for the next run in this process
+void stats_reset() {
+    stats_enabled = false;
+    for (PhaseIo& io : stats_io) {
+        io.opens = 0;
+        io.reads = 0;
+        io.stats = 0;
+        io.bytes = 0;
+    }
+    stats_allocs = 0;
+    stats_alloc_bytes = 0;
+    stats_frees = 0;
+}
+
+// Print the counters to stderr, one figure per field:
+//   stats: <phase> opens <n> reads <n> stats <n> bytes <n>   (each phase, then "total")
+//   stats: heap in_use_delta <n> arena_delta <n>             (glibc; whole process, host included)
+//   stats: heap allocs <n> bytes <n> frees <n>               (test build only)
+//   stats: peak_rss_kib <n>                                  (whole process, host included)
+void stats_report() {
+    if (!stats_enabled) {
+        return;
+    }
+    uint64_t totals[4] = {0, 0, 0, 0};
+    for (int phase = 0; phase < kPhaseCount; ++phase) {
+        const PhaseIo& io = stats_io[phase];
+        uint64_t values[4] = {io.opens.load(), io.reads.load(), io.stats.load(), io.bytes.load()};
+        for (int i = 0; i < 4; ++i) {
+            totals[i] += values[i];
+        }
+        std::fprintf(stderr, "stats: %-9s opens %6llu reads %6llu stats %6llu bytes %9llu\n", kPhaseNames[phase],
+                     static_cast<unsigned long long>(values[0]), static_cast<unsigned long long>(values[1]),
+                     static_cast<unsigned long long>(values[2]), static_cast<unsigned long long>(values[3]));
+    }
+    std::fprintf(stderr, "stats: %-9s opens %6llu reads %6llu stats %6llu bytes %9llu\n", "total",
+                 static_cast<unsigned long long>(totals[0]), static_cast<unsigned long long>(totals[1]),
+                 static_cast<unsigned long long>(totals[2]), static_cast<unsigned long long>(totals[3]));
+#ifdef WHATSMY_GPU_MALLINFO2
+    const HeapUse heap = heap_use();
+    std::fprintf(stderr, "stats: heap in_use_delta %lld arena_delta %lld\n",
+                 static_cast<long long>(heap.in_use - stats_heap_start.in_use),
+                 static_cast<long long>(heap.arena - stats_heap_start.arena));
+#endif
+#ifdef WHATSMY_GPU_ALLOC_HOOKS
+    std::fprintf(stderr, "stats: heap allocs %llu bytes %llu frees %llu\n",
+                 static_cast<unsigned long long>(stats_allocs.load()),
+                 static_cast<unsigned long long>(stats_alloc_bytes.load()),
+                 static_cast<unsigned long long>(stats_frees.load()));
+#endif
+#ifdef PLATFORM_LINUX
+    rusage usage{};
+    if (::getrusage(RUSAGE_SELF, &usage) == 0) {
+        std::fprintf(stderr, "stats: peak_rss_kib %ld\n", usage.ru_maxrss);
+    }
+#endif
+}
+
+#ifdef WHATSMY_GPU_ALLOC_HOOKS
+// Replaceable global allocation functions, counting for --stats. Only the
+// test build of the plugin (tests/CMakeLists.txt) has them: it exports
+// plugin_run only, so these bind inside it whatever the host links. They
+// count the plugin's own allocations, not the host's or those made inside
+// libstdc++.so (whose blocks the plugin may still free, so frees can
+// exceed allocs). The shipped plugin leaves the host's allocator alone.
+// Over-aligned allocations keep the library's.
+inline void stats_alloc(size_t size) {
+    if (stats_enabled) {
+        stats_allocs.fetch_add(1, std::memory_order_relaxed);
+        stats_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+inline void stats_free(void* p) {
+    if (stats_enabled && p) {
+        stats_frees.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::free(p);
+}
+
+void* operator new(size_t size) {
+    stats_alloc(size);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    stats_alloc(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { stats_free(p); }
+void operator delete[](void* p) noexcept { stats_free(p); }
+void operator delete(void* p, size_t) noexcept { stats_free(p); }
+void operator delete[](void* p, size_t) noexcept { stats_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { stats_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { stats_free(p); }
+#endif
+
+#ifdef PLATFORM_LINUX
+// Static probe points.
+//
+// With <sys/sdt.h> at build time the plugin carries USDT probes under the
+// provider whatsmy_gpu, for bpftrace, perf or systemtap to attach to a
+// running process, e.g.
+//   bpftrace -e 'usdt:linux.so:whatsmy_gpu:attr__read { @[str(arg1)] = hist(arg3); }'
+//
+//   run__start(argc, command)             run__done(result, latency_ns)
+//   card__start(card, node)               card__done(card, node, latency_ns)
+//   attr__read(card, name, bytes, latency_ns)    card is -1 outside a card probe
+//   sample(tick, channels, latency_ns)    one per telemetry tick
+//
+// Each probe has a semaphore that the tracer raises while attached, and
+// arguments (clock reads included) are only computed behind it, so an
+// unattached probe is a load and a not-taken branch. Without the header,
+// or with WHATSMY_GPU_NO_USDT, the macros compile to nothing.
+#ifdef WHATSMY_GPU_USDT
+    #define GPU_USDT_SEMAPHORE(name) \
+        unsigned short whatsmy_gpu_##name##_semaphore __attribute__((unused, section(".probes")))
+    #define GPU_USDT_ACTIVE(name) __builtin_expect(whatsmy_gpu_##name##_semaphore != 0, 0)
+    #define GPU_USDT(name, ...) \
+        do { \
+            if (GPU_USDT_ACTIVE(name)) { \
+                STAP_PROBEV(whatsmy_gpu, name, __VA_ARGS__); \
+            } \
+        } while (0)
+#else
+    #define GPU_USDT_SEMAPHORE(name) static_assert(true, "")
+    #define GPU_USDT_ACTIVE(name) false
+    // Arguments stay type-checked, and count as used, but never run
+    #define GPU_USDT(name, ...) \
+        do { \
+            if (false) { \
+                usdt_discard(__VA_ARGS__); \
+            } \
+        } while (0)
+template <typename... Args>
+inline void usdt_discard(const Args&...) {}
+#endif
+
+GPU_USDT_SEMAPHORE(run__start);
+GPU_USDT_SEMAPHORE(run__done);
+GPU_USDT_SEMAPHORE(card__start);
+GPU_USDT_SEMAPHORE(card__done);
+GPU_USDT_SEMAPHORE(attr__read);
+GPU_USDT_SEMAPHORE(sample);
+
+// Card whose probe this thread is running, for attr__read
+thread_local int usdt_card = -1;
+
+// Root prefix for every sysfs/procfs path. Empty means the live system;
+// WHATSMY_GPU_ROOT points detection at a captured or synthetic tree instead.
+const std::string& linux_root() {
+    static const std::string root = [] {
+        const char* env = std::getenv("WHATSMY_GPU_ROOT");
+        std::string value = env ? env : "";
+        while (!value.empty() && value.back() == '/') {
+            value.pop_back();
+        }
+        return value;
+    }();
+    return root;
+}
+
+// Contents of one sysfs/procfs attribute, read into a stack buffer.
+// sysfs never returns more than a page per attribute, and the procfs files
+// we look at are far smaller, so one read() is always enough.
+struct SysfsAttr {
+    char data[4096];
+    size_t size = 0;
+    bool timed_out = false;   // The read missed its deadline (see ProbeDeadlines)
+    
+    std::string_view text() const { return std::string_view(data, size); }
+    
+    // First line without its trailing newline
+    std::string_view line() const {
+        std::string_view view = text();
+        size_t end = view.find('\n');
+        return end == std::string_view::npos ? view : view.substr(0, end);
+    }
+};
+
+// Shown in place of a field whose attribute missed its deadline
+const char* const kProbeTimeout = "unavailable (timeout)";
+
+// Deadlines for attribute reads. A wedged driver can block a sysfs read
+// forever, so when a deadline is set (whatsmy gpu --deadline) every
+// SysfsDir::read() is bounded by the sooner of now + per_attribute and
+// the overall deadline of the command. Unset, reads stay plain syscalls.
+struct ProbeDeadlines {
+    bool enabled = false;
+    std::chrono::nanoseconds per_attribute = std::chrono::nanoseconds::max();
+    std::chrono::steady_clock::time_point overall = std::chrono::steady_clock::time_point::max();
+    std::atomic<unsigned> timeouts{0};   // Reads that missed their deadline
+};
+
+ProbeDeadlines& probe_deadlines() {
+    static ProbeDeadlines deadlines;
+    return deadlines;
+}
+
+// Runs blocking attribute reads on a small pool so the caller can stop
+// waiting. The caller opens the attribute itself (opening does not wait on
+// the device; reading is what calls into the driver) and hands the fd to
+// an idle worker's request slot, then waits for the slot until its
+// deadline. A read that misses it is written off: the worker keeps the fd
+// and its slot, finishes (or stays blocked in the driver) on its own, and
+// frees both when the read returns. A wedged attribute costs one thread,
+// never the caller. stop() joins the idle workers before plugin_run
+// returns, so only written-off threads can outlive it.
+class AttributeReader {
+public:
+    static AttributeReader& instance() {
+        static AttributeReader reader;
+        return reader;
+    }
+    
+    ~AttributeReader() { stop(); }
+    
+    // Read `name` below `dir_fd` into attr unless `deadline` passes first.
+    // Returns false if it is missing, unreadable, empty or timed out
+    // (attr.timed_out tells the last apart).
+    bool read(int dir_fd, const char* name, SysfsAttr& attr, std::chrono::steady_clock::time_point deadline) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return timed_out(attr);
+        }
+        // O_NONBLOCK keeps a FIFO in place of an attribute from blocking the
+        // open; the worker clears it again before reading
+        int fd = ::openat(dir_fd, name, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+        stats_open();
+        if (fd < 0) {
+            return false;
+        }
+        
+        Worker* worker = acquire();
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        worker->fd = fd;
+        worker->state = kQueued;
+        worker->wake.notify_one();
+        if (!worker->done.wait_until(lock, deadline, [&] { return worker->state == kDone; })) {
+            // Stuck in the read: the worker owns its slot from now on and
+            // may outlive plugin_run
+            pin_library();
+            worker->thread.detach();
+            worker->state = kAbandoned;
+            return timed_out(attr);
+        }
+        attr.size = worker->size;
+        std::memcpy(attr.data, worker->data, worker->size);
+        worker->state = kIdle;
+        lock.unlock();
+        release(worker);
+        return attr.size > 0;
+    }
+    
+    // Join the idle workers. Called before plugin_run returns; no read()
+    // may be in flight.
+    void stop() {
+        std::vector<Worker*> idle;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle.swap(idle_);
+        }
+        for (Worker* worker : idle) {
+            {
+                std::lock_guard<std::mutex> lock(worker->mutex);
+                worker->state = kStopping;
+            }
+            worker->wake.notify_one();
+            worker->thread.join();
+            delete worker;
+        }
+    }
+    
+private:
+    enum State { kIdle, kQueued, kDone, kAbandoned, kStopping };
+    
+    // One thread and its request slot, reused from read to read
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wake;   // kQueued or kStopping
+        std::condition_variable done;   // kDone
+        State state = kIdle;
+        int fd = -1;
+        size_t size = 0;
+        char data[sizeof(SysfsAttr::data)];
+    };
+    
+    AttributeReader() = default;
+    
+    static bool timed_out(SysfsAttr& attr) {
+        attr.size = 0;
+        attr.timed_out = true;
+        probe_deadlines().timeouts.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    Worker* acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!idle_.empty()) {
+                Worker* worker = idle_.back();
+                idle_.pop_back();
+                return worker;
+            }
+        }
+        Worker* worker = new Worker();
+        worker->thread = std::thread(work, worker);
+        return worker;
+    }
+    
+    void release(Worker* worker) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(worker);
+    }
+    
+    // Touches nothing but its own slot, so a written-off worker never
+    // depends on the reader
+    static void work(Worker* worker) {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        for (;;) {
+            worker->wake.wait(lock, [&] { return worker->state == kQueued || worker->state == kStopping; });
+            if (worker->state == kStopping) {
+                return;
+            }
+            const int fd = worker->fd;
+            lock.unlock();
+            // sysfs ignores O_NONBLOCK anyway; anything else (a FIFO standing
+            // in for a wedged attribute) must block here as a driver would
+            ::fcntl(fd, F_SETFL, 0);
+            ssize_t n = ::read(fd, worker->data, sizeof(worker->data));
+            stats_read(n);
+            ::close(fd);
+            lock.lock();
+            worker->size = n > 0 ? static_cast<size_t>(n) : 0;
+            if (worker->state == kAbandoned) {
+                lock.unlock();
+                delete worker;
+                return;
+            }
+            worker->state = kDone;
+            worker->done.notify_one();
+        }
+    }
+    
+    // A written-off thread may outlive plugin_run; keep the plugin mapped
+    // so it never returns into unloaded code
+    static void pin_library() {
+        static std::once_flag once;
+        std::call_once(once, [] {
+            Dl_info info;
+            if (::dladdr(reinterpret_cast<void*>(&AttributeReader::pin_library), &info) && info.dli_fname) {
+                ::dlopen(info.dli_fname, RTLD_NOW | RTLD_NOLOAD | RTLD_NODELETE);
+            }
+        });
+    }
+    
+    std::mutex mutex_;
+    std::vector<Worker*> idle_;
+};
+
+// Filesystem operations the Linux detection path performs, over opaque
+// directory handles. SysfsDir holds a handle plus the backend it came from.
+// PosixSysfs is the real filesystem; MemorySysfs is a tree built in memory
+// so the parsers can be exercised and timed without hardware or a kernel.
+// SysfsDir calls the POSIX operations directly rather than through this
+// interface, so the real path pays no virtual dispatch.
+class SysfsBackend {
+public:
+    typedef void (*EntryFn)(void* context, std::string_view name);
+    
+    SysfsBackend() : id_(next_id()) {}
+    virtual ~SysfsBackend() = default;
+    
+    // Unique for the life of the process, unlike the backend's address
+    uint64_t id() const { return id_; }
+    
+    // Directory below `parent` (or absolute when parent is -1); -1 if none
+    virtual int open_dir(int parent, const char* path, bool listable) const = 0;
+    virtual void close_dir(int dir) const = 0;
+    // One read of a file below `dir`; -1 when it cannot be opened
+    virtual ssize_t read_file(int dir, const char* path, char* buffer, size_t size) const = 0;
+    // Target of a symlink below `dir`, not followed; -1 when not a link
+    virtual ssize_t read_link(int dir, const char* path, char* buffer, size_t size) const = 0;
+    // fn(context, name) per entry of `dir` except "." and ".."
+    virtual void list_dir(int dir, EntryFn fn, void* context) const = 0;
+    
+private:
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> next{0};
+        return next++;
+    }
+    
+    uint64_t id_;
+};
+
+class PosixSysfs final : public SysfsBackend {
+public:
+    static int open_dir_at(int parent, const char* path, bool listable) {
+        // Listable directories need a real read fd for getdents64; anything
+        // we only openat() through can be a cheaper O_PATH handle.
+        int flags = (listable ? O_RDONLY : O_PATH) | O_DIRECTORY | O_CLOEXEC;
+        stats_open();
+        return parent < 0 ? ::open(*path ? path : "/", flags) : ::openat(parent, path, flags);
+    }
+    
+    static ssize_t read_file_at(int dir, const char* path, char* buffer, size_t size) {
+        int fd = ::openat(dir, path, O_RDONLY | O_CLOEXEC);
+        stats_open();
+        if (fd < 0) {
+            return -1;
+        }
+        ssize_t n = ::read(fd, buffer, size);
+        stats_read(n);
+        ::close(fd);
+        return n;
+    }
+    
+    template <typename Fn>
+    static void list_dir_at(int dir, Fn fn) {
+        alignas(dirent64) char buffer[8192];
+        ::lseek(dir, 0, SEEK_SET);
+        for (;;) {
+            ssize_t n = ::getdents64(dir, buffer, sizeof(buffer));
+            stats_read(n);
+            if (n <= 0) {
+                break;
+            }
+            for (ssize_t offset = 0; offset < n;) {
+                auto* entry = reinterpret_cast<dirent64*>(buffer + offset);
+                offset += entry->d_reclen;
+                std::string_view name(entry->d_name);
+                if (name != "." && name != "..") {
+                    fn(name);
+                }
+            }
+        }
+    }
+    
+    static ssize_t read_link_at(int dir, const char* path, char* buffer, size_t size) {
+        stats_stat();
+        return ::readlinkat(dir, path, buffer, size);
+    }
+    
+    int open_dir(int parent, const char* path, bool listable) const override {
+        return open_dir_at(parent, path, listable);
+    }
+    void close_dir(int dir) const override { ::close(dir); }
+    ssize_t read_file(int dir, const char* path, char* buffer, size_t size) const override {
+        return read_file_at(dir, path, buffer, size);
+    }
+    ssize_t read_link(int dir, const char* path, char* buffer, size_t size) const override {
+        return read_link_at(dir, path, buffer, size);
+    }
+    void list_dir(int dir, EntryFn fn, void* context) const override {
+        list_dir_at(dir, [&](std::string_view name) { fn(context, name); });
+    }
+};
+
+const PosixSysfs& posix_sysfs() {
+    static const PosixSysfs fs;
+    return fs;
+}
+
+// A sysfs-like tree held in memory. Paths are '/'-separated and relative
+// to the tree's root; symlinks store their target text and are followed
+// like the kernel does (relative to the link's directory, ".." included).
+// Handles are node numbers, so nothing needs closing. Not thread-safe to
+// modify while being read.
+class MemorySysfs final : public SysfsBackend {
+public:
+    MemorySysfs() { nodes_.push_back(Node{Node::Dir, 0, "", {}}); }
+    
+    // Creates missing parent directories; replaces an existing node's contents
+    void add_file(const std::string& path, std::string contents) {
+        add(path, Node::File, std::move(contents));
+    }
+    void add_dir(const std::string& path) { add(path, Node::Dir, ""); }
+    void add_link(const std::string& path, std::string target) { add(path, Node::Link, std::move(target)); }
+    
+    // Copy a directory tree from disk (files, directories and symlinks)
+    void load(const std::string& root) {
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator();
+             it.increment(ec)) {
+            std::string path = it->path().string().substr(root.size() + 1);
+            if (it->is_symlink(ec)) {
+                add_link(path, fs::read_symlink(it->path(), ec).string());
+            } else if (it->is_directory(ec)) {
+                add_dir(path);
+            } else {
+                std::ifstream in(it->path(), std::ios::binary);
+                add_file(path, std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+            }
+        }
+    }
+    
+    size_t node_count() const { return nodes_.size(); }
+    
+    int open_dir(int parent, const char* path, bool) const override {
+        int node = resolve(parent < 0 ? 0 : parent, path, true);
+        return node >= 0 && nodes_[node].type == Node::Dir ? node : -1;
+    }
+    void close_dir(int) const override {}
+    ssize_t read_file(int dir, const char* path, char* buffer, size_t size) const override {
+        int node = resolve(dir, path, true);
+        if (node < 0 || nodes_[node].type != Node::File) {
+            return -1;
+        }
+        const std::string& data = nodes_[node].data;
+        size_t n = std::min(size, data.size());
+        std::memcpy(buffer, data.data(), n);
+        return static_cast<ssize_t>(n);
+    }
+    ssize_t read_link(int dir, const char* path, char* buffer, size_t size) const override {
+        int node = resolve(dir, path, false);
+        if (node < 0 || nodes_[node].type != Node::Link) {
+            return -1;
+        }
+        const std::string& target = nodes_[node].data;
+        size_t n = std::min(size, target.size());
+        std::memcpy(buffer, target.data(), n);
+        return static_cast<ssize_t>(n);
+    }
+    void list_dir(int dir, EntryFn fn, void* context) const override {
+        if (dir < 0 || nodes_[dir].type != Node::Dir) {
+            return;
+        }
+        for (const auto& child : nodes_[dir].children) {
+            fn(context, child.first);
+        }
+    }
+    
+private:
+    struct Node {
+        enum Type : uint8_t { File, Dir, Link } type;
+        int parent;
+        std::string data;                     // File contents or link target
+        std::map<std::string, int> children;  // Directories only
+    };
+    
+    void add(const std::string& path, Node::Type type, std::string data) {
+        int dir = 0;
+        size_t start = 0;
+        while (start < path.size()) {
+            size_t end = path.find('/', start);
+            bool last = end == std::string::npos;
+            std::string name = path.substr(start, last ? std::string::npos : end - start);
+            start = last ? path.size() : end + 1;
+            if (name.empty() || name == ".") {
+                continue;
+            }
+            auto it = nodes_[dir].children.find(name);
+            if (it == nodes_[dir].children.end()) {
+                int node = static_cast<int>(nodes_.size());
+                nodes_.push_back(Node{last ? type : Node::Dir, dir, last ? std::move(data) : "", {}});
+                nodes_[dir].children.emplace(name, node);
+                dir = node;
+            } else if (last) {
+                nodes_[it->second].type = type;
+                nodes_[it->second].data = std::move(data);
+                dir = it->second;
+            } else {
+                dir = it->second;
+            }
+        }
+    }
+    
+    // Node `path` names relative to `dir`; -1 if missing. Intermediate
+    // links are always followed, the last one only when `follow` is set.
+    int resolve(int dir, std::string_view path, bool follow, int depth = 0) const {
+        if (dir < 0 || depth > 40) {
+            return -1;
+        }
+        if (!path.empty() && path.front() == '/') {
+            dir = 0;
+        }
+        while (!path.empty()) {
+            size_t end = path.find('/');
+            std::string_view name = path.substr(0, end);
+            path = end == std::string_view::npos ? std::string_view() : path.substr(end + 1);
+            if (name.empty() || name == ".") {
+                continue;
+            }
+            if (name == "..") {
+                dir = nodes_[dir].parent;
+                continue;
+            }
+            if (nodes_[dir].type != Node::Dir) {
+                return -1;
+            }
+            auto it = nodes_[dir].children.find(std::string(name));
+            if (it == nodes_[dir].children.end()) {
+                return -1;
+            }
+            int node = it->second;
+            if (nodes_[node].type == Node::Link && (follow || !path.empty())) {
+                node = resolve(dir, nodes_[node].data, true, depth + 1);
+                if (node < 0) {
+                    return -1;
+                }
+            }
+            dir = node;
+        }
+        return dir;
+    }
+    
+    std::vector<Node> nodes_;
+};
+
+// Held directory handle that attributes are opened relative to with
+// openat(), so paths are never rebuilt and no stat is needed: a missing
+// attribute is simply an openat() that fails with ENOENT. Directories
+// opened below another one share its backend.
+class SysfsDir {
+public:
+    SysfsDir() = default;
+    
+    // Open an absolute directory path
+    explicit SysfsDir(const std::string& path, bool listable = false)
+        : fd_(PosixSysfs::open_dir_at(-1, path.c_str(), listable)) {}
+    
+    // Open an absolute directory path of `backend`
+    SysfsDir(const SysfsBackend& backend, const std::string& path, bool listable = false)
+        : fs_(&backend == &posix_sysfs() ? nullptr : &backend),
+          fd_(fs_ ? fs_->open_dir(-1, path.c_str(), listable) : PosixSysfs::open_dir_at(-1, path.c_str(), listable)) {}
+    
+    // Open a directory relative to another held directory
+    SysfsDir(const SysfsDir& parent, const char* name, bool listable = false)
+        : fs_(parent.fs_),
+          fd_(!parent.valid() ? -1
+              : fs_ ? fs_->open_dir(parent.fd_, name, listable)
+                    : PosixSysfs::open_dir_at(parent.fd_, name, listable)) {}
+    
+    SysfsDir(SysfsDir&& other) noexcept : fs_(other.fs_), fd_(other.fd_) { other.fd_ = -1; }
+    SysfsDir& operator=(SysfsDir&& other) noexcept {
+        std::swap(fs_, other.fs_);
+        std::swap(fd_, other.fd_);
+        return *this;
+    }
+    SysfsDir(const SysfsDir&) = delete;
+    SysfsDir& operator=(const SysfsDir&) = delete;
+    
+    ~SysfsDir() {
+        if (fd_ >= 0) {
+            if (fs_) {
+                fs_->close_dir(fd_);
+            } else {
+                ::close(fd_);
+            }
+        }
+    }
+    
+    bool valid() const { return fd_ >= 0; }
+    // A real file descriptor only when posix() holds
+    int fd() const { return fd_; }
+    bool posix() const { return fs_ == nullptr; }
+    const SysfsBackend& backend() const { return fs_ ? *fs_ : posix_sysfs(); }
+    
+    // Read an attribute with one openat() and one read().
+    // Returns false if it is missing, unreadable or empty.
+    bool read(const char* name, SysfsAttr& attr) const {
+        if (!GPU_USDT_ACTIVE(attr__read)) {
+            return read_attribute(name, attr);
+        }
+        const int64_t start = trace_now_ns();
+        bool ok = read_attribute(name, attr);
+        GPU_USDT(attr__read, usdt_card, name, attr.size, trace_now_ns() - start);
+        return ok;
+    }
+    
+    // Target of the symlink `name`, unresolved; -1 when there is none
+    ssize_t read_link(const char* name, char* buffer, size_t size) const {
+        if (fd_ < 0) {
+            return -1;
+        }
+        return fs_ ? fs_->read_link(fd_, name, buffer, size) : PosixSysfs::read_link_at(fd_, name, buffer, size);
+    }
+    
+    // Call fn(name) for every entry except "." and ".."
+    template <typename Fn>
+    void for_each_entry(Fn fn) const {
+        if (fd_ < 0) {
+            return;
+        }
+        if (fs_) {
+            fs_->list_dir(fd_, [](void* context, std::string_view name) { (*static_cast<Fn*>(context))(name); },
+                          &fn);
+            return;
+        }
+        PosixSysfs::list_dir_at(fd_, fn);
+    }
+    
+private:
+    bool read_attribute(const char* name, SysfsAttr& attr) const {
+        attr.size = 0;
+        attr.timed_out = false;
+        if (fd_ < 0) {
+            return false;
+        }
+        TraceSpan span("read", -1, name);
+        if (fs_) {
+            ssize_t n = fs_->read_file(fd_, name, attr.data, sizeof(attr.data));
+            attr.size = n > 0 ? static_cast<size_t>(n) : 0;
+            return n > 0;
+        }
+        const ProbeDeadlines& deadlines = probe_deadlines();
+        if (deadlines.enabled) {
+            auto now = std::chrono::steady_clock::now();
+            auto deadline = deadlines.overall;
+            if (deadlines.per_attribute < deadline - now) {
+                deadline = now + deadlines.per_attribute;
+            }
+            return AttributeReader::instance().read(fd_, name, attr, deadline);
+        }
+        ssize_t n = PosixSysfs::read_file_at(fd_, name, attr.data, sizeof(attr.data));
+        if (n <= 0) {
+            return false;
+        }
+        attr.size = static_cast<size_t>(n);
+        return true;
+    }
+    
+    const SysfsBackend* fs_ = nullptr;   // nullptr: the real filesystem, called directly
+    int fd_ = -1;
+};
+
+// Minimal io_uring driven through the raw syscalls (no liburing): one
+// submission/completion ring pair, used to batch small sysfs operations
+// so a probe round costs a few io_uring_enter() calls instead of an
+// openat/read/close triple per attribute. valid() is false when the
+// kernel lacks io_uring or a seccomp filter or sysctl blocks it.
+class IoUring {
+public:
+    explicit IoUring(unsigned entries) {
+        io_uring_params params{};
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            return;
+        }
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+        sq_ring_ = map(sq_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single ? sq_ring_ : map(cq_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+        if (!sq_ring_ || !cq_ring_ || !sqes_) {
+            release();
+            return;
+        }
+        char* sq = static_cast<char*>(sq_ring_);
+        char* cq = static_cast<char*>(cq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        entries_ = params.sq_entries;
+        local_tail_ = *sq_tail_;
+    }
+    
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    
+    ~IoUring() { release(); }
+    
+    bool valid() const { return fd_ >= 0; }
+    unsigned entries() const { return entries_; }
+    
+    // Whether the kernel implements every opcode in `ops`. Kernels 5.1-5.5
+    // set up a ring but fail newer opcodes (openat, read, close) with
+    // -EINVAL on each completion; they also predate IORING_REGISTER_PROBE,
+    // so a failed probe means "no".
+    bool supports(std::initializer_list<uint8_t> ops) const {
+        constexpr unsigned kProbeOps = 64;
+        alignas(io_uring_probe) char storage[sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op)] = {};
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage);
+        if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+            return false;
+        }
+        for (uint8_t op : ops) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    uint64_t enters() const { return enters_; }
+    
+    void prep_openat(int dir_fd, const char* name, int flags, uint64_t user_data) {
+        io_uring_sqe* sqe = next_sqe(IORING_OP_OPENAT, dir_fd, user_data);
+        sqe->addr = reinterpret_cast<uint64_t>(name);
+        sqe->open_flags = static_cast<uint32_t>(flags);
+    }
+    
+    void prep_read(int fd, void* buffer, unsigned size, uint64_t user_data) {
+        io_uring_sqe* sqe = next_sqe(IORING_OP_READ, fd, user_data);
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = size;
+        sqe->off = 0;
+    }
+    
+    void prep_close(int fd, uint64_t user_data) { next_sqe(IORING_OP_CLOSE, fd, user_data); }
+    
+    // Submit everything prepared since the last call and wait for all of
+    // it; fn(user_data, result) runs once per completion. At most
+    // entries() operations may be prepared per call. Returns false when
+    // the kernel refuses the first submission, with nothing in flight.
+    template <typename Fn>
+    bool submit_and_wait(Fn fn) {
+        const unsigned count = local_tail_ - *sq_tail_;
+        __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+        unsigned to_submit = count, done = 0;
+        while (done < count) {
+            int submitted = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, to_submit, count - done,
+                                                       IORING_ENTER_GETEVENTS, nullptr, 0));
+            ++enters_;
+            if (submitted < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (to_submit == count) {
+                    // Nothing reached the kernel; take the entries back
+                    local_tail_ -= count;
+                    __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+                    return false;
+                }
+                // Operations are in flight and own their buffers; keep waiting
+                to_submit = 0;
+                continue;
+            }
+            to_submit -= std::min<unsigned>(static_cast<unsigned>(submitted), to_submit);
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head, ++done) {
+                const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                fn(cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        }
+        return true;
+    }
+    
+private:
+    io_uring_sqe* next_sqe(uint8_t opcode, int fd, uint64_t user_data) {
+        unsigned index = local_tail_++ & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->user_data = user_data;
+        sq_array_[index] = index;
+        return sqe;
+    }
+    
+    void* map(size_t size, off_t offset) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+    
+    void release() {
+        if (sqes_) {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ && cq_ring_ != sq_ring_) {
+            ::munmap(cq_ring_, cq_size_);
+        }
+        if (sq_ring_) {
+            ::munmap(sq_ring_, sq_size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        sqes_ = nullptr;
+        sq_ring_ = cq_ring_ = nullptr;
+        fd_ = -1;
+    }
+    
+    int fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sq_size_ = 0, cq_size_ = 0, sqes_size_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned entries_ = 0;
+    unsigned local_tail_ = 0;
+    uint64_t enters_ = 0;
+};
+
+// Whether sysfs batches go through io_uring: WHATSMY_GPU_IO=uring opts
+// in, anything else (or io_uring being unavailable) keeps plain syscalls
+bool sysfs_uring_requested() {
+    static const bool requested = [] {
+        const char* env = std::getenv("WHATSMY_GPU_IO");
+        return env && std::strcmp(env, "uring") == 0;
+    }();
+    return requested;
+}
+
+// One attribute for SysfsBatch::read_all(): opened by name relative to
+// dir_fd, or read at offset 0 from fd when dir_fd is -1 (an attribute
+// that is held open). Partial or failed reads leave result <= 0.
+struct SysfsRead {
+    int dir_fd;
+    const char* name;
+    int fd;
+    char* buffer;
+    size_t capacity;
+    ssize_t result = 0;   // Bytes read, or -errno
+};
+
+// Reads a set of attributes as one batch. With io_uring every phase
+// (opens, reads, closes) is a single submission; otherwise each attribute
+// costs its own syscalls, the same as SysfsDir::read().
+class SysfsBatch {
+public:
+    static constexpr unsigned kRingEntries = 256;
+    
+    explicit SysfsBatch(bool use_uring = sysfs_uring_requested()) {
+        if (use_uring) {
+            ring_.reset(new IoUring(kRingEntries));
+            if (!ring_->valid() || !ring_->supports({IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE})) {
+                ring_.reset();
+            }
+        }
+    }
+    
+    bool uring() const { return ring_ != nullptr; }
+    uint64_t uring_enters() const { return ring_ ? ring_->enters() : 0; }
+    
+    void read_all(SysfsRead* reads, size_t count) {
+        if (ring_) {
+            for (size_t first = 0; first < count; first += ring_->entries()) {
+                size_t chunk = std::min<size_t>(ring_->entries(), count - first);
+                if (!read_chunk(reads + first, chunk)) {
+                    // Refused by the kernel (seccomp, sysctl, an opcode it
+                    // does not know): stay on syscalls
+                    ring_.reset();
+                    read_sync(reads + first, count - first);
+                    return;
+                }
+            }
+            return;
+        }
+        read_sync(reads, count);
+    }
+    
+private:
+    static void read_sync(SysfsRead* reads, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            SysfsRead& read = reads[i];
+            if (read.dir_fd < 0) {
+                read.result = ::pread(read.fd, read.buffer, read.capacity, 0);
+                stats_read(read.result);
+                continue;
+            }
+            int fd = ::openat(read.dir_fd, read.name, O_RDONLY | O_CLOEXEC);
+            stats_open();
+            if (fd < 0) {
+                read.result = -errno;
+                continue;
+            }
+            read.result = ::read(fd, read.buffer, read.capacity);
+            stats_read(read.result);
+            ::close(fd);
+        }
+    }
+    
+    bool read_chunk(SysfsRead* reads, size_t count) {
+        // Opens for the attributes read by name. openat() itself never
+        // fails a sysfs name with EINVAL or EOPNOTSUPP, so either one means
+        // the ring cannot run the operation; the chunk is redone with syscalls.
+        bool opened = false, unsupported = false;
+        for (size_t i = 0; i < count; ++i) {
+            if (reads[i].dir_fd >= 0) {
+                ring_->prep_openat(reads[i].dir_fd, reads[i].name, O_RDONLY | O_CLOEXEC, i);
+                opened = true;
+            }
+        }
+        if (opened && !ring_->submit_and_wait([&](uint64_t i, int result) {
+                stats_open();
+                reads[i].fd = result;
+                reads[i].result = result < 0 ? result : 0;
+                unsupported |= result == -EINVAL || result == -EOPNOTSUPP;
+            })) {
+            return false;
+        }
+        if (unsupported) {
+            close_opened(reads, count);
+            return false;
+        }
+        
+        // Reads, for every attribute that has an fd now
+        for (size_t i = 0; i < count; ++i) {
+            if (reads[i].fd >= 0) {
+                ring_->prep_read(reads[i].fd, reads[i].buffer, static_cast<unsigned>(reads[i].capacity), i);
+            }
+        }
+        if (!ring_->submit_and_wait([&](uint64_t i, int result) {
+                stats_read(result);
+                reads[i].result = result;
+            })) {
+            close_opened(reads, count);
+            return false;
+        }
+        
+        // Closes for what the first phase opened
+        if (opened) {
+            for (size_t i = 0; i < count; ++i) {
+                if (reads[i].dir_fd >= 0 && reads[i].fd >= 0) {
+                    ring_->prep_close(reads[i].fd, i);
+                }
+            }
+            if (!ring_->submit_and_wait([](uint64_t, int) {})) {
+                close_opened(reads, count);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                if (reads[i].dir_fd >= 0) {
+                    reads[i].fd = -1;
+                }
+            }
+        }
+        return true;
+    }
+    
+    static void close_opened(SysfsRead* reads, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (reads[i].dir_fd >= 0 && reads[i].fd >= 0) {
+                ::close(reads[i].fd);
+                reads[i].fd = -1;
+            }
+        }
+    }
+    
+    std::unique_ptr<IoUring> ring_;
+};
+
+// Number of worker threads used to probe cards in parallel.
+// WHATSMY_GPU_PROBE_THREADS overrides the default (1 forces serial probing).
+unsigned probe_workers() {
+    static const unsigned workers = [] {
+        if (const char* env = std::getenv("WHATSMY_GPU_PROBE_THREADS")) {
+            int value = std::atoi(env);
+            if (value > 0) {
+                return static_cast<unsigned>(value);
+            }
+        }
+        unsigned hw = std::thread::hardware_concurrency();
+        return std::clamp(hw, 2u, 8u);
+    }();
+    return workers;
+}
+
+// Card number of a "cardN" entry, used to keep GPU indices stable
+int card_number(const std::string& card_name) {
+    return std::atoi(card_name.c_str() + 4);
+}
+
+// Sorted names of every /sys/class/drm entry
+std::vector<std::string> list_drm_entries(const SysfsDir& drm) {
+    std::vector<std::string> entries;
+    drm.for_each_entry([&](std::string_view name) { entries.emplace_back(name); });
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+// card* entries are GPUs; card*-HDMI, card*-DP, etc. are their connectors
+bool is_card_entry(std::string_view name) {
+    return name.compare(0, 4, "card") == 0 && name.find('-') == std::string_view::npos;
+}
+
+// Enumerate GPUs from the DRM entries without reading any attributes.
+// Only index, is_active and node are filled in.
+std::vector<GPUInfo> enumerate_gpus_linux(const std::vector<std::string>& entries) {
+    std::vector<std::string> cards;
+    for (const auto& name : entries) {
+        if (is_card_entry(name)) {
+            cards.push_back(name);
+        }
+    }
+    std::sort(cards.begin(), cards.end(), [](const std::string& a, const std::string& b) {
+        return card_number(a) < card_number(b);
+    });
+    
+    std::vector<GPUInfo> gpus(cards.size());
+    for (size_t i = 0; i < cards.size(); ++i) {
+        gpus[i].node = cards[i];
+        gpus[i].index = static_cast<int>(i);
+        gpus[i].is_active = (i == 0); // First GPU is typically active
+    }
+    return gpus;
+}
+
+// Extract the driver version from /proc/driver/nvidia/version, e.g.
+// "NVRM version: NVIDIA UNIX x86_64 Kernel Module  550.54.15  Tue Mar ..."
+std::string parse_nvidia_version(std::string_view text) {
+    size_t pos = text.find("Kernel Module");
+    if (pos == std::string_view::npos) {
+        return "";
+    }
+    std::string_view remainder = text.substr(pos + 13); // Skip "Kernel Module"
+    size_t begin = remainder.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        return "";
+    }
+    remainder = remainder.substr(begin);
+    return std::string(remainder.substr(0, remainder.find_first_of(" \t\n")));
+}
+
+// Kernel driver as resolved by DriverRegistry
+struct DriverInfo {
+    std::string module;   // Module providing the driver; empty if built in
+    std::string version;
+};
+
+// Driver versions, resolved once per driver per process.
+//
+// Every card bound to the same driver shares one resolution, so probing
+// costs O(drivers) rather than O(GPUs): follow the device's driver/module
+// link to the module name, then take the NVIDIA proc file for nvidia,
+// otherwise /sys/module/<mod>/version or srcversion, and finally the kernel
+// release for in-tree or built-in drivers that carry no version of their
+// own. One registry exists per sysfs root and backend.
+class DriverRegistry {
+public:
+    static DriverRegistry& for_root(const std::string& root, const SysfsBackend& fs = posix_sysfs()) {
+        static std::mutex mutex;
+        static std::map<std::pair<uint64_t, std::string>, std::unique_ptr<DriverRegistry>> registries;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& registry = registries[std::make_pair(fs.id(), root)];
+        if (!registry) {
+            registry.reset(new DriverRegistry());
+        }
+        return *registry;
+    }
+    
+    // Version of `driver`, which is bound to the device held by `device`
+    std::string version(const SysfsDir& root_dir, const SysfsDir& device, const std::string& driver) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = drivers_.find(driver);
+        if (it == drivers_.end()) {
+            DriverInfo info = resolve(root_dir, device, driver);
+            if (info.version == kProbeTimeout) {
+                // Not cached: the next probe may get an answer
+                return info.version;
+            }
+            it = drivers_.emplace(driver, std::move(info)).first;
+        }
+        return it->second.version;
+    }
+    
+    // Drop what is known about a module that was unloaded or reloaded
+    void forget_module(const std::string& module) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = drivers_.begin(); it != drivers_.end();) {
+            if (it->second.module == module || it->first == module) {
+                it = drivers_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+private:
+    DriverRegistry() = default;
+    
+    static DriverInfo resolve(const SysfsDir& root_dir, const SysfsDir& device, const std::string& driver) {
+        DriverInfo info;
+        char target[256];
+        ssize_t n = device.read_link("driver/module", target, sizeof(target) - 1);
+        if (n > 0) {
+            std::string_view link(target, static_cast<size_t>(n));
+            info.module = std::string(link.substr(link.rfind('/') + 1));
+        }
+        
+        SysfsAttr attr;
+        // A source that times out could have been the answer, so stop there
+        auto timed_out = [&] {
+            if (attr.timed_out) {
+                info.version = kProbeTimeout;
+            }
+            return attr.timed_out;
+        };
+        if ((info.module == "nvidia" || driver == "nvidia") &&
+            root_dir.read("proc/driver/nvidia/version", attr)) {
+            info.version = parse_nvidia_version(attr.text());
+            if (!info.version.empty()) {
+                return info;
+            }
+        }
+        if (timed_out()) {
+            return info;
+        }
+        if (!info.module.empty()) {
+            std::string module_path = "sys/module/" + info.module;
+            SysfsDir module(root_dir, module_path.c_str());
+            if ((module.read("version", attr) || (!timed_out() && module.read("srcversion", attr))) &&
+                !attr.line().empty()) {
+                info.version = std::string(attr.line());
+                return info;
+            }
+            if (timed_out()) {
+                return info;
+            }
+        }
+        if (root_dir.read("proc/sys/kernel/osrelease", attr)) {
+            info.version = std::string(attr.line());
+        }
+        timed_out();
+        return info;
+    }
+    
+    std::mutex mutex_;
+    std::map<std::string, DriverInfo> drivers_;
+};
+
+// Parse exactly four hex digits
+bool parse_hex16(std::string_view text, uint16_t& value) {
+    if (text.size() < 4) {
+        return false;
+    }
+    uint32_t result = 0;
+    for (char c : text.substr(0, 4)) {
+        uint32_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        result = result * 16 + digit;
+    }
+    value = static_cast<uint16_t>(result);
+    return true;
+}
+
+// Parse a "VVVV:DDDD" hex pair as found in PCI_ID and PCI_SUBSYS_ID
+bool parse_pci_pair(std::string_view text, uint16_t& first, uint16_t& second) {
+    return text.size() == 9 && text[4] == ':' && parse_hex16(text, first) &&
+           parse_hex16(text.substr(5), second);
+}
+
+// PCI names are keyed by (vendor, device, subvendor, subdevice). Vendor and
+// device entries use the wildcard for the parts they leave out; 0xffff is
+// never a valid vendor ID, so they cannot collide with subsystem entries.
+constexpr uint16_t kPciAny = 0xffff;
+
+uint64_t pci_key(uint16_t vendor, uint16_t device, uint16_t subvendor, uint16_t subdevice) {
+    return (uint64_t(vendor) << 48) | (uint64_t(device) << 32) | (uint64_t(subvendor) << 16) | subdevice;
+}
+
+// A resolved PCI name, copied into a caller-owned buffer
+struct PciName {
+    char data[256];
+    size_t size = 0;
+    
+    std::string_view text() const { return std::string_view(data, size); }
+    
+    void assign(std::string_view value) {
+        size = std::min(value.size(), sizeof(data));
+        std::memcpy(data, value.data(), size);
+    }
+};
+
+// Cache directory shared by everything whatsmy caches on disk:
+// $XDG_CACHE_HOME/whatsmy, else ~/.cache/whatsmy. Empty when
+// WHATSMY_GPU_NO_CACHE is set or there is no home directory.
+std::string whatsmy_cache_dir() {
+    const char* disabled = std::getenv("WHATSMY_GPU_NO_CACHE");
+    if (disabled && *disabled && std::strcmp(disabled, "0") != 0) {
+        return "";
+    }
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg == '/') {
+        return std::string(xdg) + "/whatsmy";
+    }
+    const char* home = std::getenv("HOME");
+    if (home && *home == '/') {
+        return std::string(home) + "/.cache/whatsmy";
+    }
+    return "";
+}
+
+// Create the missing parent directories of `path`; true if the last one
+// is writable
+bool make_parent_dirs(const std::string& path) {
+    size_t slash = path.find('/', 1);
+    for (; slash != std::string::npos; slash = path.find('/', slash + 1)) {
+        ::mkdir(path.substr(0, slash).c_str(), 0700);
+    }
+    size_t last = path.rfind('/');
+    return last != std::string::npos && ::access(last == 0 ? "/" : path.substr(0, last).c_str(), W_OK) == 0;
+}
+
+// Write a file to a temporary and rename() it into place, so concurrent
+// readers see either the old file or the new one, never a mix. Missing
+// parent directories are created on the way.
+bool write_file_atomic(const std::string& path, const char* data, size_t size) {
+    make_parent_dirs(path);
+    
+    std::string tmp = path + ".tmp." + std::to_string(::getpid());
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    stats_open();
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::write(fd, data, size) == static_cast<ssize_t>(size);
+    ok = (::close(fd) == 0) && ok;
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Runtime pci.ids resolver.
+//
+// Distributions ship a full pci.ids (about 1.3 MB of text) that knows
+// devices newer than the tables compiled in, so it answers what the tables
+// miss. The first such lookup parses it once into a sorted binary index
+// stored as <cache dir>/pci-ids.idx, tagged with the source's size and
+// mtime; later processes mmap that index and binary search it without
+// touching the text. Without a writable cache dir the text is not parsed
+// at all. WHATSMY_GPU_PCI_IDS names a specific pci.ids file.
+//
+// Index layout (host byte order): PciIndexHeader, then `count`
+// PciIndexEntry records sorted by key, then the name bytes they reference.
+const char kPciIndexMagic[8] = {'W', 'M', 'P', 'C', 'I', 'I', 'D', 'X'};
+const uint32_t kPciIndexVersion = 1;
+
+struct PciIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint32_t strings_size;
+    uint32_t reserved;
+};
+
+struct PciIndexEntry {
+    uint64_t key;
+    uint32_t name_offset;
+    uint32_t name_size;
+};
+
+// System pci.ids, or "" if none is installed
+std::string pci_ids_source_path() {
+    if (const char* env = std::getenv("WHATSMY_GPU_PCI_IDS")) {
+        return env;
+    }
+    static const char* const candidates[] = {
+        "/usr/share/hwdata/pci.ids", "/usr/share/misc/pci.ids", "/usr/share/pci.ids"};
+    for (const char* candidate : candidates) {
+        std::string path = linux_root() + candidate;
+        stats_stat();
+        if (::access(path.c_str(), R_OK) == 0) {
+            return path;
+        }
+    }
+    return "";
+}
+
+// Parse pci.ids text into index entries plus a string pool. Names are
+// stored once per distinct entry; the class section at the end is skipped.
+void parse_pci_ids(std::string_view text, std::vector<PciIndexEntry>& entries, std::string& strings) {
+    uint16_t vendor = 0, device = 0;
+    bool have_vendor = false, have_device = false;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line.compare(0, 2, "C ") == 0) {
+            break;
+        }
+        
+        uint64_t key;
+        size_t name_pos;
+        uint16_t subvendor, subdevice;
+        if (line.compare(0, 2, "\t\t") == 0) {
+            if (!have_device || !parse_hex16(line.substr(2), subvendor) || line.size() < 11 ||
+                !parse_hex16(line.substr(7), subdevice)) {
+                continue;
+            }
+            key = pci_key(vendor, device, subvendor, subdevice);
+            name_pos = 11;
+        } else if (line[0] == '\t') {
+            if (!have_vendor || !parse_hex16(line.substr(1), device)) {
+                continue;
+            }
+            have_device = true;
+            key = pci_key(vendor, device, kPciAny, kPciAny);
+            name_pos = 5;
+        } else {
+            have_vendor = parse_hex16(line, vendor);
+            have_device = false;
+            if (!have_vendor) {
+                continue;
+            }
+            key = pci_key(vendor, kPciAny, kPciAny, kPciAny);
+            name_pos = 4;
+        }
+        
+        size_t begin = line.find_first_not_of(' ', name_pos);
+        if (begin == std::string_view::npos) {
+            continue;
+        }
+        std::string_view name = line.substr(begin);
+        entries.push_back({key, static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(name.size())});
+        strings.append(name);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const PciIndexEntry& a, const PciIndexEntry& b) { return a.key < b.key; });
+}
+
+class PciIdsIndex {
+public:
+    // Process-wide index, opened or built on first use
+    static const PciIdsIndex& instance() {
+        static const PciIdsIndex index(pci_ids_source_path(), [] {
+            std::string dir = whatsmy_cache_dir();
+            return dir.empty() ? dir : dir + "/pci-ids.idx";
+        }());
+        return index;
+    }
+    
+    // Map the cached index for `source` if its tag matches, else build it
+    // and store it at `cache_path`. Parsing the text costs about 10 ms, so
+    // without a writable cache the index stays unavailable rather than
+    // charging that to every process; the compiled-in tables still answer.
+    PciIdsIndex(const std::string& source, const std::string& cache_path) {
+        struct stat st;
+        if (source.empty() || cache_path.empty()) {
+            return;
+        }
+        stats_stat();
+        if (::stat(source.c_str(), &st) != 0) {
+            return;
+        }
+        if (map_index(cache_path, st) || !make_parent_dirs(cache_path)) {
+            return;
+        }
+        build_index(source, st);
+        if (!owned_.empty()) {
+            write_file_atomic(cache_path, owned_.data(), owned_.size());
+        }
+    }
+    
+    PciIdsIndex(const PciIdsIndex&) = delete;
+    PciIdsIndex& operator=(const PciIdsIndex&) = delete;
+    
+    ~PciIdsIndex() {
+        if (mapping_) {
+            ::munmap(mapping_, mapping_size_);
+        }
+    }
+    
+    bool available() const { return count_ > 0; }
+    
+    // Binary search for an exact key
+    bool lookup(uint64_t key, std::string_view& name) const {
+        const PciIndexEntry* end = entries_ + count_;
+        const PciIndexEntry* it = std::lower_bound(entries_, end, key,
+            [](const PciIndexEntry& entry, uint64_t value) { return entry.key < value; });
+        if (it == end || it->key != key) {
+            return false;
+        }
+        name = std::string_view(strings_ + it->name_offset, it->name_size);
+        return true;
+    }
+    
+private:
+    static int64_t mtime_ns(const struct stat& st) {
+        return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+    
+    bool map_index(const std::string& path, const struct stat& source) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        stats_open();
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        void* mapping = MAP_FAILED;
+        stats_stat();
+        if (::fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(PciIndexHeader))) {
+            mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        if (!attach(static_cast<const char*>(mapping), static_cast<size_t>(st.st_size), source)) {
+            ::munmap(mapping, static_cast<size_t>(st.st_size));
+            return false;
+        }
+        mapping_ = mapping;
+        mapping_size_ = static_cast<size_t>(st.st_size);
+        return true;
+    }
+    
+    void build_index(const std::string& source, const struct stat& st) {
+        int fd = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        stats_open();
+        if (fd < 0) {
+            return;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void* text = size > 0 ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (text == MAP_FAILED) {
+            return;
+        }
+        std::vector<PciIndexEntry> entries;
+        std::string strings;
+        parse_pci_ids(std::string_view(static_cast<const char*>(text), size), entries, strings);
+        ::munmap(text, size);
+        
+        PciIndexHeader header{};
+        std::memcpy(header.magic, kPciIndexMagic, sizeof(header.magic));
+        header.version = kPciIndexVersion;
+        header.count = static_cast<uint32_t>(entries.size());
+        header.source_size = static_cast<uint64_t>(st.st_size);
+        header.source_mtime_ns = mtime_ns(st);
+        header.strings_size = static_cast<uint32_t>(strings.size());
+        
+        owned_.reserve(sizeof(header) + entries.size() * sizeof(PciIndexEntry) + strings.size());
+        owned_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        owned_.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PciIndexEntry));
+        owned_.append(strings);
+        if (!attach(owned_.data(), owned_.size(), st)) {
+            owned_.clear();
+        }
+    }
+    
+    // Validate an index image against the source it should describe
+    bool attach(const char* data, size_t size, const struct stat& source) {
+        PciIndexHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, kPciIndexMagic, sizeof(header.magic)) != 0 ||
+            header.version != kPciIndexVersion ||
+            header.source_size != static_cast<uint64_t>(source.st_size) ||
+            header.source_mtime_ns != mtime_ns(source) ||
+            size != sizeof(header) + uint64_t(header.count) * sizeof(PciIndexEntry) + header.strings_size) {
+            return false;
+        }
+        const auto* entries = reinterpret_cast<const PciIndexEntry*>(data + sizeof(header));
+        for (uint32_t i = 0; i < header.count; ++i) {
+            if (uint64_t(entries[i].name_offset) + entries[i].name_size > header.strings_size) {
+                return false;
+            }
+        }
+        entries_ = entries;
+        count_ = header.count;
+        strings_ = data + sizeof(header) + uint64_t(header.count) * sizeof(PciIndexEntry);
+        return true;
+    }
+    
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::string owned_;  // Index built in memory this run
+    const PciIndexEntry* entries_ = nullptr;
+    uint32_t count_ = 0;
+    const char* strings_ = nullptr;
+};
+
+#ifdef WHATSMY_GPU_PCI_TABLES
+// Generated at build time by tools/pciids_gen.cpp from data/pci.ids.display
+#include "pci_names.inc"
+
+uint32_t read_pci_varint(const unsigned char*& p) {
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        unsigned char byte = *p++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+// Look up a key in the compiled-in tables: two hashes, one key compare,
+// then a walk of at most one front-coded block
+bool lookup_pci_table(uint64_t key, PciName& name) {
+    uint32_t bucket = static_cast<uint32_t>(PciTable::mix(key, 0) % PciTable::kBuckets);
+    uint32_t slot = static_cast<uint32_t>(PciTable::mix(key, PciTable::kSeeds[bucket]) % PciTable::kCount);
+    if (PciTable::kKeys[slot] != key) {
+        return false;
+    }
+    
+    uint32_t id = PciTable::kNameIds[slot];
+    const unsigned char* p = PciTable::kNameData + PciTable::kBlockOffsets[id / PciTable::kBlockSize];
+    name.size = read_pci_varint(p);
+    std::memcpy(name.data, p, name.size);
+    p += name.size;
+    for (uint32_t i = id % PciTable::kBlockSize; i > 0; --i) {
+        uint32_t shared = read_pci_varint(p);
+        uint32_t suffix = read_pci_varint(p);
+        std::memcpy(name.data + shared, p, suffix);
+        p += suffix;
+        name.size = shared + suffix;
+    }
+    return true;
+}
+#endif
+
+// Resolve a PCI name: the tables compiled in first, which cost no I/O, then
+// the system pci.ids for devices newer than the build
+bool lookup_pci_name(uint16_t vendor, uint16_t device, uint16_t subvendor, uint16_t subdevice,
+                     PciName& name) {
+    uint64_t key = pci_key(vendor, device, subvendor, subdevice);
+#ifdef WHATSMY_GPU_PCI_TABLES
+    if (lookup_pci_table(key, name)) {
+        return true;
+    }
+#endif
+    std::string_view text;
+    if (PciIdsIndex::instance().lookup(key, text)) {
+        name.assign(text);
+        return true;
+    }
+    return false;
+}
+
+bool lookup_pci_vendor(uint16_t vendor, PciName& name) {
+    return lookup_pci_name(vendor, kPciAny, kPciAny, kPciAny, name);
+}
+
+bool lookup_pci_device(uint16_t vendor, uint16_t device, PciName& name) {
+    return lookup_pci_name(vendor, device, kPciAny, kPciAny, name);
+}
+
+bool lookup_pci_subsystem(uint16_t vendor, uint16_t device, uint16_t subvendor, uint16_t subdevice,
+                          PciName& name) {
+    return lookup_pci_name(vendor, device, subvendor, subdevice, name);
+}
+
+// Model name from the PCI names. The vendor's own subsystem entry names
+// the exact SKU ("Tesla T4"); otherwise the device entry names the chip and
+// usually the product ("GH100 [H100 SXM5 80GB]"). Board-partner subsystems
+// are reported separately, see resolve_pci_board().
+bool resolve_pci_model(uint16_t vendor, uint16_t device, uint16_t subvendor, uint16_t subdevice,
+                       bool has_subsystem, PciName& name) {
+    if (has_subsystem && subvendor == vendor && lookup_pci_subsystem(vendor, device, subvendor, subdevice, name)) {
+        return true;
+    }
+    return lookup_pci_device(vendor, device, name);
+}
+
+// Board partner for cards built by someone other than the chip vendor,
+// e.g. "ASUSTeK Computer Inc. ROG Strix GeForce RTX 4090"
+std::string resolve_pci_board(uint16_t vendor, uint16_t device, uint16_t subvendor, uint16_t subdevice) {
+    PciName name;
+    if (subvendor == vendor || subvendor == 0 || !lookup_pci_vendor(subvendor, name)) {
+        return "";
+    }
+    std::string board(name.text());
+    if (lookup_pci_subsystem(vendor, device, subvendor, subdevice, name)) {
+        board += " ";
+        board += name.text();
+    }
+    return board;
+}
+
+// Name attributes probe_card tries, in order of preference
+const char* const kCardNameFiles[] = {"label", "product_name", "model"};
+constexpr size_t kCardNameFileCount = sizeof(kCardNameFiles) / sizeof(kCardNameFiles[0]);
+
+// Device attributes of one card, read ahead by a batched probe round.
+// An empty attribute (size 0) was missing or unreadable.
+struct CardAttributes {
+    SysfsDir device;   // The card's device directory, held for the round
+    SysfsAttr uevent;
+    SysfsAttr names[kCardNameFileCount];
+};
+
+// Fill in everything sysfs/procfs knows about one enumerated card.
+// Attributes come from `prefetched` when a batched round read them,
+// otherwise they are read here as they are needed.
+void probe_card(const SysfsDir& root_dir, const SysfsDir& drm_dir, DriverRegistry& drivers,
+                GPUInfo& gpu, const CardAttributes* prefetched = nullptr) {
+    TraceSpan span("probe card", gpu.index, gpu.node);
+    const int64_t usdt_start = GPU_USDT_ACTIVE(card__done) ? trace_now_ns() : 0;
+    GPU_USDT(card__start, gpu.index, gpu.node.c_str());
+    if (GPU_USDT_ACTIVE(attr__read)) {
+        usdt_card = gpu.index;
+    }
+    SysfsDir opened;
+    if (!prefetched) {
+        char device_path[64];
+        std::snprintf(device_path, sizeof(device_path), "%s/device", gpu.node.c_str());
+        opened = SysfsDir(drm_dir, device_path);
+    }
+    const SysfsDir& device = prefetched ? prefetched->device : opened;
+    SysfsAttr local;
+    bool timed_out = false;   // Some attribute missed its deadline
+    auto attribute = [&](const char* name, const SysfsAttr* ready) -> const SysfsAttr* {
+        if (ready) {
+            return ready->size > 0 ? ready : nullptr;
+        }
+        if (device.read(name, local)) {
+            return &local;
+        }
+        timed_out = timed_out || local.timed_out;
+        return nullptr;
+    };
+    uint16_t vendor = 0, device_id = 0, subvendor = 0, subdevice = 0;
+    bool has_pci_id = false, has_subsystem = false;
+    PciName pci_name;
+    
+    // Read device info from uevent file
+    if (const SysfsAttr* uevent = attribute("uevent", prefetched ? &prefetched->uevent : nullptr)) {
+        std::string_view text = uevent->text();
+        std::string_view vendor_id;
+        
+        while (!text.empty()) {
+            size_t end = text.find('\n');
+            std::string_view line = text.substr(0, end);
+            text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+            
+            if (line.compare(0, 7, "PCI_ID=") == 0) {
+                gpu.pci_id = std::string(line.substr(7));
+                // Split vendor:device
+                size_t colon = line.find(':');
+                if (colon != std::string_view::npos) {
+                    vendor_id = line.substr(7, colon - 7);
+                }
+                has_pci_id = parse_pci_pair(line.substr(7), vendor, device_id);
+            } else if (line.compare(0, 7, "DRIVER=") == 0) {
+                gpu.driver = std::string(line.substr(7));
+            } else if (line.compare(0, 14, "PCI_SUBSYS_ID=") == 0) {
+                has_subsystem = parse_pci_pair(line.substr(14), subvendor, subdevice);
+            }
+        }
+        
+        gpu.vendor = get_vendor_name(std::string(vendor_id));
+        // Vendors without a short name get their full pci.ids name
+        if (gpu.vendor == "Unknown" && has_pci_id && lookup_pci_vendor(vendor, pci_name)) {
+            gpu.vendor = std::string(pci_name.text());
+        }
+        if (has_pci_id && has_subsystem) {
+            gpu.board = resolve_pci_board(vendor, device_id, subvendor, subdevice);
+        }
+    } else if (timed_out) {
+        gpu.vendor = gpu.pci_id = gpu.driver = kProbeTimeout;
+    } else {
+        // No uevent says as much about the vendor as one without PCI_ID
+        gpu.vendor = get_vendor_name("");
+    }
+    
+    // Try to read GPU name from various sources
+    bool name_found = false;
+    for (size_t i = 0; i < kCardNameFileCount; ++i) {
+        const SysfsAttr* name = attribute(kCardNameFiles[i], prefetched ? &prefetched->names[i] : nullptr);
+        if (name && !name->line().empty()) {
+            gpu.name = std::string(name->line());
+            name_found = true;
+            break;
+        }
+    }
+    
+    // Then the PCI names, e.g. "NVIDIA GH100 [H100 SXM5 80GB]"
+    if (!name_found && has_pci_id &&
+        resolve_pci_model(vendor, device_id, subvendor, subdevice, has_subsystem, pci_name)) {
+        gpu.name = gpu.vendor + " " + std::string(pci_name.text());
+        name_found = true;
+    }
+    
+    // Name sources that timed out are skipped; with nothing else left the
+    // name itself is unavailable
+    if (!name_found && timed_out) {
+        gpu.name = kProbeTimeout;
+        name_found = true;
+    }
+    
+    // If no name found, construct a basic one with PCI ID
+    if (!name_found) {
+        if (!gpu.pci_id.empty()) {
+            gpu.name = gpu.vendor + " GPU [" + gpu.pci_id + "]";
+        } else {
+            gpu.name = gpu.vendor + " GPU";
+        }
+    }
+    
+    // Driver version, resolved once per driver
+    if (!gpu.driver.empty() && gpu.driver != kProbeTimeout) {
+        TraceSpan version_span("driver version", gpu.index, gpu.driver);
+        gpu.driver_version = drivers.version(root_dir, device, gpu.driver);
+    }
+    
+    gpu.populated = true;
+    if (GPU_USDT_ACTIVE(attr__read)) {
+        usdt_card = -1;
+    }
+    // Attached mid-probe: no start time, so no latency either
+    GPU_USDT(card__done, gpu.index, gpu.node.c_str(), usdt_start ? trace_now_ns() - usdt_start : 0);
+}
+
+// Run fn(0..count-1) on up to `workers` threads; each index runs exactly once.
+// The first exception thrown by any worker is rethrown on the calling thread.
+template <typename Fn>
+void run_parallel(size_t count, unsigned workers, Fn fn) {
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&] {
+        try {
+            for (size_t i = next++; i < count; i = next++) {
+                fn(i);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            next = count;
+        }
+    };
+    
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned t = 1; t < workers; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker(); // The calling thread takes its share too
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Read every card's uevent and name attributes in one SysfsBatch round
+// and parse them serially; the batch replaces the worker threads.
+// Returns false when io_uring is not available, having done nothing.
+bool populate_gpus_batched(const SysfsDir& root_dir, const SysfsDir& drm_dir, DriverRegistry& drivers,
+                           const std::vector<GPUInfo*>& targets) {
+    SysfsBatch batch(true);
+    if (!batch.uring()) {
+        return false;
+    }
+    std::unique_ptr<CardAttributes[]> attributes(new CardAttributes[targets.size()]);
+    std::vector<SysfsRead> reads;
+    std::vector<SysfsAttr*> destinations;
+    reads.reserve(targets.size() * (1 + kCardNameFileCount));
+    destinations.reserve(reads.capacity());
+    char device_path[64];
+    for (size_t i = 0; i < targets.size(); ++i) {
+        CardAttributes& card = attributes[i];
+        std::snprintf(device_path, sizeof(device_path), "%s/device", targets[i]->node.c_str());
+        card.device = SysfsDir(drm_dir, device_path);
+        if (!card.device.valid()) {
+            continue;
+        }
+        auto add = [&](const char* name, SysfsAttr& attr) {
+            reads.push_back({card.device.fd(), name, -1, attr.data, sizeof(attr.data)});
+            destinations.push_back(&attr);
+        };
+        add("uevent", card.uevent);
+        for (size_t n = 0; n < kCardNameFileCount; ++n) {
+            add(kCardNameFiles[n], card.names[n]);
+        }
+    }
+    batch.read_all(reads.data(), reads.size());
+    for (size_t r = 0; r < reads.size(); ++r) {
+        destinations[r]->size = reads[r].result > 0 ? static_cast<size_t>(reads[r].result) : 0;
+    }
+    for (size_t i = 0; i < targets.size(); ++i) {
+        probe_card(root_dir, drm_dir, drivers, *targets[i], &attributes[i]);
+    }
+    return true;
+}
+
+// Populate the given enumerated GPUs in place.
+// Each card is probed into its own slot, so the result order never depends
+// on which worker finished first. Threads only pay off once there are a few
+// cards to overlap. With WHATSMY_GPU_IO=uring, rounds of more than one card
+// are read as a single io_uring batch instead.
+void populate_gpus_linux(const SysfsDir& root_dir, const SysfsDir& drm_dir, DriverRegistry& drivers,
+                         const std::vector<GPUInfo*>& targets,
+                         unsigned workers = probe_workers()) {
+    TraceSpan span("probe");
+    StatsPhaseScope phase(kPhaseProbe);
+    // An io_uring batch cannot be abandoned, so deadlines keep the plain path
+    if (targets.size() > 1 && sysfs_uring_requested() && !probe_deadlines().enabled && drm_dir.posix() &&
+        populate_gpus_batched(root_dir, drm_dir, drivers, targets)) {
+        return;
+    }
+    auto probe = [&](size_t i) { probe_card(root_dir, drm_dir, drivers, *targets[i]); };
+    workers = std::min<unsigned>(workers, static_cast<unsigned>(targets.size()));
+    if (targets.size() <= 2 || workers <= 1) {
+        for (size_t i = 0; i < targets.size(); ++i) {
+            probe(i);
+        }
+    } else {
+        run_parallel(targets.size(), workers, probe);
+    }
+}
+
+// Populate a single enumerated GPU
+void populate_gpu_linux(GPUInfo& gpu, const std::string& root = linux_root()) {
+    StatsPhaseScope phase(kPhaseProbe);
+    SysfsDir root_dir(root);
+    SysfsDir drm_dir(root_dir, "sys/class/drm");
+    populate_gpus_linux(root_dir, drm_dir, DriverRegistry::for_root(root), {&gpu}, 1);
+}
+
+// Linux GPU detection using /sys/class/drm below `root` of `fs`
+std::vector<GPUInfo> detect_gpus_linux(const SysfsBackend& fs, const std::string& root,
+                                       unsigned workers = probe_workers()) {
+    StatsPhaseScope phase(kPhaseEnumerate);
+    SysfsDir root_dir(fs, root);
+    SysfsDir drm_dir(root_dir, "sys/class/drm", true);
+    
+    if (!drm_dir.valid()) {
+        return {};
+    }
+    
+    std::vector<GPUInfo> gpus;
+    {
+        TraceSpan span("enumerate");
+        gpus = enumerate_gpus_linux(list_drm_entries(drm_dir));
+    }
+    std::vector<GPUInfo*> targets;
+    for (auto& gpu : gpus) {
+        targets.push_back(&gpu);
+    }
+    populate_gpus_linux(root_dir, drm_dir, DriverRegistry::for_root(root, fs), targets, workers);
+    return gpus;
+}
+
+std::vector<GPUInfo> detect_gpus_linux(const std::string& root = linux_root(),
+                                       unsigned workers = probe_workers()) {
+    return detect_gpus_linux(posix_sysfs(), root, workers);
+}
+
+// FNV-1a, used for the inventory cache checksum and DRM fingerprint
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Binary encoding of a GPUInfo vector (host byte order, host-local use only)
+void put_u32(std::string& out, uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_u64(std::string& out, uint64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_string(std::string& out, const std::string& value) {
+    put_u32(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+void serialize_gpus(std::string& out, const std::vector<GPUInfo>& gpus) {
+    put_u32(out, static_cast<uint32_t>(gpus.size()));
+    for (const auto& gpu : gpus) {
+        put_u32(out, static_cast<uint32_t>(gpu.index));
+        put_u32(out, gpu.is_active ? 1 : 0);
+        put_string(out, gpu.name);
+        put_string(out, gpu.vendor);
+        put_string(out, gpu.driver);
+        put_string(out, gpu.driver_version);
+        put_string(out, gpu.pci_id);
+        put_string(out, gpu.board);
+        put_string(out, gpu.node);
+    }
+}
+
+bool get_u32(std::string_view& in, uint32_t& value) {
+    if (in.size() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+bool get_u64(std::string_view& in, uint64_t& value) {
+    if (in.size() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+bool get_string(std::string_view& in, std::string& value) {
+    uint32_t size;
+    if (!get_u32(in, size) || in.size() < size) {
+        return false;
+    }
+    value.assign(in.data(), size);
+    in.remove_prefix(size);
+    return true;
+}
+
+bool deserialize_gpus(std::string_view& in, std::vector<GPUInfo>& gpus) {
+    uint32_t count;
+    if (!get_u32(in, count) || count > in.size()) {
+        return false;
+    }
+    gpus.resize(count);
+    for (auto& gpu : gpus) {
+        uint32_t index, active;
+        if (!get_u32(in, index) || !get_u32(in, active) ||
+            !get_string(in, gpu.name) || !get_string(in, gpu.vendor) ||
+            !get_string(in, gpu.driver) || !get_string(in, gpu.driver_version) || !get_string(in, gpu.pci_id) ||
+            !get_string(in, gpu.board) || !get_string(in, gpu.node)) {
+            return false;
+        }
+        gpu.index = static_cast<int>(index);
+        gpu.is_active = active != 0;
+        gpu.populated = true;
+    }
+    return true;
+}
+
+// On-disk inventory cache.
+//
+// The GPU inventory only changes on reboot or hotplug, so a full probe is
+// stored under $XDG_CACHE_HOME/whatsmy/gpu-inventory.bin and reused while
+// its key matches. The key is the kernel boot_id plus a fingerprint of
+// /sys/class/drm: every entry name, and the mtimes of each card node and
+// its device uevent (kernfs stamps them when the device is registered).
+//
+// File layout: magic, format version, payload size, FNV-1a of the payload,
+// then the payload (boot_id, fingerprint, serialized GPUs). Set
+// WHATSMY_GPU_NO_CACHE=1 to bypass it.
+const char kInventoryMagic[8] = {'W', 'M', 'G', 'P', 'U', 'I', 'N', 'V'};
+const uint32_t kInventoryVersion = 5;
+
+struct InventoryCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t payload_size;
+    uint64_t checksum;
+};
+
+// Cache file location, or "" when caching is disabled or there is no home
+std::string inventory_cache_path() {
+    std::string dir = whatsmy_cache_dir();
+    return dir.empty() ? dir : dir + "/gpu-inventory.bin";
+}
+
+// Cache key for the current boot and DRM topology
+struct InventoryKey {
+    std::string boot_id;
+    uint64_t fingerprint = 0;
+    
+    bool operator==(const InventoryKey& other) const {
+        return boot_id == other.boot_id && fingerprint == other.fingerprint;
+    }
+};
+
+bool compute_inventory_key(const SysfsDir& root_dir, const SysfsDir& drm_dir,
+                           const std::string& root, const std::vector<std::string>& entries,
+                           InventoryKey& key) {
+    SysfsAttr attr;
+    if (!root_dir.read("proc/sys/kernel/random/boot_id", attr) || attr.line().empty()) {
+        return false;
+    }
+    key.boot_id = std::string(attr.line());
+    
+    uint64_t hash = fnv1a(root.data(), root.size());
+    for (const auto& name : entries) {
+        hash = fnv1a(name.c_str(), name.size() + 1, hash);
+        if (!is_card_entry(name)) {
+            continue;
+        }
+        struct stat st;
+        stats_stat();
+        if (::fstatat(drm_dir.fd(), name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            hash = fnv1a(&st.st_mtim, sizeof(st.st_mtim), hash);
+        }
+        std::string uevent = name + "/device/uevent";
+        stats_stat();
+        if (::fstatat(drm_dir.fd(), uevent.c_str(), &st, 0) == 0) {
+            hash = fnv1a(&st.st_mtim, sizeof(st.st_mtim), hash);
+        }
+    }
+    key.fingerprint = hash;
+    return true;
+}
+
+bool load_inventory_cache(const std::string& path, const InventoryKey& key,
+                          std::vector<GPUInfo>& gpus) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    stats_open();
+    if (fd < 0) {
+        return false;
+    }
+    std::string data;
+    struct stat st;
+    stats_stat();
+    if (::fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size <= (1 << 20)) {
+        data.resize(static_cast<size_t>(st.st_size));
+        ssize_t n = ::read(fd, &data[0], data.size());
+        stats_read(n);
+        if (n != static_cast<ssize_t>(data.size())) {
+            data.clear();
+        }
+    }
+    ::close(fd);
+    
+    InventoryCacheHeader header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    std::string_view payload(data.data() + sizeof(header), data.size() - sizeof(header));
+    if (std::memcmp(header.magic, kInventoryMagic, sizeof(header.magic)) != 0 ||
+        header.version != kInventoryVersion || header.payload_size != payload.size() ||
+        header.checksum != fnv1a(payload.data(), payload.size())) {
+        return false;
+    }
+    
+    InventoryKey cached;
+    if (!get_string(payload, cached.boot_id) || !get_u64(payload, cached.fingerprint)) {
+        return false;
+    }
+    return cached == key && deserialize_gpus(payload, gpus) && payload.empty();
+}
+
+// Store the cache atomically; readers see the old file or the new one
+void store_inventory_cache(const std::string& path, const InventoryKey& key,
+                           const std::vector<GPUInfo>& gpus) {
+    std::string payload;
+    put_string(payload, key.boot_id);
+    put_u64(payload, key.fingerprint);
+    serialize_gpus(payload, gpus);
+    
+    InventoryCacheHeader header;
+    std::memcpy(header.magic, kInventoryMagic, sizeof(header.magic));
+    header.version = kInventoryVersion;
+    header.payload_size = static_cast<uint32_t>(payload.size());
+    header.checksum = fnv1a(payload.data(), payload.size());
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+    data += payload;
+    
+    write_file_atomic(path, data.data(), data.size());
+}
+
+// Linux GPU enumeration backed by the inventory cache. On a cache hit the
+// entries come back fully populated; otherwise only index/node are set and
+// `key` receives the key a full probe should be stored under (its boot_id
+// stays empty when caching is unavailable).
+std::vector<GPUInfo> enumerate_gpus_linux_cached(const std::string& root, InventoryKey& key) {
+    StatsPhaseScope phase(kPhaseEnumerate);
+    SysfsDir root_dir(root);
+    SysfsDir drm_dir(root_dir, "sys/class/drm", true);
+    
+    if (!drm_dir.valid()) {
+        return {};
+    }
+    
+    TraceSpan span("enumerate");
+    std::vector<std::string> entries = list_drm_entries(drm_dir);
+    std::string path = inventory_cache_path();
+    std::vector<GPUInfo> gpus;
+    {
+        StatsPhaseScope cache_phase(kPhaseCache);
+        if (!path.empty() && compute_inventory_key(root_dir, drm_dir, root, entries, key)) {
+            TraceSpan cache_span("inventory cache");
+            if (load_inventory_cache(path, key, gpus)) {
+                return gpus;
+            }
+        } else {
+            key = InventoryKey();
+        }
+    }
+    return enumerate_gpus_linux(entries);
+}
+
+// Linux GPU detection served from the inventory cache when its key matches.
+// Only this full probe stores the cache; single-GPU views never touch the
+// cards they skip.
+std::vector<GPUInfo> detect_gpus_linux_cached(const std::string& root = linux_root()) {
+    InventoryKey key;
+    // Counted rather than looked for in the fields: a name source that
+    // timed out leaves a fallback name, not a placeholder
+    const unsigned timeouts = probe_deadlines().timeouts.load();
+    std::vector<GPUInfo> gpus = enumerate_gpus_linux_cached(root, key);
+    if (gpus.empty() || gpus.front().populated) {
+        return gpus;
+    }
+    
+    StatsPhaseScope phase(kPhaseProbe);
+    SysfsDir root_dir(root);
+    SysfsDir drm_dir(root_dir, "sys/class/drm");
+    std::vector<GPUInfo*> targets;
+    for (auto& gpu : gpus) {
+        targets.push_back(&gpu);
+    }
+    populate_gpus_linux(root_dir, drm_dir, DriverRegistry::for_root(root), targets);
+    
+    // A probe cut short by a deadline is not worth remembering
+    if (!key.boot_id.empty() && probe_deadlines().timeouts.load() == timeouts) {
+        TraceSpan span("cache store");
+        StatsPhaseScope cache_phase(kPhaseCache);
+        store_inventory_cache(inventory_cache_path(), key, gpus);
+    }
+    return gpus;
+}
+
+// Kernel uevent as delivered on NETLINK_KOBJECT_UEVENT
+struct UeventMessage {
+    std::string action;     // add, remove, change, bind, unbind, ...
+    std::string devpath;    // e.g. /devices/pci0000:00/0000:00:01.0/0000:01:00.0/drm/card1
+    std::string subsystem;  // drm, pci, ...
+    std::string devname;    // e.g. dri/card1 (drm only)
+    bool overflow = false;  // Events were lost; everything above is empty
+};
+
+// Parse KEY=VALUE records separated by `separator`. Netlink messages use
+// NUL with an "action@devpath" header; replay files use newlines and may
+// carry a udevadm-style "KERNEL[...] add ..." header. Lines without '='
+// are ignored either way.
+UeventMessage parse_uevent(std::string_view text, char separator) {
+    UeventMessage msg;
+    while (!text.empty()) {
+        size_t end = text.find(separator);
+        std::string_view field = text.substr(0, end);
+        text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+        
+        size_t eq = field.find('=');
+        if (eq == std::string_view::npos) {
+            continue;
+        }
+        std::string_view key = field.substr(0, eq);
+        std::string_view value = field.substr(eq + 1);
+        if (key == "ACTION") {
+            msg.action = std::string(value);
+        } else if (key == "DEVPATH") {
+            msg.devpath = std::string(value);
+        } else if (key == "SUBSYSTEM") {
+            msg.subsystem = std::string(value);
+        } else if (key == "DEVNAME") {
+            msg.devname = std::string(value);
+        }
+    }
+    return msg;
+}
+
+// Source of uevents: the kernel's netlink broadcast, or a replay file of
+// blank-line separated KEY=VALUE records (as printed by
+// `udevadm monitor --kernel --property`) for tests and benchmarks.
+class UeventSource {
+public:
+    UeventSource() = default;
+    UeventSource(const UeventSource&) = delete;
+    UeventSource& operator=(const UeventSource&) = delete;
+    
+    ~UeventSource() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+    
+    // Subscribe to kernel uevents (non-blocking socket)
+    bool open_netlink() {
+        fd_ = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                       NETLINK_KOBJECT_UEVENT);
+        if (fd_ < 0) {
+            return false;
+        }
+        // Room for a hotplug storm (a dock or an eGPU enclosure brings
+        // hundreds of events at once). SO_RCVBUFFORCE needs CAP_NET_ADMIN;
+        // without it SO_RCVBUF is capped at net.core.rmem_max.
+        int rcvbuf = 8 << 20;
+        if (::setsockopt(fd_, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) != 0) {
+            ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        }
+        
+        sockaddr_nl addr{};
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = 1; // Kernel broadcast group (not udevd's rebroadcast)
+        if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        return true;
+    }
+    
+    // Read events from a replay file instead of the socket
+    bool open_replay(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            return false;
+        }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        replay_ = contents.str();
+        replaying_ = true;
+        return true;
+    }
+    
+    // Pollable fd, or -1 for replay files (always ready until exhausted)
+    int fd() const { return fd_; }
+    bool replaying() const { return replaying_; }
+    
+    // Fetch the next message. Returns false when nothing is pending on the
+    // socket, or when the replay file is exhausted. When the kernel dropped
+    // events because the receive queue was full, the message returned has
+    // only `overflow` set; the caller must rescan (ResidentInventory::rescan).
+    bool next(UeventMessage& msg) {
+        if (replaying_) {
+            return next_replay(msg);
+        }
+        if (fd_ < 0) {
+            return false;
+        }
+        for (;;) {
+            sockaddr_nl sender{};
+            iovec iov{buffer_, sizeof(buffer_)};
+            msghdr hdr{};
+            hdr.msg_name = &sender;
+            hdr.msg_namelen = sizeof(sender);
+            hdr.msg_iov = &iov;
+            hdr.msg_iovlen = 1;
+            ssize_t n = ::recvmsg(fd_, &hdr, 0);
+            if (n < 0 && errno == ENOBUFS) {
+                msg = UeventMessage();
+                msg.overflow = true;
+                return true;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            // Only trust messages that come from the kernel itself
+            if (sender.nl_pid != 0) {
+                continue;
+            }
+            msg = parse_uevent(std::string_view(buffer_, static_cast<size_t>(n)), '\0');
+            return true;
+        }
+    }
+    
+private:
+    bool next_replay(UeventMessage& msg) {
+        while (replay_pos_ < replay_.size()) {
+            size_t end = replay_.find("\n\n", replay_pos_);
+            if (end == std::string::npos) {
+                end = replay_.size();
+            }
+            std::string_view record(replay_.data() + replay_pos_, end - replay_pos_);
+            replay_pos_ = end + 2;
+            msg = parse_uevent(record, '\n');
+            if (!msg.action.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    int fd_ = -1;
+    bool replaying_ = false;
+    std::string replay_;
+    size_t replay_pos_ = 0;
+    char buffer_[8192];
+};
+
+// What one uevent did to the resident inventory
+struct InventoryChange {
+    enum Kind { None, Added, Removed, Changed } kind = None;
+    std::string node;
+};
+
+// GPU inventory kept current by uevents instead of rescanning.
+//
+// One full scan seeds it; after that only the card named by a drm event
+// (or the cards below a pci device that changed driver binding) are probed
+// again. Readers take an immutable snapshot, so a query is a pointer load
+// and never waits for probing.
+class ResidentInventory {
+public:
+    explicit ResidentInventory(const std::string& root = linux_root()) : root_(root) {}
+    
+    // Full scan of /sys/class/drm
+    void scan() {
+        auto gpus = std::make_shared<std::vector<GPUInfo>>(detect_gpus_linux(root_));
+        devpaths_.clear();
+        SysfsDir drm_dir(SysfsDir(root_), "sys/class/drm");
+        for (const auto& gpu : *gpus) {
+            devpaths_[gpu.node] = card_devpath(drm_dir, gpu.node);
+        }
+        publish(std::move(gpus));
+    }
+    
+    // Full scan after uevents were lost. Returns what changed against the
+    // previous snapshot, in card order, as if the lost events had been applied.
+    std::vector<InventoryChange> rescan() {
+        auto before = snapshot();
+        scan();
+        auto after = snapshot();
+        std::vector<InventoryChange> changes;
+        auto find = [](const std::vector<GPUInfo>& gpus, const std::string& node) {
+            return std::find_if(gpus.begin(), gpus.end(), [&](const GPUInfo& gpu) { return gpu.node == node; });
+        };
+        for (const auto& gpu : *before) {
+            if (find(*after, gpu.node) == after->end()) {
+                changes.push_back({InventoryChange::Removed, gpu.node});
+            }
+        }
+        for (const auto& gpu : *after) {
+            auto old = find(*before, gpu.node);
+            if (old == before->end()) {
+                changes.push_back({InventoryChange::Added, gpu.node});
+            } else if (old->name != gpu.name || old->vendor != gpu.vendor || old->driver != gpu.driver ||
+                       old->driver_version != gpu.driver_version || old->pci_id != gpu.pci_id ||
+                       old->board != gpu.board) {
+                changes.push_back({InventoryChange::Changed, gpu.node});
+            }
+        }
+        std::sort(changes.begin(), changes.end(), [](const InventoryChange& a, const InventoryChange& b) {
+            return card_number(a.node) < card_number(b.node);
+        });
+        return changes;
+    }
+    
+    // Current inventory
+    std::shared_ptr<const std::vector<GPUInfo>> snapshot() const {
+        return std::atomic_load(&gpus_);
+    }
+    
+    // Apply one uevent
+    InventoryChange apply(const UeventMessage& msg) {
+        InventoryChange change;
+        if (msg.subsystem == "drm") {
+            std::string node = msg.devpath.substr(msg.devpath.rfind('/') + 1);
+            if (!is_card_entry(node)) {
+                return change;
+            }
+            if (msg.action == "add") {
+                devpaths_[node] = msg.devpath;
+                change.kind = upsert(node) ? InventoryChange::Added : InventoryChange::Changed;
+            } else if (msg.action == "remove") {
+                devpaths_.erase(node);
+                if (erase(node)) {
+                    change.kind = InventoryChange::Removed;
+                }
+            } else if (upsert(node)) {
+                change.kind = InventoryChange::Added;
+            } else {
+                change.kind = InventoryChange::Changed;
+            }
+            change.node = node;
+        } else if (msg.subsystem == "pci" && !msg.devpath.empty()) {
+            // Driver (un)binding changes what the cards below this device report
+            std::string prefix = msg.devpath + "/";
+            for (const auto& entry : devpaths_) {
+                if (entry.second.compare(0, prefix.size(), prefix) == 0) {
+                    upsert(entry.first);
+                    change.kind = InventoryChange::Changed;
+                    change.node = entry.first;
+                }
+            }
+        } else if (msg.subsystem == "module" && !msg.devpath.empty()) {
+            // A reloaded module may bring a new version; the pci bind events
+            // that follow re-probe its cards
+            DriverRegistry::for_root(root_).forget_module(msg.devpath.substr(msg.devpath.rfind('/') + 1));
+        }
+        return change;
+    }
+    
+private:
+    // "/devices/..." path of a card, from its /sys/class/drm symlink
+    static std::string card_devpath(const SysfsDir& drm_dir, const std::string& node) {
+        char target[512];
+        ssize_t n = drm_dir.read_link(node.c_str(), target, sizeof(target) - 1);
+        if (n <= 0) {
+            return "";
+        }
+        std::string_view link(target, static_cast<size_t>(n));
+        while (link.compare(0, 3, "../") == 0) {
+            link.remove_prefix(3);
+        }
+        return "/" + std::string(link);
+    }
+    
+    // Probe one card into a copy of the inventory; true if it was new
+    bool upsert(const std::string& node) {
+        auto gpus = std::make_shared<std::vector<GPUInfo>>(*snapshot());
+        auto it = std::find_if(gpus->begin(), gpus->end(),
+                               [&](const GPUInfo& gpu) { return gpu.node == node; });
+        bool added = it == gpus->end();
+        GPUInfo gpu;
+        gpu.node = node;
+        populate_gpu_linux(gpu, root_);
+        if (added) {
+            gpus->push_back(gpu);
+        } else {
+            gpu.index = it->index;
+            gpu.is_active = it->is_active;
+            *it = gpu;
+        }
+        publish(std::move(gpus));
+        return added;
+    }
+    
+    bool erase(const std::string& node) {
+        auto gpus = std::make_shared<std::vector<GPUInfo>>(*snapshot());
+        auto it = std::find_if(gpus->begin(), gpus->end(),
+                               [&](const GPUInfo& gpu) { return gpu.node == node; });
+        if (it == gpus->end()) {
+            return false;
+        }
+        gpus->erase(it);
+        publish(std::move(gpus));
+        return true;
+    }
+    
+    // Keep card number order and renumber before making a copy visible
+    void publish(std::shared_ptr<std::vector<GPUInfo>> gpus) {
+        std::sort(gpus->begin(), gpus->end(), [](const GPUInfo& a, const GPUInfo& b) {
+            return card_number(a.node) < card_number(b.node);
+        });
+        for (size_t i = 0; i < gpus->size(); ++i) {
+            (*gpus)[i].index = static_cast<int>(i);
+            (*gpus)[i].is_active = (i == 0);
+        }
+        std::atomic_store(&gpus_, std::shared_ptr<const std::vector<GPUInfo>>(std::move(gpus)));
+    }
+    
+    std::string root_;
+    std::shared_ptr<const std::vector<GPUInfo>> gpus_ = std::make_shared<const std::vector<GPUInfo>>();
+    std::map<std::string, std::string> devpaths_; // node -> devpath, for pci events
+};
+
+// Inventory daemon protocol.
+//
+// Frames on the AF_UNIX stream socket are a u32 body length followed by
+// the body, all in host byte order (the socket never leaves the host).
+// Request body:  u8 protocol version, u8 opcode.
+// Response body: u8 protocol version, u8 status, then for kOpInventory
+//                the serialized GPU vector (see serialize_gpus).
+const uint8_t kDaemonProtocolVersion = 3;
+const uint8_t kOpInventory = 1;
+const uint8_t kStatusOk = 0;
+const uint8_t kStatusBadRequest = 1;
+const uint32_t kMaxFrameSize = 16 << 20;
+
+// Per-user directory for the socket when there is no XDG_RUNTIME_DIR. The
+// name in /tmp is predictable, so the daemon only uses it as a 0700
+// directory it owns (see make_private_dir).
+std::string fallback_socket_dir() {
+    return "/tmp/whatsmy-gpu-" + std::to_string(::getuid());
+}
+
+// Suffix for the default socket and shm names: empty on the live system,
+// else a hash of linux_root(), so a daemon serving a captured tree and one
+// serving the host never answer for each other
+std::string published_name_tag() {
+    const std::string& root = linux_root();
+    if (root.empty()) {
+        return "";
+    }
+    char tag[18];
+    std::snprintf(tag, sizeof(tag), "-%016llx", static_cast<unsigned long long>(fnv1a(root.data(), root.size())));
+    return tag;
+}
+
+// Daemon socket path: WHATSMY_GPU_SOCKET, else $XDG_RUNTIME_DIR/whatsmy-gpu.sock,
+// else gpu.sock in the per-user directory in /tmp. Under WHATSMY_GPU_ROOT
+// the default names carry published_name_tag().
+std::string daemon_socket_path() {
+    const char* env = std::getenv("WHATSMY_GPU_SOCKET");
+    if (env && *env) {
+        return env;
+    }
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime == '/') {
+        return std::string(runtime) + "/whatsmy-gpu" + published_name_tag() + ".sock";
+    }
+    return fallback_socket_dir() + "/gpu" + published_name_tag() + ".sock";
+}
+
+// Create `dir` with mode 0700, or accept an existing one only if it is a
+// real directory (not a symlink) that we own and nobody else can enter
+bool make_private_dir(const std::string& dir, std::string& error) {
+    if (::mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        error = "cannot create " + dir + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (::lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != ::getuid() ||
+        (st.st_mode & 077) != 0) {
+        error = dir + " is not a private directory owned by this user";
+        return false;
+    }
+    return true;
+}
+
+// Whether the process at the other end of a connected Unix socket runs as
+// this user. Anyone can bind a socket path first; only our own daemon is
+// trusted to hand out the inventory.
+bool peer_is_same_user(int fd) {
+    ucred cred;
+    socklen_t size = sizeof(cred);
+    return ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &size) == 0 && size == sizeof(cred) &&
+           cred.uid == ::getuid();
+}
+
+bool make_socket_address(const std::string& path, sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_all(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::recv(fd, data, size, 0);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Ask a running daemon for the inventory. Returns false quickly when no
+// daemon is listening (or WHATSMY_GPU_NO_DAEMON is set), so callers can fall
+// back to in-process detection.
+bool query_daemon(std::vector<GPUInfo>& gpus, const std::string& path = daemon_socket_path()) {
+    const char* disabled = std::getenv("WHATSMY_GPU_NO_DAEMON");
+    sockaddr_un addr;
+    if ((disabled && *disabled && std::strcmp(disabled, "0") != 0) ||
+        !make_socket_address(path, addr)) {
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    
+    // A wedged daemon must not hang the caller
+    timeval timeout{0, 200 * 1000};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    
+    bool ok = false;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 && peer_is_same_user(fd)) {
+        char request[6];
+        uint32_t length = 2;
+        std::memcpy(request, &length, sizeof(length));
+        request[4] = static_cast<char>(kDaemonProtocolVersion);
+        request[5] = static_cast<char>(kOpInventory);
+        
+        uint32_t response_size = 0;
+        std::string response;
+        if (write_all(fd, request, sizeof(request)) &&
+            read_all(fd, reinterpret_cast<char*>(&response_size), sizeof(response_size)) &&
+            response_size >= 2 && response_size <= kMaxFrameSize) {
+            response.resize(response_size);
+            if (read_all(fd, &response[0], response.size()) &&
+                static_cast<uint8_t>(response[0]) == kDaemonProtocolVersion &&
+                static_cast<uint8_t>(response[1]) == kStatusOk) {
+                std::string_view payload(response.data() + 2, response.size() - 2);
+                ok = deserialize_gpus(payload, gpus) && payload.empty();
+            }
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+// epoll-driven server for the daemon protocol.
+//
+// Everything runs on one thread: the listening socket, client connections,
+// the uevent source that keeps the inventory current, and (optionally) a
+// signalfd for SIGINT/SIGTERM. The encoded inventory response is rebuilt
+// only when the snapshot changes, so a query costs a recv and a send.
+class InventoryServer {
+public:
+    InventoryServer(ResidentInventory& inventory, UeventSource* events)
+        : inventory_(inventory), events_(events) {}
+    InventoryServer(const InventoryServer&) = delete;
+    InventoryServer& operator=(const InventoryServer&) = delete;
+    
+    ~InventoryServer() {
+        for (auto& client : clients_) {
+            ::close(client.first);
+        }
+        for (int fd : {listen_fd_, epoll_fd_, stop_fd_, signal_fd_}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        if (listen_fd_ >= 0) {
+            ::unlink(path_.c_str());
+        }
+    }
+    
+    // Bind the socket, replacing a stale one left by a daemon that died.
+    // Fails if another daemon is still answering on the same path, or if
+    // something other than our own socket sits there.
+    bool listen(const std::string& path, std::string& error) {
+        sockaddr_un addr;
+        if (!make_socket_address(path, addr)) {
+            error = "socket path too long: " + path;
+            return false;
+        }
+        if (path.substr(0, path.rfind('/')) == fallback_socket_dir() &&
+            !make_private_dir(fallback_socket_dir(), error)) {
+            return false;
+        }
+        int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        if (probe >= 0) {
+            ::close(probe);
+        }
+        if (live) {
+            error = "another daemon is already serving " + path;
+            return false;
+        }
+        struct stat st;
+        if (::lstat(path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode) || st.st_uid != ::getuid()) {
+                error = path + " exists and is not a socket of this user";
+                return false;
+            }
+            ::unlink(path.c_str());
+        }
+        
+        // The socket file gets its mode at bind(); a chmod afterwards would
+        // leave a window where other users could connect
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        bool bound = false;
+        if (listen_fd_ >= 0) {
+            mode_t saved = ::umask(0177);
+            bound = ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+            int bind_errno = errno;
+            ::umask(saved);
+            errno = bind_errno;
+        }
+        if (!bound || ::listen(listen_fd_, 128) != 0) {
+            error = "cannot listen on " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        path_ = path;
+        
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        stop_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (epoll_fd_ < 0 || stop_fd_ < 0) {
+            error = std::string("epoll setup failed: ") + std::strerror(errno);
+            return false;
+        }
+        watch(listen_fd_, EPOLLIN);
+        watch(stop_fd_, EPOLLIN);
+        if (events_ && events_->fd() >= 0) {
+            watch(events_->fd(), EPOLLIN);
+        }
+        return true;
+    }
+    
+    // Stop run() on SIGINT/SIGTERM. Blocks both signals in the calling thread.
+    void handle_signals() {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        ::pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+        signal_fd_ = ::signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+        if (signal_fd_ >= 0) {
+            watch(signal_fd_, EPOLLIN);
+        }
+    }
+    
+    // Called for every uevent that changed the inventory
+    void on_change(std::function<void(const InventoryChange&)> callback) {
+        on_change_ = std::move(callback);
+    }
+    
+    // Serve until stop() or a handled signal
+    void run() {
+        epoll_event ready[64];
+        for (;;) {
+            int n = ::epoll_wait(epoll_fd_, ready, 64, -1);
+            if (n < 0 && errno != EINTR) {
+                return;
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = ready[i].data.fd;
+                if (fd == stop_fd_ || fd == signal_fd_) {
+                    return;
+                } else if (fd == listen_fd_) {
+                    accept_clients();
+                } else if (events_ && fd == events_->fd()) {
+                    drain_events();
+                } else {
+                    serve_client(fd, ready[i].events);
+                }
+            }
+        }
+    }
+    
+    // Make run() return; safe to call from any thread
+    void stop() {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(stop_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+    
+private:
+    struct Client {
+        std::string in;
+        std::string out;
+        size_t out_pos = 0;
+    };
+    
+    void watch(int fd, uint32_t events, int op = EPOLL_CTL_ADD) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        ::epoll_ctl(epoll_fd_, op, fd, &ev);
+    }
+    
+    void accept_clients() {
+        for (;;) {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (fd < 0) {
+                return;
+            }
+            clients_[fd];
+            watch(fd, EPOLLIN);
+        }
+    }
+    
+    void drain_events() {
+        UeventMessage msg;
+        while (events_->next(msg)) {
+            std::vector<InventoryChange> changes;
+            if (msg.overflow) {
+                changes = inventory_.rescan();
+            } else {
+                changes.push_back(inventory_.apply(msg));
+            }
+            for (const auto& change : changes) {
+                if (change.kind != InventoryChange::None && on_change_) {
+                    on_change_(change);
+                }
+            }
+        }
+    }
+    
+    void drop(int fd) {
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        clients_.erase(fd);
+    }
+    
+    // Encoded inventory response for the current snapshot
+    const std::string& inventory_response() {
+        auto snapshot = inventory_.snapshot();
+        if (snapshot != encoded_snapshot_) {
+            std::string body;
+            body.push_back(static_cast<char>(kDaemonProtocolVersion));
+            body.push_back(static_cast<char>(kStatusOk));
+            serialize_gpus(body, *snapshot);
+            encoded_.clear();
+            put_u32(encoded_, static_cast<uint32_t>(body.size()));
+            encoded_ += body;
+            encoded_snapshot_ = snapshot;
+        }
+        return encoded_;
+    }
+    
+    void serve_client(int fd, uint32_t events) {
+        auto it = clients_.find(fd);
+        if (it == clients_.end()) {
+            return;
+        }
+        Client& client = it->second;
+        
+        if (events & EPOLLIN) {
+            char buffer[4096];
+            for (;;) {
+                ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+                if (n > 0) {
+                    client.in.append(buffer, static_cast<size_t>(n));
+                    continue;
+                }
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    drop(fd);
+                    return;
+                }
+                break;
+            }
+            
+            // Answer every complete request frame
+            std::string_view in(client.in);
+            uint32_t length;
+            while (in.size() >= sizeof(length)) {
+                std::memcpy(&length, in.data(), sizeof(length));
+                if (length > kMaxFrameSize) {
+                    drop(fd);
+                    return;
+                }
+                if (in.size() < sizeof(length) + length) {
+                    break;
+                }
+                std::string_view body = in.substr(sizeof(length), length);
+                in.remove_prefix(sizeof(length) + length);
+                if (body.size() >= 2 && static_cast<uint8_t>(body[0]) == kDaemonProtocolVersion &&
+                    static_cast<uint8_t>(body[1]) == kOpInventory) {
+                    client.out += inventory_response();
+                } else {
+                    put_u32(client.out, 2);
+                    client.out.push_back(static_cast<char>(kDaemonProtocolVersion));
+                    client.out.push_back(static_cast<char>(kStatusBadRequest));
+                }
+            }
+            client.in.erase(0, client.in.size() - in.size());
+        }
+        
+        // Flush pending output; wait for EPOLLOUT if the socket is full
+        while (client.out_pos < client.out.size()) {
+            ssize_t n = ::send(fd, client.out.data() + client.out_pos,
+                               client.out.size() - client.out_pos, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    watch(fd, EPOLLIN | EPOLLOUT, EPOLL_CTL_MOD);
+                    return;
+                }
+                drop(fd);
+                return;
+            }
+            client.out_pos += static_cast<size_t>(n);
+        }
+        if (!client.out.empty()) {
+            client.out.clear();
+            client.out_pos = 0;
+            if (events & EPOLLOUT) {
+                watch(fd, EPOLLIN, EPOLL_CTL_MOD);
+            }
+        }
+    }
+    
+    ResidentInventory& inventory_;
+    UeventSource* events_;
+    std::function<void(const InventoryChange&)> on_change_;
+    std::string path_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int stop_fd_ = -1;
+    int signal_fd_ = -1;
+    std::map<int, Client> clients_;
+    std::shared_ptr<const std::vector<GPUInfo>> encoded_snapshot_;
+    std::string encoded_;
+};
+
+// Shared-memory inventory snapshot.
+//
+// The daemon publishes the inventory into a fixed-layout POSIX shared
+// memory segment; readers map it read-only and copy out a snapshot with no
+// further system calls. A seqlock guards it: the writer makes the sequence
+// odd, rewrites the data and makes it even again, and a reader retries
+// whenever the sequence was odd or moved while it copied. Readers never
+// block the writer. The publisher also holds an OFD write lock on the
+// segment for as long as it lives; the kernel drops it when the daemon
+// exits however it dies, so a segment nobody holds is stale. The layout
+// is documented in docs/shm-layout.md.
+const char kShmMagic[8] = {'W', 'M', 'G', 'P', 'U', 'S', 'H', 'M'};
+const uint32_t kShmLayoutVersion = 1;
+const uint32_t kShmRecordCapacity = 1024;
+const uint32_t kShmStringsCapacity = 128 * 1024;
+const uint32_t kShmFlagOverflow = 1; // Inventory did not fit; fall back
+
+struct ShmHeader {
+    char magic[8];
+    uint32_t layout_version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t record_capacity;
+    uint32_t strings_offset;
+    uint32_t strings_capacity;
+    uint64_t sequence;
+    uint32_t gpu_count;
+    uint32_t strings_size;
+    uint32_t flags;
+    uint32_t publisher_pid;    // For diagnostics; liveness is the lock
+    uint64_t publish_time_ns;
+};
+static_assert(sizeof(ShmHeader) == 64, "shm header layout is fixed");
+
+// String reference into the pool at strings_offset
+struct ShmString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct ShmRecord {
+    int32_t index;
+    uint32_t flags; // bit 0: active
+    ShmString name;
+    ShmString vendor;
+    ShmString driver_version;
+    ShmString pci_id;
+    ShmString node;
+    ShmString board;   // empty if unknown
+    ShmString driver;  // empty if unknown
+};
+static_assert(sizeof(ShmRecord) == 64, "shm record layout is fixed");
+
+const size_t kShmSize = sizeof(ShmHeader) + kShmRecordCapacity * sizeof(ShmRecord) + kShmStringsCapacity;
+
+// Segment name for shm_open(): WHATSMY_GPU_SHM, else a per-user default
+// (per root too, see published_name_tag)
+std::string shm_segment_name() {
+    const char* env = std::getenv("WHATSMY_GPU_SHM");
+    if (env && *env == '/') {
+        return env;
+    }
+    return "/whatsmy-gpu-" + std::to_string(::getuid()) + published_name_tag();
+}
+
+// Writer side, owned by the daemon. Removes the segment when destroyed.
+class ShmInventoryPublisher {
+public:
+    ShmInventoryPublisher() = default;
+    ShmInventoryPublisher(const ShmInventoryPublisher&) = delete;
+    ShmInventoryPublisher& operator=(const ShmInventoryPublisher&) = delete;
+    
+    ~ShmInventoryPublisher() {
+        if (base_) {
+            ::munmap(base_, kShmSize);
+            ::shm_unlink(name_.c_str());
+            ::close(fd_);
+        }
+    }
+    
+    // Always a fresh segment: whatever sits at the name (a crashed
+    // daemon's, or one planted by someone else) is unlinked, never reused.
+    // `error` says why when this fails.
+    bool create(const std::string& name, std::string& error) {
+        ::shm_unlink(name.c_str());
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            error = "Cannot create shared memory " + name + ": " + std::strerror(errno);
+            return false;
+        }
+        void* base = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(kShmSize)) == 0) {
+            base = ::mmap(nullptr, kShmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (base == MAP_FAILED) {
+            error = "Cannot map shared memory " + name + ": " + std::strerror(errno);
+        }
+        // The lock that marks us live, held on this descriptor until we close
+        // it or exit
+        struct flock lock{};
+        lock.l_type = F_WRLCK;
+        lock.l_whence = SEEK_SET;
+        if (base != MAP_FAILED && ::fcntl(fd, F_OFD_SETLK, &lock) != 0) {
+            error = "Cannot lock shared memory " + name + ": " + std::strerror(errno);
+            ::munmap(base, kShmSize);
+            base = MAP_FAILED;
+        }
+        if (base == MAP_FAILED) {
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            return false;
+        }
+        base_ = static_cast<char*>(base);
+        fd_ = fd;
+        name_ = name;
+        
+        // Start from an odd sequence so readers ignore the segment until the
+        // first publish() completes
+        ShmHeader* header = this->header();
+        __atomic_store_n(&header->sequence, 1, __ATOMIC_RELEASE);
+        std::memcpy(header->magic, kShmMagic, sizeof(header->magic));
+        header->layout_version = kShmLayoutVersion;
+        header->header_size = sizeof(ShmHeader);
+        header->record_size = sizeof(ShmRecord);
+        header->record_capacity = kShmRecordCapacity;
+        header->strings_offset = sizeof(ShmHeader) + kShmRecordCapacity * sizeof(ShmRecord);
+        header->strings_capacity = kShmStringsCapacity;
+        header->publisher_pid = static_cast<uint32_t>(::getpid());
+        return true;
+    }
+    
+    void publish(const std::vector<GPUInfo>& gpus) {
+        ShmHeader* header = this->header();
+        uint64_t sequence = __atomic_load_n(&header->sequence, __ATOMIC_RELAXED) | 1;
+        __atomic_store_n(&header->sequence, sequence, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        
+        auto* records = reinterpret_cast<ShmRecord*>(base_ + header->header_size);
+        char* strings = base_ + header->strings_offset;
+        uint32_t strings_size = 0;
+        bool overflow = gpus.size() > kShmRecordCapacity;
+        auto put = [&](const std::string& value) {
+            ShmString ref{strings_size, static_cast<uint32_t>(value.size())};
+            if (value.size() > kShmStringsCapacity - strings_size) {
+                overflow = true;
+                return ShmString{0, 0};
+            }
+            std::memcpy(strings + strings_size, value.data(), value.size());
+            strings_size += ref.length;
+            return ref;
+        };
+        
+        uint32_t count = static_cast<uint32_t>(std::min<size_t>(gpus.size(), kShmRecordCapacity));
+        for (uint32_t i = 0; i < count; ++i) {
+            const GPUInfo& gpu = gpus[i];
+            ShmRecord record{};
+            record.index = gpu.index;
+            record.flags = gpu.is_active ? 1 : 0;
+            record.name = put(gpu.name);
+            record.vendor = put(gpu.vendor);
+            record.driver_version = put(gpu.driver_version);
+            record.pci_id = put(gpu.pci_id);
+            record.board = put(gpu.board);
+            record.driver = put(gpu.driver);
+            record.node = put(gpu.node);
+            records[i] = record;
+        }
+        header->gpu_count = count;
+        header->strings_size = strings_size;
+        header->flags = overflow ? kShmFlagOverflow : 0;
+        header->publish_time_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+        
+        __atomic_store_n(&header->sequence, sequence + 1, __ATOMIC_RELEASE);
+    }
+    
+private:
+    ShmHeader* header() { return reinterpret_cast<ShmHeader*>(base_); }
+    
+    char* base_ = nullptr;
+    int fd_ = -1;
+    std::string name_;
+};
+
+// Reader side. Map once, then read() as often as needed.
+class ShmInventoryReader {
+public:
+    ShmInventoryReader() = default;
+    ShmInventoryReader(const ShmInventoryReader&) = delete;
+    ShmInventoryReader& operator=(const ShmInventoryReader&) = delete;
+    
+    ~ShmInventoryReader() {
+        if (base_) {
+            ::munmap(const_cast<char*>(base_), size_);
+        }
+    }
+    
+    bool open(const std::string& name = shm_segment_name()) {
+        int fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+        stats_open();
+        if (fd < 0) {
+            return false;
+        }
+        // Only a segment this user owns and nobody else can write is
+        // trusted; anyone can create a name in /dev/shm first. The layout is
+        // fixed per version, so its size is known up front; a shorter
+        // segment would fault on access instead of failing here.
+        // A daemon killed without cleaning up leaves its last snapshot
+        // behind with an even sequence: only a live publisher's counts, and
+        // a live publisher holds a write lock on the segment.
+        struct stat st;
+        struct flock lock{};
+        lock.l_type = F_RDLCK;
+        lock.l_whence = SEEK_SET;
+        void* base = MAP_FAILED;
+        stats_stat();
+        if (::fstat(fd, &st) == 0 && st.st_uid == ::geteuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0 &&
+            static_cast<size_t>(st.st_size) >= kShmSize && ::fcntl(fd, F_OFD_GETLK, &lock) == 0 &&
+            lock.l_type == F_WRLCK) {
+            base = ::mmap(nullptr, kShmSize, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        base_ = static_cast<const char*>(base);
+        size_ = kShmSize;
+        const ShmHeader* header = this->header();
+        if (std::memcmp(header->magic, kShmMagic, sizeof(header->magic)) != 0 ||
+            header->layout_version != kShmLayoutVersion) {
+            ::munmap(base, kShmSize);
+            base_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+    
+    // Copy out a consistent snapshot. Returns false if the segment is not
+    // published, overflowed, or kept changing for `attempts` tries.
+    // `retries` (if given) receives the number of torn reads discarded.
+    bool read(std::vector<GPUInfo>& gpus, unsigned* retries = nullptr, unsigned attempts = 64) const {
+        if (!base_) {
+            return false;
+        }
+        const ShmHeader* header = this->header();
+        for (unsigned attempt = 0; attempt < attempts; ++attempt) {
+            if (retries) {
+                *retries = attempt;
+            }
+            if (attempt > 0) {
+                // Let a preempted writer finish rather than spin against it
+                std::this_thread::yield();
+            }
+            uint64_t before = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE);
+            if (before & 1) {
+                continue;
+            }
+            bool ok = copy_out(gpus);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&header->sequence, __ATOMIC_RELAXED) == before) {
+                return ok;
+            }
+        }
+        return false;
+    }
+    
+private:
+    const ShmHeader* header() const { return reinterpret_cast<const ShmHeader*>(base_); }
+    
+    // Copy without trusting anything: a torn read may see garbage offsets,
+    // which must fail cleanly rather than read out of bounds
+    bool copy_out(std::vector<GPUInfo>& gpus) const {
+        const ShmHeader* header = this->header();
+        uint32_t count = header->gpu_count;
+        uint32_t strings_size = header->strings_size;
+        if ((header->flags & kShmFlagOverflow) || count > kShmRecordCapacity ||
+            strings_size > kShmStringsCapacity) {
+            return false;
+        }
+        const char* strings = base_ + sizeof(ShmHeader) + kShmRecordCapacity * sizeof(ShmRecord);
+        auto get = [&](const ShmString& ref, std::string& out) {
+            if (ref.offset > strings_size || ref.length > strings_size - ref.offset) {
+                return false;
+            }
+            out.assign(strings + ref.offset, ref.length);
+            return true;
+        };
+        
+        gpus.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            ShmRecord record;
+            std::memcpy(&record, base_ + sizeof(ShmHeader) + i * sizeof(ShmRecord), sizeof(record));
+            GPUInfo& gpu = gpus[i];
+            if (!get(record.name, gpu.name) || !get(record.vendor, gpu.vendor) ||
+                !get(record.driver_version, gpu.driver_version) || !get(record.pci_id, gpu.pci_id) ||
+                !get(record.board, gpu.board) || !get(record.driver, gpu.driver) ||
+                !get(record.node, gpu.node)) {
+                return false;
+            }
+            gpu.index = record.index;
+            gpu.is_active = (record.flags & 1) != 0;
+            gpu.populated = true;
+        }
+        return true;
+    }
+    
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Inventory published by a running daemon: the shared-memory snapshot if
+// there is one, otherwise a socket query
+bool load_published_inventory(std::vector<GPUInfo>& gpus) {
+    const char* disabled = std::getenv("WHATSMY_GPU_NO_DAEMON");
+    if (disabled && *disabled && std::strcmp(disabled, "0") != 0) {
+        return false;
+    }
+    StatsPhaseScope phase(kPhaseCache);
+    {
+        TraceSpan span("shm snapshot");
+        ShmInventoryReader reader;
+        if (reader.open() && reader.read(gpus)) {
+            return true;
+        }
+    }
+    TraceSpan span("daemon query");
+    return query_daemon(gpus);
+}
+
+// Telemetry.
+//
+// Sensors are discovered once; each channel keeps its attribute open and
+// a sample is one pread() per channel at offset 0, which makes sysfs
+// regenerate the value. No path is rebuilt or resolved after discovery.
+//
+// Values keep the units sysfs reports them in.
+enum class SensorKind : uint8_t {
+    Temperature,  // millidegrees Celsius
+    Power,        // microwatts
+    Fan,          // RPM
+    Voltage,      // millivolts
+    Utilization,  // percent
+    Memory,       // bytes
+};
+
+// Marks a channel whose last read failed
+constexpr int64_t kTelemetryMissing = INT64_MIN;
+
+struct TelemetryChannel {
+    int gpu;          // GPU index
+    SensorKind kind;
+    char label[24];   // hwmon label ("edge", "PPT") or attribute stem ("temp1")
+    int fd;
+};
+
+// Utilization and memory accounting that amdgpu exposes under device/.
+// Fields hold kTelemetryMissing when the attribute is absent or unreadable.
+struct AmdgpuTelemetry {
+    int gpu = -1;                                // GPU index
+    int64_t gpu_busy_percent = kTelemetryMissing;
+    int64_t mem_busy_percent = kTelemetryMissing;
+    int64_t vram_used = kTelemetryMissing;       // bytes
+    int64_t vram_total = kTelemetryMissing;
+    int64_t gtt_used = kTelemetryMissing;
+    int64_t gtt_total = kTelemetryMissing;
+};
+
+// One attribute read per tick, parsed straight into its destination
+struct TelemetryRead {
+    int fd;
+    int64_t* value;
+    int gpu;            // GPU index
+    SensorKind kind;
+    const char* name;       // Channel label or short amdgpu name ("busy", "vram")
+    const int64_t* total;   // Fixed capacity the value is a share of, or nullptr
+};
+
+class TelemetrySampler {
+public:
+    explicit TelemetrySampler(const std::string& root = linux_root(), bool use_uring = sysfs_uring_requested())
+        : root_(root), batch_(use_uring) {}
+    
+    TelemetrySampler(const TelemetrySampler&) = delete;
+    TelemetrySampler& operator=(const TelemetrySampler&) = delete;
+    
+    ~TelemetrySampler() {
+        for (int fd : fds_) {
+            ::close(fd);
+        }
+    }
+    
+    // Open every hwmon input below each GPU's device directory:
+    // temp*_input, power*_average (power*_input when there is no average),
+    // fan*_input and in*_input. Cards that expose amdgpu's busy and memory
+    // attributes get an AmdgpuTelemetry record as well.
+    void discover(const std::vector<GPUInfo>& gpus) {
+        SysfsDir drm_dir(SysfsDir(root_), "sys/class/drm");
+        std::vector<PendingRead> amdgpu_reads;
+        for (const auto& gpu : gpus) {
+            std::string device_path = gpu.node + "/device";
+            SysfsDir device(drm_dir, device_path.c_str());
+            SysfsDir hwmon_root(device, "hwmon", true);
+            std::vector<std::string> hwmons;
+            hwmon_root.for_each_entry([&](std::string_view name) {
+                if (name.compare(0, 5, "hwmon") == 0) {
+                    hwmons.emplace_back(name);
+                }
+            });
+            std::sort(hwmons.begin(), hwmons.end());
+            for (const auto& name : hwmons) {
+                SysfsDir hwmon(hwmon_root, name.c_str(), true);
+                discover_hwmon(gpu.index, hwmon);
+            }
+            discover_amdgpu(gpu.index, device, amdgpu_reads);
+        }
+        
+        // Every destination is final now, so the read plan can point at it
+        values_.assign(channels_.size(), kTelemetryMissing);
+        reads_.clear();
+        for (size_t i = 0; i < channels_.size(); ++i) {
+            reads_.push_back({channels_[i].fd, &values_[i], channels_[i].gpu, channels_[i].kind,
+                              channels_[i].label, nullptr});
+        }
+        for (const auto& pending : amdgpu_reads) {
+            AmdgpuTelemetry& card = amdgpu_[pending.card];
+            reads_.push_back({pending.fd, &(card.*pending.field), card.gpu, pending.kind, pending.label,
+                              pending.total ? &(card.*pending.total) : nullptr});
+        }
+        
+        // With io_uring a tick is one submission of every pread
+        batch_reads_.clear();
+        if (batch_.uring()) {
+            batch_buffers_.assign(reads_.size() * kValueBuffer, '\0');
+            for (size_t i = 0; i < reads_.size(); ++i) {
+                batch_reads_.push_back({-1, nullptr, reads_[i].fd, &batch_buffers_[i * kValueBuffer],
+                                        kValueBuffer - 1});
+            }
+        }
+    }
+    
+    // Read every dynamic attribute once, in one pass over the read plan
+    void sample() {
+        if (!batch_reads_.empty()) {
+            batch_.read_all(batch_reads_.data(), batch_reads_.size());
+            for (size_t i = 0; i < reads_.size(); ++i) {
+                ssize_t n = batch_reads_[i].result;
+                *reads_[i].value = n > 0 ? parse_value(batch_reads_[i].buffer, static_cast<size_t>(n))
+                                         : kTelemetryMissing;
+            }
+            return;
+        }
+        char buffer[kValueBuffer];
+        for (const auto& read : reads_) {
+            ssize_t n = ::pread(read.fd, buffer, sizeof(buffer) - 1, 0);
+            stats_read(n);
+            *read.value = n > 0 ? parse_value(buffer, static_cast<size_t>(n)) : kTelemetryMissing;
+        }
+    }
+    
+    const std::vector<AmdgpuTelemetry>& amdgpu() const { return amdgpu_; }
+    const std::vector<TelemetryRead>& reads() const { return reads_; }
+    size_t reads_per_sample() const { return reads_.size(); }
+    bool batched() const { return !batch_reads_.empty(); }
+    const std::vector<TelemetryChannel>& channels() const { return channels_; }
+    const std::vector<int64_t>& values() const { return values_; }
+    
+private:
+    void discover_hwmon(int gpu, const SysfsDir& hwmon) {
+        const size_t first = channels_.size();
+        std::vector<std::string> inputs;
+        hwmon.for_each_entry([&](std::string_view name) {
+            if (name.size() > 6 && name.compare(name.size() - 6, 6, "_input") == 0) {
+                inputs.emplace_back(name);
+            } else if (name.size() > 8 && name.compare(name.size() - 8, 8, "_average") == 0) {
+                inputs.emplace_back(name);
+            }
+        });
+        std::sort(inputs.begin(), inputs.end());
+        
+        for (const auto& name : inputs) {
+            std::string stem = name.substr(0, name.rfind('_'));
+            SensorKind kind;
+            if (stem.compare(0, 4, "temp") == 0) {
+                kind = SensorKind::Temperature;
+            } else if (stem.compare(0, 5, "power") == 0) {
+                kind = SensorKind::Power;
+                // Prefer the averaged reading when a chip offers both
+                if (name.compare(name.size() - 6, 6, "_input") == 0 &&
+                    std::binary_search(inputs.begin(), inputs.end(), stem + "_average")) {
+                    continue;
+                }
+            } else if (stem.compare(0, 3, "fan") == 0) {
+                kind = SensorKind::Fan;
+            } else if (stem.compare(0, 2, "in") == 0) {
+                kind = SensorKind::Voltage;
+            } else {
+                continue;
+            }
+            if (name.compare(name.size() - 8, 8, "_average") == 0 && kind != SensorKind::Power) {
+                continue;
+            }
+            
+            int fd = ::openat(hwmon.fd(), name.c_str(), O_RDONLY | O_CLOEXEC);
+            stats_open();
+            if (fd < 0) {
+                continue;
+            }
+            fds_.push_back(fd);
+            TelemetryChannel channel{gpu, kind, {}, fd};
+            SysfsAttr attr;
+            std::string_view label = stem;
+            if (hwmon.read((stem + "_label").c_str(), attr) && !attr.line().empty()) {
+                label = attr.line();
+            }
+            label = label.substr(0, sizeof(channel.label) - 1);
+            std::memcpy(channel.label, label.data(), label.size());
+            channels_.push_back(channel);
+        }
+        // Temperatures first, then power, fans and voltages
+        std::stable_sort(channels_.begin() + first, channels_.end(),
+                         [](const TelemetryChannel& a, const TelemetryChannel& b) { return a.kind < b.kind; });
+    }
+    
+    struct PendingRead {
+        int fd;
+        size_t card;
+        int64_t AmdgpuTelemetry::*field;
+        int64_t AmdgpuTelemetry::*total;
+        SensorKind kind;
+        const char* label;
+    };
+    
+    // Busy percentages and used memory change every tick and stay open;
+    // the totals are fixed for the life of the device and are read once.
+    void discover_amdgpu(int gpu, const SysfsDir& device, std::vector<PendingRead>& reads) {
+        static const struct {
+            const char* name;
+            int64_t AmdgpuTelemetry::*field;
+            int64_t AmdgpuTelemetry::*total;
+            SensorKind kind;
+            const char* label;   // nullptr for totals, which are read once
+        } attributes[] = {
+            {"gpu_busy_percent", &AmdgpuTelemetry::gpu_busy_percent, nullptr, SensorKind::Utilization, "busy"},
+            {"mem_busy_percent", &AmdgpuTelemetry::mem_busy_percent, nullptr, SensorKind::Utilization, "mem busy"},
+            {"mem_info_vram_used", &AmdgpuTelemetry::vram_used, &AmdgpuTelemetry::vram_total, SensorKind::Memory, "vram"},
+            {"mem_info_vram_total", &AmdgpuTelemetry::vram_total, nullptr, SensorKind::Memory, nullptr},
+            {"mem_info_gtt_used", &AmdgpuTelemetry::gtt_used, &AmdgpuTelemetry::gtt_total, SensorKind::Memory, "gtt"},
+            {"mem_info_gtt_total", &AmdgpuTelemetry::gtt_total, nullptr, SensorKind::Memory, nullptr},
+        };
+        
+        AmdgpuTelemetry card;
+        card.gpu = gpu;
+        bool found = false;
+        SysfsAttr attr;
+        for (const auto& attribute : attributes) {
+            if (!attribute.label) {
+                if (device.read(attribute.name, attr)) {
+                    card.*attribute.field = parse_value(attr.data, std::min(attr.size, sizeof(attr.data) - 1));
+                    found = true;
+                }
+                continue;
+            }
+            int fd = ::openat(device.fd(), attribute.name, O_RDONLY | O_CLOEXEC);
+            stats_open();
+            if (fd >= 0) {
+                fds_.push_back(fd);
+                reads.push_back({fd, amdgpu_.size(), attribute.field, attribute.total, attribute.kind,
+                                 attribute.label});
+                found = true;
+            }
+        }
+        if (found) {
+            amdgpu_.push_back(card);
+        }
+    }
+    
+    static constexpr size_t kValueBuffer = 32;
+    
+    static int64_t parse_value(char* text, size_t size) {
+        text[size] = '\0';
+        char* end = nullptr;
+        errno = 0;
+        long long value = std::strtoll(text, &end, 10);
+        return (end == text || errno != 0) ? kTelemetryMissing : static_cast<int64_t>(value);
+    }
+    
+    std::string root_;
+    std::vector<int> fds_;                    // Every attribute held open
+    std::vector<TelemetryChannel> channels_;  // hwmon inputs
+    std::vector<int64_t> values_;             // Latest reading per channel
+    std::vector<AmdgpuTelemetry> amdgpu_;
+    std::vector<TelemetryRead> reads_;
+    SysfsBatch batch_;
+    std::vector<SysfsRead> batch_reads_;   // reads_ as one io_uring batch
+    std::vector<char> batch_buffers_;
+};
+
+// Telemetry history.
+//
+// Every series (one per sampled value) keeps a fixed ring of buckets per
+// tier: by default 1 s buckets for 5 minutes, 10 s rollups for an hour and
+// 1 min rollups for a day, each with min/max/sum/count. A sample folds
+// into the current bucket of every tier, or starts a new one that
+// overwrites the oldest, so recording is O(tiers) and memory is fixed at
+// construction: series x sum(capacity) x sizeof(HistoryBucket).
+struct HistoryTier {
+    uint32_t period_s;   // Seconds covered by one bucket
+    uint32_t capacity;   // Buckets retained
+};
+
+struct HistoryConfig {
+    static const size_t kMaxTiers = 4;
+    HistoryTier tiers[kMaxTiers] = {{1, 300}, {10, 360}, {60, 1440}, {0, 0}};
+    
+    size_t tier_count() const {
+        size_t count = 0;
+        while (count < kMaxTiers && tiers[count].period_s > 0 && tiers[count].capacity > 0) {
+            ++count;
+        }
+        return count;
+    }
+    
+    size_t buckets_per_series() const {
+        size_t total = 0;
+        for (size_t t = 0; t < tier_count(); ++t) {
+            total += tiers[t].capacity;
+        }
+        return total;
+    }
+};
+
+struct HistoryBucket {
+    int64_t start_s;   // Bucket start, a multiple of the tier period
+    int64_t min;
+    int64_t max;
+    int64_t sum;
+    uint32_t count;
+    
+    double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+};
+
+class TelemetryHistory {
+public:
+    TelemetryHistory(const HistoryConfig& config, size_t series)
+        : config_(config), tiers_(config.tier_count()), series_(series),
+          stride_(config.buckets_per_series()), buckets_(series * stride_),
+          heads_(series * tiers_, kEmpty) {
+        size_t offset = 0;
+        for (size_t t = 0; t < tiers_; ++t) {
+            tier_offsets_[t] = offset;
+            offset += config_.tiers[t].capacity;
+        }
+    }
+    
+    // Bytes held for `series` series under `config`, before any sample
+    static size_t memory_bytes(const HistoryConfig& config, size_t series) {
+        return series * (config.buckets_per_series() * sizeof(HistoryBucket) +
+                         config.tier_count() * sizeof(uint32_t));
+    }
+    
+    size_t series() const { return series_; }
+    
+    // Fold one sample into every tier. Samples older than the newest
+    // bucket of a tier are dropped for that tier; missing values are skipped.
+    void record(size_t series, int64_t time_s, int64_t value) {
+        if (series >= series_ || value == kTelemetryMissing) {
+            return;
+        }
+        for (size_t t = 0; t < tiers_; ++t) {
+            const HistoryTier& tier = config_.tiers[t];
+            int64_t start = time_s - floor_mod(time_s, tier.period_s);
+            uint32_t& head = heads_[series * tiers_ + t];
+            HistoryBucket* ring = tier_ring(series, t);
+            if (head != kEmpty && ring[head].start_s == start) {
+                HistoryBucket& bucket = ring[head];
+                bucket.min = std::min(bucket.min, value);
+                bucket.max = std::max(bucket.max, value);
+                bucket.sum += value;
+                ++bucket.count;
+                continue;
+            }
+            if (head != kEmpty && ring[head].start_s > start) {
+                continue;
+            }
+            head = head == kEmpty ? 0 : (head + 1) % tier.capacity;
+            ring[head] = HistoryBucket{start, value, value, value, 1};
+        }
+    }
+    
+    // Record the latest value of every read in a sampler's plan; series
+    // numbers follow TelemetrySampler::reads()
+    void record(const TelemetrySampler& sampler, int64_t time_s) {
+        const auto& reads = sampler.reads();
+        for (size_t i = 0; i < reads.size() && i < series_; ++i) {
+            record(i, time_s, *reads[i].value);
+        }
+    }
+    
+    // Finest tier whose retained span reaches back to `from_s`; the
+    // coarsest tier when none does
+    size_t tier_for(size_t series, int64_t from_s) const {
+        for (size_t t = 0; t < tiers_; ++t) {
+            uint32_t head = heads_[series * tiers_ + t];
+            if (head == kEmpty) {
+                continue;
+            }
+            const HistoryBucket* ring = tier_ring(series, t);
+            const HistoryBucket& oldest = ring[(head + 1) % config_.tiers[t].capacity];
+            bool wrapped = oldest.count != 0;
+            int64_t reach = wrapped ? oldest.start_s : INT64_MIN;
+            if (reach <= from_s) {
+                return t;
+            }
+        }
+        return tiers_ - 1;
+    }
+    
+    // Buckets of one tier overlapping [from_s, to_s], newest first. Walks
+    // only the buckets returned.
+    template <typename Fn>
+    void for_each_bucket(size_t series, size_t tier, int64_t from_s, int64_t to_s, Fn fn) const {
+        if (series >= series_ || tier >= tiers_ || heads_[series * tiers_ + tier] == kEmpty) {
+            return;
+        }
+        uint32_t head = heads_[series * tiers_ + tier];
+        const HistoryTier& config = config_.tiers[tier];
+        const HistoryBucket* ring = tier_ring(series, tier);
+        for (uint32_t n = 0, i = head; n < config.capacity; ++n, i = (i == 0 ? config.capacity : i) - 1) {
+            const HistoryBucket& bucket = ring[i];
+            if (bucket.count == 0 || bucket.start_s + config.period_s <= from_s) {
+                break;
+            }
+            if (bucket.start_s <= to_s) {
+                fn(bucket);
+            }
+        }
+    }
+    
+    // min/max/sum/count over [from_s, to_s] from the tier that covers it.
+    // Returns false when the series has nothing in that window.
+    bool summarize(size_t series, int64_t from_s, int64_t to_s, HistoryBucket& out) const {
+        if (series >= series_ || tiers_ == 0) {
+            return false;
+        }
+        out = HistoryBucket{from_s, INT64_MAX, INT64_MIN, 0, 0};
+        for_each_bucket(series, tier_for(series, from_s), from_s, to_s, [&](const HistoryBucket& bucket) {
+            out.min = std::min(out.min, bucket.min);
+            out.max = std::max(out.max, bucket.max);
+            out.sum += bucket.sum;
+            out.count += bucket.count;
+        });
+        return out.count > 0;
+    }
+    
+private:
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+    
+    static int64_t floor_mod(int64_t value, uint32_t period) {
+        int64_t mod = value % period;
+        return mod < 0 ? mod + period : mod;
+    }
+    
+    HistoryBucket* tier_ring(size_t series, size_t tier) {
+        return &buckets_[series * stride_ + tier_offsets_[tier]];
+    }
+    const HistoryBucket* tier_ring(size_t series, size_t tier) const {
+        return &buckets_[series * stride_ + tier_offsets_[tier]];
+    }
+    
+    HistoryConfig config_;
+    size_t tiers_;
+    size_t series_;
+    size_t tier_offsets_[HistoryConfig::kMaxTiers] = {};
+    size_t stride_;                 // Buckets per series
+    std::vector<HistoryBucket> buckets_;
+    std::vector<uint32_t> heads_;   // Newest bucket per (series, tier)
+};
+
+// CPU time this process has used, in microseconds
+int64_t self_cpu_micros() {
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// Continuous sampling runs on two threads: a sampler thread that reads
+// sensors on a fixed schedule and an output thread that renders. They
+// share nothing but a bounded ring of fixed-size TelemetrySample records,
+// so a slow terminal or a stalled pipe costs dropped records, never a
+// late sample.
+
+// Values carried per record; reads past this are not sampled
+constexpr size_t kTelemetrySampleValues = 256;
+
+// One sampler tick, copied whole into the ring
+struct TelemetrySample {
+    uint64_t tick;            // 0-based tick number
+    int64_t time_s;           // Wall clock at the tick
+    int64_t read_ns;          // Time spent reading sensors
+    int64_t jitter_ns;        // How late this tick started against its schedule
+    int64_t jitter_max_ns;    // Largest lateness so far
+    int64_t jitter_mean_ns;   // Mean lateness so far
+    uint32_t count;           // Values used, in TelemetrySampler::reads() order
+    int64_t values[kTelemetrySampleValues];
+};
+
+// Single-producer/single-consumer ring with a drop-oldest overflow policy.
+// push() never blocks or fails: once the ring is full it overwrites the
+// oldest record. Each slot carries a sequence stamp that is odd while the
+// producer writes it, so pop() detects a record that was overwritten
+// before or while it was copied out, skips it and counts it in dropped().
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "ring capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "ring records are copied bytewise");
+    
+public:
+    // Producer side
+    void push(const T& value) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[head & (Capacity - 1)];
+        slot.seq.store(2 * head + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&slot.value, &value, sizeof(T));
+        slot.seq.store(2 * head + 2, std::memory_order_release);
+        head_.store(head + 1, std::memory_order_release);
+    }
+    
+    // Consumer side: oldest record still intact, or false when caught up
+    bool pop(T& out) {
+        for (;;) {
+            uint64_t head = head_.load(std::memory_order_acquire);
+            if (tail_ == head) {
+                return false;
+            }
+            if (head - tail_ > Capacity) {
+                dropped_.fetch_add(head - tail_ - Capacity, std::memory_order_relaxed);
+                tail_ = head - Capacity;
+            }
+            Slot& slot = slots_[tail_ & (Capacity - 1)];
+            const uint64_t expected = 2 * tail_ + 2;
+            ++tail_;
+            if (slot.seq.load(std::memory_order_acquire) == expected) {
+                std::memcpy(&out, &slot.value, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq.load(std::memory_order_relaxed) == expected) {
+                    return true;
+                }
+            }
+            // The producer lapped us on this slot
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    uint64_t pushed() const { return head_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        T value;
+    };
+    
+    alignas(64) std::atomic<uint64_t> head_{0};   // Next position to write
+    alignas(64) uint64_t tail_ = 0;               // Next position to read (consumer only)
+    std::atomic<uint64_t> dropped_{0};
+    Slot slots_[Capacity];
+};
+
+// Owns the sampler thread. After start() the TelemetrySampler and the
+// optional history belong to that thread until stop() joins it; the
+// consumer only sees TelemetrySample records. ready_fd() turns readable
+// whenever records are queued or sampling has finished.
+class SamplerThread {
+public:
+    static constexpr size_t kRingRecords = 64;
+    
+    SamplerThread(TelemetrySampler& sampler, TelemetryHistory* history, std::chrono::nanoseconds interval,
+                  uint64_t count)
+        : sampler_(sampler), history_(history), interval_(interval), count_(count) {}
+    
+    SamplerThread(const SamplerThread&) = delete;
+    SamplerThread& operator=(const SamplerThread&) = delete;
+    
+    ~SamplerThread() {
+        stop();
+        for (int fd : {ready_fd_, stop_fd_}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+    
+    bool start() {
+        ready_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        stop_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (ready_fd_ < 0 || stop_fd_ < 0) {
+            return false;
+        }
+        thread_ = std::thread([this] { run(); });
+        return true;
+    }
+    
+    void stop() {
+        if (!thread_.joinable()) {
+            return;
+        }
+        uint64_t one = 1;
+        ssize_t ignored = ::write(stop_fd_, &one, sizeof(one));
+        (void)ignored;
+        thread_.join();
+    }
+    
+    int ready_fd() const { return ready_fd_; }
+    
+    // Clear ready_fd() before draining with pop()
+    void acknowledge() {
+        uint64_t pending;
+        ssize_t ignored = ::read(ready_fd_, &pending, sizeof(pending));
+        (void)ignored;
+    }
+    
+    bool pop(TelemetrySample& sample) { return ring_.pop(sample); }
+    bool finished() const { return finished_.load(std::memory_order_acquire); }
+    uint64_t dropped() const { return ring_.dropped(); }
+    
+private:
+    void run() {
+        // Signals are handled by the thread that started us
+        sigset_t all;
+        sigfillset(&all);
+        ::pthread_sigmask(SIG_BLOCK, &all, nullptr);
+        
+        const auto& reads = sampler_.reads();
+        const size_t count = std::min(reads.size(), kTelemetrySampleValues);
+        TelemetrySample sample{};
+        int64_t jitter_sum = 0;
+        auto next = std::chrono::steady_clock::now();
+        for (uint64_t tick = 0; count_ == 0 || tick < count_; ++tick) {
+            auto before = std::chrono::steady_clock::now();
+            sampler_.sample();
+            auto after = std::chrono::steady_clock::now();
+            if (history_) {
+                history_->record(sampler_, static_cast<int64_t>(std::time(nullptr)));
+            }
+            
+            int64_t jitter = std::chrono::duration_cast<std::chrono::nanoseconds>(before - next).count();
+            jitter_sum += jitter;
+            sample.tick = tick;
+            sample.time_s = static_cast<int64_t>(std::time(nullptr));
+            sample.read_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count();
+            sample.jitter_ns = jitter;
+            sample.jitter_max_ns = std::max(sample.jitter_max_ns, jitter);
+            sample.jitter_mean_ns = jitter_sum / static_cast<int64_t>(tick + 1);
+            sample.count = static_cast<uint32_t>(count);
+            for (size_t i = 0; i < count; ++i) {
+                sample.values[i] = *reads[i].value;
+            }
+            ring_.push(sample);
+            notify();
+            GPU_USDT(sample, sample.tick, sample.count, sample.read_ns);
+            
+            if (count_ != 0 && tick + 1 == count_) {
+                break;
+            }
+            // Fixed schedule: a slow tick shortens the next wait instead of
+            // shifting every later sample
+            next += interval_;
+            auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(next - std::chrono::steady_clock::now());
+            if (wait.count() < 0) {
+                next = std::chrono::steady_clock::now();
+                wait = std::chrono::nanoseconds(0);
+            }
+            timespec timeout{static_cast<time_t>(wait.count() / 1000000000),
+                             static_cast<long>(wait.count() % 1000000000)};
+            pollfd pfd{stop_fd_, POLLIN, 0};
+            if (::ppoll(&pfd, 1, &timeout, nullptr) > 0) {
+                break;
+            }
+        }
+        finished_.store(true, std::memory_order_release);
+        notify();
+    }
+    
+    // eventfd writes only add to a counter; they do not block
+    void notify() {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(ready_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+    
+    TelemetrySampler& sampler_;
+    TelemetryHistory* history_;
+    std::chrono::nanoseconds interval_;
+    uint64_t count_;
+    int ready_fd_ = -1;
+    int stop_fd_ = -1;
+    std::atomic<bool> finished_{false};
+    std::thread thread_;
+    SpscRing<TelemetrySample, kRingRecords> ring_;
+};
+#endif
+
+#ifdef PLATFORM_WINDOWS
+// Windows GPU detection using Setup API
+std::vector<GPUInfo> detect_gpus_windows() {
+    std::vector<GPUInfo> gpus;
+    
+    // Initialize device information set for display adapters
+    HDEVINFO deviceInfoSet = SetupDiGetClassDevs(&GUID_DEVCLASS_DISPLAY, NULL, NULL, DIGCF_PRESENT);
+    if (deviceInfoSet == INVALID_HANDLE_VALUE) {
+        return gpus;
+    }
+    
+    SP_DEVINFO_DATA deviceInfoData;
+    deviceInfoData.cbSize = sizeof(SP_DEVINFO_DATA);
+    
+    int gpu_index = 0;
+    for (DWORD i = 0; SetupDiEnumDeviceInfo(deviceInfoSet, i, &deviceInfoData); i++) {
+        GPUInfo gpu;
+        gpu.index = gpu_index++;
+        gpu.is_active = (gpu.index == 0);
+        
+        // Get device description (GPU name)
+        char buffer[256];
+        if (SetupDiGetDeviceRegistryPropertyA(deviceInfoSet, &deviceInfoData, SPDRP_DEVICEDESC,
+                                              NULL, (PBYTE)buffer, sizeof(buffer), NULL)) {
+            gpu.name = buffer;
+        }
+        
+        // Get manufacturer (vendor)
+        if (SetupDiGetDeviceRegistryPropertyA(deviceInfoSet, &deviceInfoData, SPDRP_MFG,
+                                              NULL, (PBYTE)buffer, sizeof(buffer), NULL)) {
+            gpu.vendor = buffer;
+        }
+        
+        // Get driver version
+        if (SetupDiGetDeviceRegistryPropertyA(deviceInfoSet, &deviceInfoData, SPDRP_DRIVER,
+                                              NULL, (PBYTE)buffer, sizeof(buffer), NULL)) {
+            gpu.driver_version = buffer;
+        }
+        
+        // Get hardware ID for PCI information
+        if (SetupDiGetDeviceRegistryPropertyA(deviceInfoSet, &deviceInfoData, SPDRP_HARDWAREID,
+                                              NULL, (PBYTE)buffer, sizeof(buffer), NULL)) {
+            std::string hwid = buffer;
+            // Parse PCI\VEN_XXXX&DEV_XXXX format
+            size_t ven_pos = hwid.find("VEN_");
+            size_t dev_pos = hwid.find("DEV_");
+            if (ven_pos != std::string::npos && dev_pos != std::string::npos) {
+                std::string vendor = hwid.substr(ven_pos + 4, 4);
+                std::string device = hwid.substr(dev_pos + 4, 4);
+                gpu.pci_id = vendor + ":" + device;
+            }
+        }
+        
+        gpu.populated = true;
+        gpus.push_back(gpu);
+    }
+    
+    SetupDiDestroyDeviceInfoList(deviceInfoSet);
+    return gpus;
+}
+#endif
+
+#ifdef PLATFORM_MACOS
+// macOS GPU detection using IOKit (placeholder)
+std::vector<GPUInfo> detect_gpus_macos() {
+    std::vector<GPUInfo> gpus;
+    
+    // TODO: Implement IOKit-based GPU detection
+    GPUInfo gpu;
+    gpu.index = 0;
+    gpu.is_active = true;
+    gpu.name = "macOS GPU (detection not implemented)";
+    gpu.vendor = "Unknown";
+    gpu.driver_version = "N/A";
+    gpu.pci_id = "N/A";
+    gpu.populated = true;
+    gpus.push_back(gpu);
+    
+    return gpus;
+}
+#endif
+
+// Cross-platform GPU detection
+std::vector<GPUInfo> detect_gpus() {
+#ifdef PLATFORM_LINUX
+    std::vector<GPUInfo> gpus;
+    if (load_published_inventory(gpus)) {
+        return gpus;
+    }
+    return detect_gpus_linux_cached();
+#elif defined(PLATFORM_WINDOWS)
+    return detect_gpus_windows();
+#elif defined(PLATFORM_MACOS)
+    return detect_gpus_macos();
+#else
+    return {};
+#endif
+}
+
+// Cross-platform GPU enumeration. Lists every GPU with its index and active
+// flag; identity fields are only filled in where that comes for free
+// (populated is set), so single-GPU views can populate just the one they show.
+std::vector<GPUInfo> enumerate_gpus() {
+#ifdef PLATFORM_LINUX
+    std::vector<GPUInfo> gpus;
+    if (load_published_inventory(gpus)) {
+        return gpus;
+    }
+    InventoryKey key;
+    return enumerate_gpus_linux_cached(linux_root(), key);
+#else
+    return detect_gpus();
+#endif
+}
+
+// Fill in the identity fields of one enumerated GPU
+void populate_gpu(GPUInfo& gpu) {
+    if (gpu.populated) {
+        return;
+    }
+#ifdef PLATFORM_LINUX
+    populate_gpu_linux(gpu);
+#endif
+}
+
+// Display a single GPU
+void display_gpu(TextBuffer& out, const GPUInfo& gpu, bool brief = false) {
+    if (brief) {
+        out << Color::BOLD << "GPU " << gpu.index << Color::RESET;
+        if (gpu.is_active) {
+            out << ' ' << Color::GREEN << "(Active)" << Color::RESET;
+        }
+        out << '\n';
+        print_field(out, "Name", gpu.name);
+        print_field(out, "Vendor", gpu.vendor);
+        if (!gpu.board.empty()) {
+            print_field(out, "Board", gpu.board);
+        }
+        if (!gpu.pci_id.empty()) {
+            print_field(out, "PCI ID", gpu.pci_id);
+        }
+    } else {
+        char title[48];
+        std::snprintf(title, sizeof(title), "GPU %d%s", gpu.index, gpu.is_active ? " (Active)" : "");
+        print_header(out, title);
+        print_field(out, "Name", gpu.name);
+        print_field(out, "Vendor", gpu.vendor);
+        if (!gpu.board.empty()) {
+            print_field(out, "Board", gpu.board);
+        }
+        if (!gpu.driver.empty()) {
+            print_field(out, "Driver", gpu.driver);
+        }
+        if (!gpu.driver_version.empty() && gpu.driver_version != "N/A") {
+            print_field(out, "Driver Version", gpu.driver_version);
+        }
+        if (!gpu.pci_id.empty() && gpu.pci_id != "N/A") {
+            print_field(out, "PCI ID", gpu.pci_id);
+        }
+    }
+}
+
+// Display all GPUs
+void display_all_gpus(const std::vector<GPUInfo>& gpus) {
+    TraceSpan span("output");
+    StatsPhaseScope phase(kPhaseOutput);
+    TextBuffer& out = output_buffer();
+    if (gpus.empty()) {
+        out << Color::YELLOW << "No GPUs detected." << Color::RESET << '\n';
+        out.flush();
+        return;
+    }
+    
+    char title[48];
+    std::snprintf(title, sizeof(title), "All GPUs (%zu detected)", gpus.size());
+    print_header(out, title);
+    for (const auto& gpu : gpus) {
+        display_gpu(out, gpu, true);
+        if (&gpu != &gpus.back()) {
+            out << '\n';
+        }
+    }
+    out.flush();
+}
+
+// Display help
+void display_help() {
+    TextBuffer& out = output_buffer();
+    out << Color::BOLD << "GPU Plugin for whatsmycli" << Color::RESET << "\n\n";
+    out << "Usage:\n";
+    out << "  whatsmy gpu           " << Color::DIM << "# Show active/default GPU" << Color::RESET << "\n";
+    out << "  whatsmy gpu all       " << Color::DIM << "# Show all GPUs" << Color::RESET << "\n";
+    out << "  whatsmy gpu <index>   " << Color::DIM << "# Show specific GPU by index" << Color::RESET << "\n";
+    out << "  whatsmy gpu help      " << Color::DIM << "# Show this help" << Color::RESET << "\n";
+#ifdef PLATFORM_LINUX
+    out << "  whatsmy gpu monitor   " << Color::DIM << "# Follow GPU hotplug events" << Color::RESET << "\n";
+    out << "      --replay <file>   " << Color::DIM << "# Read uevents from a file instead of the kernel" << Color::RESET << "\n";
+    out << "  whatsmy gpu daemon    " << Color::DIM << "# Serve the inventory to other invocations" << Color::RESET << "\n";
+    out << "      --socket <path>   " << Color::DIM << "# Listen here instead of $XDG_RUNTIME_DIR" << Color::RESET << "\n";
+    out << "  whatsmy gpu watch     " << Color::DIM << "# Sample sensors, utilization and VRAM use" << Color::RESET << "\n";
+    out << "      --interval <ms>   " << Color::DIM << "# Time between samples (default 1000)" << Color::RESET << "\n";
+    out << "      --count <n>       " << Color::DIM << "# Stop after n samples" << Color::RESET << "\n";
+    out << "      --history         " << Color::DIM << "# Print 1m/10m/1h min/mean/max on exit" << Color::RESET << "\n";
+    out << "  whatsmy gpu prompt    " << Color::DIM << "# One plain line for shell prompts, e.g. \"RTX 4090 62\xC2\xB0" "C 41%\"" << Color::RESET << "\n";
+    out << "\nOptions:\n";
+    out << "  --deadline <time>      " << Color::DIM << "# Bound all probing, e.g. 50ms; late fields read \"" << kProbeTimeout << "\"" << Color::RESET << "\n";
+    out << "  --attr-deadline <time> " << Color::DIM << "# Bound each attribute read (default: --deadline)" << Color::RESET << "\n";
+    out << "  --stats                " << Color::DIM << "# Print I/O per phase, heap use and peak RSS on exit" << Color::RESET << "\n";
+    out << "  --json, --ndjson       " << Color::DIM << "# One JSON document, or one record per line (--format=...)" << Color::RESET << "\n";
+    out << "  --format=cbor          " << Color::DIM << "# Compact binary records, see docs/cbor-schema.md" << Color::RESET << "\n";
+#endif
+    out.flush();
+}
+
+#ifdef PLATFORM_LINUX
+// An inventory change as a "change" record, `gpu` being what is on the
+// node now (nullptr once removed)
+void write_change_json(TextBuffer& out, const InventoryChange& change, const GPUInfo* gpu, long long time_ms) {
+    JsonWriter json(out);
+    json.begin_record("change");
+    json.field("time_ms", time_ms);
+    json.field("kind", change.kind == InventoryChange::Added ? "added" :
+                       change.kind == InventoryChange::Removed ? "removed" : "changed");
+    json.field("node", change.node);
+    json.key("gpu");
+    if (gpu) {
+        json.begin_object();
+        write_gpu_fields(json, *gpu);
+        json.end_object();
+    } else {
+        json.null();
+    }
+    json.end_object().end_line();
+}
+
+void write_change_cbor(TextBuffer& out, const InventoryChange& change, const GPUInfo* gpu, long long time_ms) {
+    CborWriter cbor(out);
+    cbor.begin_record(kCborChangeRecord, 4);
+    cbor.field(kCborTimeMs, time_ms);
+    cbor.field(kCborKind, static_cast<int>(change.kind));
+    cbor.text_field(kCborNode, change.node);
+    cbor.key(kCborGpus).array(gpu ? 1 : 0);
+    if (gpu) {
+        cbor.map(9);
+        write_gpu_fields(cbor, *gpu);
+    }
+}
+
+// Print one inventory change with a local timestamp, or as a "change" record
+void print_change(const InventoryChange& change, const std::vector<GPUInfo>& gpus) {
+    auto now = std::chrono::system_clock::now();
+    if (output_format != OutputFormat::Text) {
+        const long long time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now.time_since_epoch()).count();
+        auto gpu = std::find_if(gpus.begin(), gpus.end(), [&](const GPUInfo& g) { return g.node == change.node; });
+        const GPUInfo* current = gpu == gpus.end() ? nullptr : &*gpu;
+        if (output_format == OutputFormat::Cbor) {
+            write_change_cbor(output_buffer(), change, current, time_ms);
+        } else {
+            write_change_json(output_buffer(), change, current, time_ms);
+        }
+        output_buffer().flush();
+        return;
+    }
+    std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    std::tm local;
+    localtime_r(&seconds, &local);
+    char stamp[32];
+    std::snprintf(stamp, sizeof(stamp), "%02d:%02d:%02d.%03d",
+                  local.tm_hour, local.tm_min, local.tm_sec, static_cast<int>(millis));
+    
+    const char* what = change.kind == InventoryChange::Added ? "added  " :
+                       change.kind == InventoryChange::Removed ? "removed" : "changed";
+    const char* color = change.kind == InventoryChange::Removed ? Color::YELLOW : Color::GREEN;
+    TextBuffer& out = output_buffer();
+    out << Color::DIM << stamp << Color::RESET << ' ' << color << what << Color::RESET << ' ' << change.node;
+    for (const auto& gpu : gpus) {
+        if (gpu.node == change.node) {
+            out << "  GPU " << gpu.index << ": " << gpu.name;
+        }
+    }
+    out << '\n';
+    out.flush();
+}
+
+// Follow GPU hotplug: one full scan, then a line per uevent that changed
+// the inventory. Runs until interrupted, or until a replay file ends.
+int run_monitor(int argc, char* argv[]) {
+    std::string replay;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--replay" && i + 1 < argc) {
+            replay = argv[++i];
+        } else {
+            std::cerr << Color::WARN << "Error: Invalid argument '" << arg << "'." << Color::WARN_END << "\n";
+            std::cerr << "Use 'whatsmy gpu help' for usage information.\n";
+            return 1;
+        }
+    }
+    
+    // Subscribe before scanning so no event between the two is lost
+    UeventSource source;
+    if (replay.empty() ? !source.open_netlink() : !source.open_replay(replay)) {
+        std::cerr << Color::WARN << "Error: " << (replay.empty() ? "Cannot subscribe to kernel uevents"
+                                                                   : "Cannot read replay file '" + replay + "'")
+                  << "." << Color::WARN_END << "\n";
+        return 1;
+    }
+    
+    ResidentInventory inventory;
+    inventory.scan();
+    if (output_format != OutputFormat::Text) {
+        write_gpus(output_buffer(), *inventory.snapshot());
+        output_buffer().flush();
+    } else {
+        display_all_gpus(*inventory.snapshot());
+        output_buffer() << '\n' << Color::DIM << "Watching for GPU hotplug events (Ctrl+C to stop)" << Color::RESET
+                        << '\n';
+        output_buffer().flush();
+    }
+    
+    UeventMessage msg;
+    for (;;) {
+        while (source.next(msg)) {
+            if (msg.overflow) {
+                for (const auto& change : inventory.rescan()) {
+                    print_change(change, *inventory.snapshot());
+                }
+                continue;
+            }
+            InventoryChange change = inventory.apply(msg);
+            if (change.kind != InventoryChange::None) {
+                print_change(change, *inventory.snapshot());
+            }
+        }
+        if (source.replaying()) {
+            return 0;
+        }
+        pollfd pfd{source.fd(), POLLIN, 0};
+        ::poll(&pfd, 1, -1);
+    }
+}
+#endif
+
+#ifdef PLATFORM_LINUX
+// Keep the inventory in memory and answer queries on a Unix socket until
+// SIGINT/SIGTERM. plugin_run talks to it whenever it is reachable.
+int run_daemon(int argc, char* argv[]) {
+    std::string path = daemon_socket_path();
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            std::cerr << Color::WARN << "Error: Invalid argument '" << arg << "'." << Color::WARN_END << "\n";
+            std::cerr << "Use 'whatsmy gpu help' for usage information.\n";
+            return 1;
+        }
+    }
+    
+    // Subscribe before scanning so no event between the two is lost;
+    // without uevents the daemon still serves its initial scan.
+    UeventSource source;
+    bool subscribed = source.open_netlink();
+    ResidentInventory inventory;
+    inventory.scan();
+    
+    InventoryServer server(inventory, subscribed ? &source : nullptr);
+    std::string error;
+    if (!server.listen(path, error)) {
+        std::cerr << Color::WARN << "Error: " << error << "." << Color::WARN_END << "\n";
+        return 1;
+    }
+    server.handle_signals();
+    
+    // Readers that can map /dev/shm skip the socket round trip entirely
+    ShmInventoryPublisher publisher;
+    bool published = publisher.create(shm_segment_name(), error);
+    if (!published) {
+        std::cerr << Color::WARN << "Warning: " << error << "; clients will use the socket."
+                  << Color::WARN_END << "\n";
+    } else {
+        publisher.publish(*inventory.snapshot());
+    }
+    server.on_change([&](const InventoryChange& change) {
+        if (published) {
+            publisher.publish(*inventory.snapshot());
+        }
+        print_change(change, *inventory.snapshot());
+    });
+    
+    if (output_format != OutputFormat::Text) {
+        const std::string shm = published ? shm_segment_name() : std::string();
+        const long long count = static_cast<long long>(inventory.snapshot()->size());
+        if (output_format == OutputFormat::Cbor) {
+            CborWriter cbor(output_buffer());
+            cbor.begin_record(kCborDaemonRecord, 4);
+            cbor.text_field(kCborSocket, path);
+            cbor.text_field(kCborShm, shm);
+            cbor.field(kCborGpuCount, count);
+            cbor.field(kCborHotplug, subscribed);
+        } else {
+            JsonWriter json(output_buffer());
+            json.begin_record("daemon");
+            json.field("socket", path);
+            json.text_field("shm", shm);
+            json.field("gpus", count);
+            json.field("hotplug", subscribed);
+            json.end_object().end_line();
+        }
+        output_buffer().flush();
+        server.run();
+        return 0;
+    }
+    TextBuffer& out = output_buffer();
+    out << "Serving " << inventory.snapshot()->size() << " GPU(s) on " << path;
+    if (published) {
+        out << " and /dev/shm" << shm_segment_name();
+    }
+    out << '\n';
+    if (!subscribed) {
+        out << Color::YELLOW << "Warning: kernel uevents unavailable; hotplug will not be tracked." << Color::RESET
+            << '\n';
+    }
+    out.flush();
+    server.run();
+    return 0;
+}
+#endif
+
+// Explain an empty inventory on stderr
+void warn_no_gpus() {
+    std::cerr << Color::WARN << "Warning: No GPUs detected." << Color::WARN_END << "\n";
+    std::cerr << "This could mean:\n";
+    std::cerr << "  - No GPU is present in the system\n";
+    std::cerr << "  - GPU drivers are not installed\n";
+    std::cerr << "  - Insufficient permissions to access GPU information\n";
+}
+
+#ifdef PLATFORM_LINUX
+// Format one telemetry value in display units
+void format_telemetry(char* out, size_t size, SensorKind kind, int64_t value) {
+    if (value == kTelemetryMissing) {
+        std::snprintf(out, size, "--");
+        return;
+    }
+    switch (kind) {
+        case SensorKind::Temperature:
+            std::snprintf(out, size, "%.1f C", value / 1000.0);
+            break;
+        case SensorKind::Power:
+            std::snprintf(out, size, "%.1f W", value / 1000000.0);
+            break;
+        case SensorKind::Fan:
+            std::snprintf(out, size, "%lld RPM", static_cast<long long>(value));
+            break;
+        case SensorKind::Voltage:
+            std::snprintf(out, size, "%.3f V", value / 1000.0);
+            break;
+        case SensorKind::Utilization:
+            std::snprintf(out, size, "%lld%%", static_cast<long long>(value));
+            break;
+        case SensorKind::Memory:
+            std::snprintf(out, size, "%.1f GiB", value / (1024.0 * 1024.0 * 1024.0));
+            break;
+    }
+}
+
+// One line per GPU with every value of a sampler tick, then the watcher's
+// own cost (a negative CPU share means not measured yet)
+void print_telemetry(TextBuffer& out, const std::vector<GPUInfo>& gpus, const std::vector<TelemetryRead>& reads,
+                     const TelemetrySample& sample, double self_cpu_percent, uint64_t dropped) {
+    char value[48];
+    for (const auto& gpu : gpus) {
+        out << Color::BOLD << "GPU " << gpu.index << Color::RESET << ' ' << Color::DIM << gpu.node << Color::RESET;
+        for (size_t i = 0; i < sample.count; ++i) {
+            if (reads[i].gpu != gpu.index) {
+                continue;
+            }
+            const int64_t current = sample.values[i];
+            if (reads[i].total && *reads[i].total != kTelemetryMissing && current != kTelemetryMissing) {
+                const double gib = 1024.0 * 1024.0 * 1024.0;
+                std::snprintf(value, sizeof(value), "%.1f/%.1f GiB", current / gib, *reads[i].total / gib);
+            } else {
+                format_telemetry(value, sizeof(value), reads[i].kind, current);
+            }
+            out << "  " << Color::GREEN << reads[i].name << Color::RESET << ' ' << value;
+        }
+        out << '\n';
+    }
+    char cpu[24];
+    if (self_cpu_percent < 0) {
+        std::snprintf(cpu, sizeof(cpu), "--");
+    } else {
+        std::snprintf(cpu, sizeof(cpu), "%.2f%%", self_cpu_percent);
+    }
+    char self[160];
+    std::snprintf(self, sizeof(self),
+                  "self: %s CPU, %u reads, %lld us per sample, jitter %lld us avg / %lld us max, %llu dropped",
+                  cpu, sample.count, static_cast<long long>(sample.read_ns / 1000),
+                  static_cast<long long>(sample.jitter_mean_ns / 1000),
+                  static_cast<long long>(sample.jitter_max_ns / 1000), static_cast<unsigned long long>(dropped));
+    out << Color::DIM << self << Color::RESET << '\n';
+}
+
+// min/mean/max of every series over the trailing minute, 10 minutes and
+// hour, each answered from the history tier that covers it
+void print_history_summary(TextBuffer& out, const TelemetrySampler& sampler, const TelemetryHistory& history,
+                           int64_t now_s) {
+    static const struct { const char* label; int64_t seconds; } windows[] = {
+        {"1m", 60}, {"10m", 600}, {"1h", 3600}};
+    const auto& reads = sampler.reads();
+    char low[32], mean[32], high[32];
+    print_header(out, "History");
+    for (size_t i = 0; i < reads.size(); ++i) {
+        out << "  " << Color::BOLD << "GPU " << reads[i].gpu << Color::RESET << ' ' << Color::GREEN << reads[i].name
+            << Color::RESET;
+        for (const auto& window : windows) {
+            HistoryBucket summary;
+            if (!history.summarize(i, now_s - window.seconds + 1, now_s, summary)) {
+                continue;
+            }
+            format_telemetry(low, sizeof(low), reads[i].kind, summary.min);
+            format_telemetry(mean, sizeof(mean), reads[i].kind, static_cast<int64_t>(summary.mean()));
+            format_telemetry(high, sizeof(high), reads[i].kind, summary.max);
+            out << "  " << Color::DIM << window.label << Color::RESET << ' ' << low << " / " << mean << " / "
+                << high;
+        }
+        out << '\n';
+    }
+    out << Color::DIM << "min / mean / max; " << history.series() << " series in "
+        << TelemetryHistory::memory_bytes(HistoryConfig(), history.series()) / 1024 << " KiB" << Color::RESET << '\n';
+}
+
+// SensorKind names and raw units in --json records
+const char* sensor_kind_name(SensorKind kind) {
+    switch (kind) {
+        case SensorKind::Temperature: return "temperature";
+        case SensorKind::Power: return "power";
+        case SensorKind::Fan: return "fan";
+        case SensorKind::Voltage: return "voltage";
+        case SensorKind::Utilization: return "utilization";
+        case SensorKind::Memory: return "memory";
+    }
+    return "";
+}
+
+const char* sensor_unit(SensorKind kind) {
+    switch (kind) {
+        case SensorKind::Temperature: return "mC";
+        case SensorKind::Power: return "uW";
+        case SensorKind::Fan: return "rpm";
+        case SensorKind::Voltage: return "mV";
+        case SensorKind::Utilization: return "percent";
+        case SensorKind::Memory: return "bytes";
+    }
+    return "";
+}
+
+// A sampler tick as one "sample" record, values in raw sensor units
+void write_sample_json(TextBuffer& out, const std::vector<TelemetryRead>& reads, const TelemetrySample& sample,
+                       double self_cpu_percent, uint64_t dropped) {
+    JsonWriter json(out);
+    json.begin_record("sample");
+    json.field("tick", static_cast<long long>(sample.tick));
+    json.field("time", static_cast<long long>(sample.time_s));
+    json.field("read_ns", static_cast<long long>(sample.read_ns));
+    json.field("jitter_ns", static_cast<long long>(sample.jitter_ns));
+    json.field("jitter_mean_ns", static_cast<long long>(sample.jitter_mean_ns));
+    json.field("jitter_max_ns", static_cast<long long>(sample.jitter_max_ns));
+    json.key("cpu_percent");
+    if (self_cpu_percent < 0) {
+        json.null();
+    } else {
+        json.value(self_cpu_percent);
+    }
+    json.field("dropped", static_cast<long long>(dropped));
+    json.key("values").begin_array();
+    for (size_t i = 0; i < sample.count; ++i) {
+        json.begin_object();
+        json.field("gpu", reads[i].gpu);
+        json.field("name", reads[i].name);
+        json.field("kind", sensor_kind_name(reads[i].kind));
+        json.field("unit", sensor_unit(reads[i].kind));
+        json.key("value");
+        if (sample.values[i] == kTelemetryMissing) {
+            json.null();
+        } else {
+            json.value(static_cast<long long>(sample.values[i]));
+        }
+        json.key("total");
+        if (!reads[i].total || *reads[i].total == kTelemetryMissing) {
+            json.null();
+        } else {
+            json.value(static_cast<long long>(*reads[i].total));
+        }
+        json.end_object();
+    }
+    json.end_array().end_object().end_line();
+}
+
+// What each value of a CBOR "sample" is, written once before the first
+void write_channels_cbor(TextBuffer& out, const std::vector<TelemetryRead>& reads) {
+    CborWriter cbor(out);
+    cbor.begin_record(kCborChannelsRecord, 1).key(kCborChannels).array(reads.size());
+    for (const auto& read : reads) {
+        cbor.map(4);
+        cbor.field(kCborGpu, read.gpu);
+        cbor.field(kCborName, std::string_view(read.name));
+        cbor.field(kCborKind, static_cast<int>(read.kind));
+        cbor.key(kCborTotal);
+        if (!read.total || *read.total == kTelemetryMissing) {
+            cbor.null();
+        } else {
+            cbor.value(static_cast<long long>(*read.total));
+        }
+    }
+}
+
+void write_sample_cbor(TextBuffer& out, const TelemetrySample& sample, double self_cpu_percent, uint64_t dropped) {
+    CborWriter cbor(out);
+    cbor.begin_record(kCborSampleRecord, 9);
+    cbor.field(kCborTick, sample.tick);
+    cbor.field(kCborTime, static_cast<long long>(sample.time_s));
+    cbor.field(kCborReadNs, static_cast<long long>(sample.read_ns));
+    cbor.field(kCborJitterNs, static_cast<long long>(sample.jitter_ns));
+    cbor.field(kCborJitterMeanNs, static_cast<long long>(sample.jitter_mean_ns));
+    cbor.field(kCborJitterMaxNs, static_cast<long long>(sample.jitter_max_ns));
+    cbor.key(kCborCpu);
+    if (self_cpu_percent < 0) {
+        cbor.null();
+    } else {
+        cbor.value(std::llround(self_cpu_percent * 100));
+    }
+    cbor.field(kCborDropped, dropped);
+    cbor.key(kCborValues).array(sample.count);
+    for (size_t i = 0; i < sample.count; ++i) {
+        if (sample.values[i] == kTelemetryMissing) {
+            cbor.null();
+        } else {
+            cbor.value(static_cast<long long>(sample.values[i]));
+        }
+    }
+}
+
+// A sampler tick in the selected format
+void write_sample(TextBuffer& out, const std::vector<TelemetryRead>& reads, const TelemetrySample& sample,
+                  double self_cpu_percent, uint64_t dropped) {
+    if (output_format == OutputFormat::Cbor) {
+        write_sample_cbor(out, sample, self_cpu_percent, dropped);
+    } else {
+        write_sample_json(out, reads, sample, self_cpu_percent, dropped);
+    }
+}
+
+// The summary of print_history_summary() as one "history" record
+void write_history_json(TextBuffer& out, const TelemetrySampler& sampler, const TelemetryHistory& history,
+                        int64_t now_s) {
+    static const struct { const char* label; int64_t seconds; } windows[] = {
+        {"1m", 60}, {"10m", 600}, {"1h", 3600}};
+    const auto& reads = sampler.reads();
+    JsonWriter json(out);
+    json.begin_record("history").key("series").begin_array();
+    for (size_t i = 0; i < reads.size(); ++i) {
+        json.begin_object();
+        json.field("gpu", reads[i].gpu);
+        json.field("name", reads[i].name);
+        json.field("kind", sensor_kind_name(reads[i].kind));
+        json.field("unit", sensor_unit(reads[i].kind));
+        json.key("windows").begin_array();
+        for (const auto& window : windows) {
+            HistoryBucket summary;
+            if (!history.summarize(i, now_s - window.seconds + 1, now_s, summary)) {
+                continue;
+            }
+            json.begin_object();
+            json.field("window", window.label);
+            json.field("seconds", static_cast<long long>(window.seconds));
+            json.field("min", static_cast<long long>(summary.min));
+            json.field("mean", summary.mean());
+            json.field("max", static_cast<long long>(summary.max));
+            json.end_object();
+        }
+        json.end_array().end_object();
+    }
+    json.end_array().end_object().end_line();
 }
 
-// Helper function to print section headers
-void print_header(const std::string& text) {
-    std::cout << "\n" << Color::BOLD << Color::CYAN << text << Color::RESET << "\n";
-    std::cout << std::string(50, '=') << "\n";
+void write_history_cbor(TextBuffer& out, const TelemetrySampler& sampler, const TelemetryHistory& history,
+                        int64_t now_s) {
+    static const int64_t windows[] = {60, 600, 3600};
+    CborWriter cbor(out);
+    cbor.begin_record(kCborHistoryRecord, 1).key(kCborSeries).array(sampler.reads().size());
+    for (size_t i = 0; i < sampler.reads().size(); ++i) {
+        // Windows without data are left out, so count them first
+        struct { int64_t seconds; HistoryBucket summary; } found[3];
+        size_t count = 0;
+        for (int64_t seconds : windows) {
+            if (history.summarize(i, now_s - seconds + 1, now_s, found[count].summary)) {
+                found[count++].seconds = seconds;
+            }
+        }
+        cbor.map(2).field(kCborChannel, static_cast<uint64_t>(i)).key(kCborWindows).array(count);
+        for (size_t w = 0; w < count; ++w) {
+            cbor.map(4);
+            cbor.field(kCborSeconds, static_cast<long long>(found[w].seconds));
+            cbor.field(kCborMin, static_cast<long long>(found[w].summary.min));
+            cbor.field(kCborMean, std::llround(found[w].summary.mean()));
+            cbor.field(kCborMax, static_cast<long long>(found[w].summary.max));
+        }
+    }
 }
 
-// Helper function to print key-value pairs
-void print_field(const std::string& key, const std::string& value) {
-    std::cout << "  " << Color::GREEN << key << ": " << Color::RESET << value << "\n";
+void write_history(TextBuffer& out, const TelemetrySampler& sampler, const TelemetryHistory& history,
+                   int64_t now_s) {
+    if (output_format == OutputFormat::Cbor) {
+        write_history_cbor(out, sampler, history, now_s);
+    } else {
+        write_history_json(out, sampler, history, now_s);
+    }
 }
 
-// Get vendor name from PCI ID
-std::string get_vendor_name(const std::string& vendor_id) {
-    std::string id = vendor_id;
-    // Convert to lowercase for comparison
-    std::transform(id.begin(), id.end(), id.begin(), ::tolower);
-    
-    if (id == "0x10de" || id == "10de") return "NVIDIA";
-    if (id == "0x1002" || id == "1002") return "AMD";
-    if (id == "0x8086" || id == "8086") return "Intel";
-    return "Unknown";
+// Parse "50ms", "2s", "500us" or a bare number of milliseconds
+bool parse_duration(const char* text, std::chrono::nanoseconds& out) {
+    char* end = nullptr;
+    errno = 0;
+    long long value = std::strtoll(text, &end, 10);
+    if (end == text || errno != 0 || value <= 0) {
+        return false;
+    }
+    std::string_view unit(end);
+    if (unit.empty() || unit == "ms") {
+        out = std::chrono::milliseconds(value);
+    } else if (unit == "s") {
+        out = std::chrono::seconds(value);
+    } else if (unit == "us") {
+        out = std::chrono::microseconds(value);
+    } else {
+        return false;
+    }
+    return true;
 }
 
-#ifdef PLATFORM_LINUX
-// Linux GPU detection using /sys/class/drm
-std::vector<GPUInfo> detect_gpus_linux() {
-    std::vector<GPUInfo> gpus;
-    const std::string drm_path = "/sys/class/drm";
+// Take --deadline, --attr-deadline, --stats and the output format out of
+// argv (they apply to every command), arm probe_deadlines() and the
+// counters. The overall deadline counts from now. The options live in
+// process globals and a host may call plugin_run again, so whatever an
+// earlier run set is cleared first.
+bool parse_common_options(int argc, char* argv[], std::vector<char*>& rest) {
+    ProbeDeadlines& deadlines = probe_deadlines();
+    deadlines.enabled = false;
+    deadlines.per_attribute = std::chrono::nanoseconds::max();
+    deadlines.overall = std::chrono::steady_clock::time_point::max();
+    output_format = OutputFormat::Text;
+    stats_reset();
     
-    if (!fs::exists(drm_path)) {
-        return gpus;
-    }
-    
-    int gpu_index = 0;
-    for (const auto& entry : fs::directory_iterator(drm_path)) {
-        std::string card_name = entry.path().filename().string();
-        
-        // Only process card* entries (not card*-HDMI, card*-DP, etc.)
-        if (card_name.find("card") == 0 && card_name.find("-") == std::string::npos) {
-            GPUInfo gpu;
-            gpu.index = gpu_index++;
-            gpu.is_active = (gpu.index == 0); // First GPU is typically active
-            
-            // Read device info from uevent file
-            std::string uevent_path = entry.path().string() + "/device/uevent";
-            if (fs::exists(uevent_path)) {
-                std::ifstream uevent(uevent_path);
-                std::string line;
-                std::string vendor_id, device_id;
-                
-                while (std::getline(uevent, line)) {
-                    if (line.find("PCI_ID=") == 0) {
-                        gpu.pci_id = line.substr(7);
-                        // Split vendor:device
-                        size_t colon = gpu.pci_id.find(':');
-                        if (colon != std::string::npos) {
-                            vendor_id = gpu.pci_id.substr(0, colon);
-                            device_id = gpu.pci_id.substr(colon + 1);
-                        }
-                    } else if (line.find("PCI_SLOT_NAME=") == 0) {
-                        // Could use this for more detailed info
-                    }
-                }
-                
-                gpu.vendor = get_vendor_name(vendor_id);
-            }
-            
-            // Try to read GPU name from various sources
-            std::vector<std::string> name_paths = {
-                entry.path().string() + "/device/label",
-                entry.path().string() + "/device/product_name",
-                entry.path().string() + "/device/model"
-            };
-            
-            bool name_found = false;
-            for (const auto& path : name_paths) {
-                if (fs::exists(path)) {
-                    std::ifstream name_file(path);
-                    std::string name;
-                    if (std::getline(name_file, name) && !name.empty()) {
-                        gpu.name = name;
-                        name_found = true;
-                        break;
-                    }
-                }
-            }
-            
-            // If no name found, construct a basic one with PCI ID
-            if (!name_found) {
-                if (!gpu.pci_id.empty()) {
-                    gpu.name = gpu.vendor + " GPU [" + gpu.pci_id + "]";
-                } else {
-                    gpu.name = gpu.vendor + " GPU";
-                }
+    std::chrono::nanoseconds overall{0}, per_attribute{0};
+    for (int i = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (i > 0 && (arg == "--deadline" || arg == "--attr-deadline")) {
+            std::chrono::nanoseconds& value = arg == "--deadline" ? overall : per_attribute;
+            if (i + 1 >= argc || !parse_duration(argv[i + 1], value)) {
+                std::cerr << Color::WARN << "Error: Invalid value for " << arg << " (e.g. 50ms, 2s)."
+                          << Color::WARN_END << "\n";
+                return false;
             }
-            
-            // Try to get NVIDIA driver version
-            if (gpu.vendor == "NVIDIA") {
-                std::string nvidia_version_path = "/proc/driver/nvidia/version";
-                if (fs::exists(nvidia_version_path)) {
-                    std::ifstream version_file(nvidia_version_path);
-                    std::string line;
-                    while (std::getline(version_file, line)) {
-                        if (line.find("Kernel Module") != std::string::npos) {
-                            // Extract version number after "Kernel Module"
-                            size_t pos = line.find("Kernel Module");
-                            if (pos != std::string::npos) {
-                                std::string remainder = line.substr(pos + 13); // Skip "Kernel Module"
-                                std::istringstream iss(remainder);
-                                std::string version;
-                                if (iss >> version) { // Read first token (the version)
-                                    gpu.driver_version = version;
-                                }
-                            }
-                        }
-                    }
-                }
+            ++i;
+        } else if (i > 0 && arg == "--stats") {
+            stats_enabled = true;
+            stats_heap_start = heap_use();
+        } else if (i > 0 && (arg == "--json" || arg == "--ndjson" || arg.substr(0, 9) == "--format=")) {
+            std::string_view format = arg.substr(0, 9) == "--format=" ? arg.substr(9) : arg.substr(2);
+            if (format == "text") {
+                output_format = OutputFormat::Text;
+            } else if (format == "json") {
+                output_format = OutputFormat::Json;
+            } else if (format == "ndjson") {
+                output_format = OutputFormat::Ndjson;
+            } else if (format == "cbor") {
+                output_format = OutputFormat::Cbor;
+            } else {
+                std::cerr << Color::WARN << "Error: Unknown output format '" << format
+                          << "' (text, json, ndjson, cbor)." << Color::WARN_END << "\n";
+                return false;
             }
-            
-            gpus.push_back(gpu);
+        } else {
+            rest.push_back(argv[i]);
         }
     }
+    rest.push_back(nullptr);
+    if (output_format == OutputFormat::Cbor && ::isatty(STDOUT_FILENO) == 1) {
+        std::cerr << Color::WARN << "Error: CBOR output is binary; redirect it to a file or pipe."
+                  << Color::WARN_END << "\n";
+        return false;
+    }
     
-    return gpus;
+    if (overall.count() > 0 || per_attribute.count() > 0) {
+        deadlines.enabled = true;
+        if (overall.count() > 0) {
+            deadlines.overall = std::chrono::steady_clock::now() + overall;
+        }
+        deadlines.per_attribute = per_attribute.count() > 0 ? per_attribute : overall;
+    }
+    return true;
 }
-#endif
 
-#ifdef PLATFORM_WINDOWS
-// Windows GPU detection using Setup API
-std::vector<GPUInfo> detect_gpus_windows() {
-    std::vector<GPUInfo> gpus;
+// Sample hwmon sensors on an interval until interrupted or --count ticks.
+// Sampling runs on its own thread (SamplerThread); this thread renders.
+// A terminal gets a redrawn screen; pipes get one block per tick, and a
+// reader that falls behind loses the oldest ticks, counted as dropped.
+int run_watch(int argc, char* argv[]) {
+    long interval_ms = 1000;
+    long count = 0;
+    bool keep_history = false;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--history") {
+            keep_history = true;
+        } else if ((arg == "--interval" || arg == "--count") && i + 1 < argc) {
+            char* end = nullptr;
+            long value = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < (arg == "--interval" ? 10 : 1)) {
+                std::cerr << Color::WARN << "Error: Invalid value for " << arg << "." << Color::WARN_END << "\n";
+                return 1;
+            }
+            (arg == "--interval" ? interval_ms : count) = value;
+        } else {
+            std::cerr << Color::WARN << "Error: Invalid argument '" << arg << "'." << Color::WARN_END << "\n";
+            std::cerr << "Use 'whatsmy gpu help' for usage information.\n";
+            return 1;
+        }
+    }
     
-    // Initialize device information set for display adapters
-    HDEVINFO deviceInfoSet = SetupDiGetClassDevs(&GUID_DEVCLASS_DISPLAY, NULL, NULL, DIGCF_PRESENT);
-    if (deviceInfoSet == INVALID_HANDLE_VALUE) {
-        return gpus;
+    std::vector<GPUInfo> gpus = enumerate_gpus();
+    if (gpus.empty()) {
+        warn_no_gpus();
+        return 1;
+    }
+    // Rendering in the loop below is charged here too: the phase is global
+    StatsPhaseScope phase(kPhaseTelemetry);
+    TelemetrySampler sampler;
+    sampler.discover(gpus);
+    if (sampler.reads_per_sample() == 0) {
+        std::cerr << Color::WARN << "Error: No telemetry sensors found for any GPU." << Color::WARN_END << "\n";
+        return 1;
     }
     
-    SP_DEVINFO_DATA deviceInfoData;
-    deviceInfoData.cbSize = sizeof(SP_DEVINFO_DATA);
+    // Rollups use wall-clock seconds; the memory is fixed up front
+    std::unique_ptr<TelemetryHistory> history;
+    if (keep_history) {
+        history.reset(new TelemetryHistory(HistoryConfig(), sampler.reads_per_sample()));
+    }
     
-    int gpu_index = 0;
-    for (DWORD i = 0; SetupDiEnumDeviceInfo(deviceInfoSet, i, &deviceInfoData); i++) {
-        GPUInfo gpu;
-        gpu.index = gpu_index++;
-        gpu.is_active = (gpu.index == 0);
-        
-        // Get device description (GPU name)
-        char buffer[256];
-        if (SetupDiGetDeviceRegistryPropertyA(deviceInfoSet, &deviceInfoData, SPDRP_DEVICEDESC,
-                                              NULL, (PBYTE)buffer, sizeof(buffer), NULL)) {
-            gpu.name = buffer;
-        }
-        
-        // Get manufacturer (vendor)
-        if (SetupDiGetDeviceRegistryPropertyA(deviceInfoSet, &deviceInfoData, SPDRP_MFG,
-                                              NULL, (PBYTE)buffer, sizeof(buffer), NULL)) {
-            gpu.vendor = buffer;
+    // Block the signals before the sampler thread exists so it inherits
+    // the mask; the output thread takes them from a signalfd
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    ::pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+    int signal_fd = ::signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    
+    const bool redraw = ::isatty(STDOUT_FILENO) == 1;
+    const auto start = std::chrono::steady_clock::now();
+    const int64_t cpu_start = self_cpu_micros();
+    std::unique_ptr<SamplerThread> thread(new SamplerThread(sampler, history.get(),
+                                                            std::chrono::milliseconds(interval_ms),
+                                                            static_cast<uint64_t>(count)));
+    if (!thread->start()) {
+        std::cerr << Color::WARN << "Error: Could not start the sampler thread." << Color::WARN_END << "\n";
+        ::pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+        return 1;
+    }
+    
+    // CBOR samples are bare value arrays; say once what they hold
+    if (output_format == OutputFormat::Cbor) {
+        write_channels_cbor(output_buffer(), sampler.reads());
+        output_buffer().flush();
+    }
+    
+    TelemetrySample sample;
+    bool done = false;
+    while (!done) {
+        pollfd fds[2] = {{thread->ready_fd(), POLLIN, 0}, {signal_fd, POLLIN, 0}};
+        if (::poll(fds, signal_fd >= 0 ? 2 : 1, -1) < 0 && errno != EINTR) {
+            break;
         }
-        
-        // Get driver version
-        if (SetupDiGetDeviceRegistryPropertyA(deviceInfoSet, &deviceInfoData, SPDRP_DRIVER,
-                                              NULL, (PBYTE)buffer, sizeof(buffer), NULL)) {
-            gpu.driver_version = buffer;
+        if (fds[1].revents & POLLIN) {
+            // Consume the signal so restoring the mask does not deliver it
+            signalfd_siginfo info;
+            ssize_t ignored = ::read(signal_fd, &info, sizeof(info));
+            (void)ignored;
+            break;
         }
-        
-        // Get hardware ID for PCI information
-        if (SetupDiGetDeviceRegistryPropertyA(deviceInfoSet, &deviceInfoData, SPDRP_HARDWAREID,
-                                              NULL, (PBYTE)buffer, sizeof(buffer), NULL)) {
-            std::string hwid = buffer;
-            // Parse PCI\VEN_XXXX&DEV_XXXX format
-            size_t ven_pos = hwid.find("VEN_");
-            size_t dev_pos = hwid.find("DEV_");
-            if (ven_pos != std::string::npos && dev_pos != std::string::npos) {
-                std::string vendor = hwid.substr(ven_pos + 4, 4);
-                std::string device = hwid.substr(dev_pos + 4, 4);
-                gpu.pci_id = vendor + ":" + device;
+        thread->acknowledge();
+        done = thread->finished();
+        while (thread->pop(sample)) {
+            // Own CPU use, both threads, once there is an interval to average over
+            int64_t wall = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            double cpu = sample.tick > 0 ? 100.0 * (self_cpu_micros() - cpu_start) / wall : -1.0;
+            if (output_format != OutputFormat::Text) {
+                write_sample(output_buffer(), sampler.reads(), sample, cpu, thread->dropped());
+                output_buffer().flush();
+                continue;
             }
+            TextBuffer& out = output_buffer();
+            if (redraw) {
+                out << "\033[H\033[2J";
+            } else if (sample.tick > 0) {
+                out << '\n';
+            }
+            print_telemetry(out, gpus, sampler.reads(), sample, cpu, thread->dropped());
+            out.flush();
         }
-        
-        gpus.push_back(gpu);
     }
+    thread.reset();
     
-    SetupDiDestroyDeviceInfoList(deviceInfoSet);
-    return gpus;
+    if (signal_fd >= 0) {
+        ::close(signal_fd);
+    }
+    ::pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+    if (history && output_format != OutputFormat::Text) {
+        write_history(output_buffer(), sampler, *history, static_cast<int64_t>(std::time(nullptr)));
+        output_buffer().flush();
+    } else if (history) {
+        print_history_summary(output_buffer(), sampler, *history, static_cast<int64_t>(std::time(nullptr)));
+        output_buffer().flush();
+    }
+    return 0;
 }
-#endif
 
-#ifdef PLATFORM_MACOS
-// macOS GPU detection using IOKit (placeholder)
-std::vector<GPUInfo> detect_gpus_macos() {
-    std::vector<GPUInfo> gpus;
-    
-    // TODO: Implement IOKit-based GPU detection
-    GPUInfo gpu;
-    gpu.index = 0;
-    gpu.is_active = true;
-    gpu.name = "macOS GPU (detection not implemented)";
-    gpu.vendor = "Unknown";
-    gpu.driver_version = "N/A";
-    gpu.pci_id = "N/A";
-    gpus.push_back(gpu);
-    
-    return gpus;
+// Prompt mode.
+//
+// `whatsmy gpu prompt` prints one plain line for shell prompts and status
+// bars, e.g. "RTX 4090 62°C 41%", and runs on every redraw, so it has to
+// stay under a millisecond. Identity comes from the daemon snapshot or the
+// inventory cache (detect_gpus()); the sensors are at most two reads, hwmon
+// temp1_input and amdgpu's gpu_busy_percent. The card's hwmon directory is
+// remembered in $XDG_CACHE_HOME/whatsmy/gpu-prompt, so the hwmon listing
+// only runs again when that goes stale. No ANSI, no iostream: the line goes
+// out in one write() through output_buffer(), like every other view.
+
+// Marketing name for a prompt: the bracketed part of a pci.ids name
+// ("GA102 [GeForce RTX 3090]"), without the vendor and "GeForce" prefixes
+std::string_view prompt_name(std::string_view name) {
+    size_t open = name.rfind('[');
+    if (open != std::string_view::npos && name.back() == ']') {
+        name = name.substr(open + 1, name.size() - open - 2);
+    }
+    for (std::string_view prefix : {"NVIDIA ", "AMD ", "Intel ", "GeForce "}) {
+        if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0) {
+            name.remove_prefix(prefix.size());
+        }
+    }
+    return name;
 }
-#endif
 
-// Cross-platform GPU detection
-std::vector<GPUInfo> detect_gpus() {
-#ifdef PLATFORM_LINUX
-    return detect_gpus_linux();
-#elif defined(PLATFORM_WINDOWS)
-    return detect_gpus_windows();
-#elif defined(PLATFORM_MACOS)
-    return detect_gpus_macos();
-#else
-    return {};
-#endif
+std::string prompt_cache_path() {
+    std::string dir = whatsmy_cache_dir();
+    return dir.empty() ? dir : dir + "/gpu-prompt";
 }
 
-// Display a single GPU
-void display_gpu(const GPUInfo& gpu, bool brief = false) {
-    if (brief) {
-        std::cout << Color::BOLD << "GPU " << gpu.index << Color::RESET;
-        if (gpu.is_active) {
-            std::cout << " " << Color::GREEN << "(Active)" << Color::RESET;
-        }
-        std::cout << "\n";
-        print_field("Name", gpu.name);
-        print_field("Vendor", gpu.vendor);
-        if (!gpu.pci_id.empty()) {
-            print_field("PCI ID", gpu.pci_id);
+// temp1_input of the card's hwmon directory: the remembered one (lines of
+// "<node> <hwmon>") when it still reads, else the first that does
+bool read_prompt_temperature(const SysfsDir& device, const std::string& node, SysfsAttr& attr) {
+    const std::string cache_path = prompt_cache_path();
+    char path[96];
+    std::string others;   // Entries for other cards, kept on rewrite
+    if (!cache_path.empty()) {
+        SysfsAttr cached;
+        ssize_t n = PosixSysfs::read_file_at(AT_FDCWD, cache_path.c_str(), cached.data, sizeof(cached.data));
+        std::string_view text(cached.data, n > 0 ? static_cast<size_t>(n) : 0);
+        while (!text.empty()) {
+            size_t end = text.find('\n');
+            std::string_view line = text.substr(0, end);
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+            size_t space = line.find(' ');
+            if (space == std::string_view::npos || line.size() - space > 64) {
+                continue;
+            }
+            if (line.substr(0, space) != node) {
+                others.append(line.data(), line.size()).push_back('\n');
+                continue;
+            }
+            std::snprintf(path, sizeof(path), "hwmon/%.*s/temp1_input", static_cast<int>(line.size() - space - 1),
+                          line.data() + space + 1);
+            if (device.read(path, attr)) {
+                return true;
+            }
         }
-    } else {
-        print_header("GPU " + std::to_string(gpu.index) + (gpu.is_active ? " (Active)" : ""));
-        print_field("Name", gpu.name);
-        print_field("Vendor", gpu.vendor);
-        if (!gpu.driver_version.empty() && gpu.driver_version != "N/A") {
-            print_field("Driver Version", gpu.driver_version);
+    }
+    
+    std::vector<std::string> hwmons;
+    SysfsDir(device, "hwmon", true).for_each_entry([&](std::string_view name) {
+        if (name.compare(0, 5, "hwmon") == 0 && name.size() < 64) {
+            hwmons.emplace_back(name);
         }
-        if (!gpu.pci_id.empty() && gpu.pci_id != "N/A") {
-            print_field("PCI ID", gpu.pci_id);
+    });
+    std::sort(hwmons.begin(), hwmons.end());
+    for (const auto& name : hwmons) {
+        std::snprintf(path, sizeof(path), "hwmon/%s/temp1_input", name.c_str());
+        if (device.read(path, attr)) {
+            if (!cache_path.empty()) {
+                others += node + " " + name + "\n";
+                write_file_atomic(cache_path, others.data(), others.size());
+            }
+            return true;
         }
     }
+    return false;
 }
 
-// Display all GPUs
-void display_all_gpus(const std::vector<GPUInfo>& gpus) {
-    if (gpus.empty()) {
-        std::cout << Color::YELLOW << "No GPUs detected." << Color::RESET << "\n";
-        return;
+// The first line of `attr` as a decimal integer; false if that is not all
+// it holds
+bool parse_attr_number(const SysfsAttr& attr, long long& value) {
+    std::string_view line = attr.line();
+    auto result = std::from_chars(line.data(), line.data() + line.size(), value);
+    return result.ec == std::errc() && !line.empty() && result.ptr == line.data() + line.size();
+}
+
+// whatsmy gpu prompt [index]: the active GPU (else the first) by default.
+// Prints nothing and fails when there is no such GPU, so a prompt stays clean.
+int run_prompt(int argc, char* argv[]) {
+    int index = -1;
+    if (argc > 1) {
+        std::cerr << Color::WARN << "Error: Too many arguments." << Color::WARN_END << "\n";
+        return 1;
+    }
+    if (argc == 1) {
+        char* end = nullptr;
+        long value = std::strtol(argv[0], &end, 10);
+        if (end == argv[0] || *end != '\0' || value < 0 || value > INT_MAX) {
+            std::cerr << Color::WARN << "Error: Invalid argument '" << argv[0] << "'." << Color::WARN_END << "\n";
+            return 1;
+        }
+        index = static_cast<int>(value);
     }
     
-    print_header("All GPUs (" + std::to_string(gpus.size()) + " detected)");
-    for (const auto& gpu : gpus) {
-        display_gpu(gpu, true);
-        if (&gpu != &gpus.back()) {
-            std::cout << "\n";
+    std::vector<GPUInfo> gpus = detect_gpus();
+    const GPUInfo* gpu = nullptr;
+    for (const auto& candidate : gpus) {
+        if (index >= 0 ? candidate.index == index : candidate.is_active) {
+            gpu = &candidate;
+            break;
         }
     }
+    if (!gpu && index < 0 && !gpus.empty()) {
+        gpu = &gpus.front();
+    }
+    if (!gpu) {
+        return 1;
+    }
+    
+    StatsPhaseScope phase(kPhaseTelemetry);
+    std::string_view name = prompt_name(gpu->name);
+    char device_path[64];
+    std::snprintf(device_path, sizeof(device_path), "sys/class/drm/%s/device", gpu->node.c_str());
+    SysfsDir device(SysfsDir(linux_root()), device_path);
+    SysfsAttr attr;
+    long long millicelsius = 0, celsius = 0, busy = 0;
+    bool has_temperature = false, has_busy = false;
+    if (!gpu->node.empty() && read_prompt_temperature(device, gpu->node, attr) &&
+        parse_attr_number(attr, millicelsius)) {
+        celsius = std::lround(millicelsius / 1000.0);
+        has_temperature = true;
+    }
+    has_busy = device.read("gpu_busy_percent", attr) && parse_attr_number(attr, busy);
+    
+    if (output_format == OutputFormat::Cbor) {
+        CborWriter cbor(output_buffer());
+        cbor.begin_record(kCborPromptRecord, 4);
+        cbor.field(kCborIndex, gpu->index);
+        cbor.text_field(kCborName, name);
+        cbor.key(kCborTemperatureC);
+        if (has_temperature) {
+            cbor.value(celsius);
+        } else {
+            cbor.null();
+        }
+        cbor.key(kCborBusyPercent);
+        if (has_busy) {
+            cbor.value(busy);
+        } else {
+            cbor.null();
+        }
+        output_buffer().flush();
+        return 0;
+    }
+    if (output_format != OutputFormat::Text) {
+        JsonWriter json(output_buffer());
+        json.begin_record("prompt");
+        json.field("index", gpu->index);
+        json.text_field("name", name);
+        json.key("temperature_c");
+        if (has_temperature) {
+            json.value(celsius);
+        } else {
+            json.null();
+        }
+        json.key("busy_percent");
+        if (has_busy) {
+            json.value(busy);
+        } else {
+            json.null();
+        }
+        json.end_object().end_line();
+        output_buffer().flush();
+        return 0;
+    }
+    TextBuffer& out = output_buffer();
+    out << name.substr(0, 160);
+    if (has_temperature) {
+        out << ' ' << celsius << "\xC2\xB0" "C";
+    }
+    if (has_busy) {
+        out << ' ' << busy << '%';
+    }
+    out << '\n';
+    out.flush();
+    return 0;
 }
+#endif
 
-// Display help
-void display_help() {
-    std::cout << Color::BOLD << "GPU Plugin for whatsmycli" << Color::RESET << "\n\n";
-    std::cout << "Usage:\n";
-    std::cout << "  whatsmy gpu           " << Color::DIM << "# Show active/default GPU" << Color::RESET << "\n";
-    std::cout << "  whatsmy gpu all       " << Color::DIM << "# Show all GPUs" << Color::RESET << "\n";
-    std::cout << "  whatsmy gpu <index>   " << Color::DIM << "# Show specific GPU by index" << Color::RESET << "\n";
-    std::cout << "  whatsmy gpu help      " << Color::DIM << "# Show this help" << Color::RESET << "\n";
-}
-
-// Plugin entry point (API v2)
-extern "C" WHATSMY_PLUGIN_EXPORT int plugin_run(int argc, char* argv[]) {
+// Parse arguments and run one command
+int run_command(int argc, char* argv[]) {
     try {
-        // Detect GPUs
-        std::vector<GPUInfo> gpus = detect_gpus();
+        // Parse arguments before touching any hardware: help needs no
+        // detection, and single-GPU views only populate the GPU they show.
+#ifdef PLATFORM_LINUX
+        std::vector<char*> args;
+        if (!parse_common_options(argc, argv, args)) {
+            return 1;
+        }
+        argc = static_cast<int>(args.size()) - 1;
+        argv = args.data();
+#endif
+        std::string arg = argc >= 2 ? argv[1] : "";
+#ifdef PLATFORM_LINUX
+        if (arg == "monitor") {
+            return run_monitor(argc - 2, argv + 2);
+        }
+        if (arg == "daemon") {
+            return run_daemon(argc - 2, argv + 2);
+        }
+        if (arg == "watch") {
+            return run_watch(argc - 2, argv + 2);
+        }
+        if (arg == "prompt") {
+            return run_prompt(argc - 2, argv + 2);
+        }
+#endif
+        
+        if (argc > 2) {
+            std::cerr << Color::WARN << "Error: Too many arguments." << Color::WARN_END << "\n";
+            std::cerr << "Use 'whatsmy gpu help' for usage information.\n";
+            return 1;
+        }
+        
+        if (arg == "help" || arg == "--help" || arg == "-h") {
+            if (output_format != OutputFormat::Text) {
+                std::cerr << Color::WARN << "Error: Help is only available as text." << Color::WARN_END << "\n";
+                return 1;
+            }
+            display_help();
+            return 0;
+        }
+        
+        if (arg == "all") {
+            std::vector<GPUInfo> gpus = detect_gpus();
+            if (gpus.empty()) {
+                warn_no_gpus();
+                return 1;
+            }
+            if (output_format != OutputFormat::Text) {
+                TraceSpan span("output");
+                StatsPhaseScope phase(kPhaseOutput);
+                write_gpus(output_buffer(), gpus);
+                output_buffer().flush();
+                return 0;
+            }
+            display_all_gpus(gpus);
+            return 0;
+        }
+        
+        // Show active GPU (no arguments) or a specific GPU by index
+        int index = -1;
+        if (!arg.empty()) {
+            try {
+                index = std::stoi(arg);
+            } catch (const std::exception&) {
+                std::cerr << Color::WARN << "Error: Invalid argument '" << arg << "'." << Color::WARN_END << "\n";
+                std::cerr << "Use 'whatsmy gpu help' for usage information.\n";
+                return 1;
+            }
+        }
         
+        std::vector<GPUInfo> gpus = enumerate_gpus();
         if (gpus.empty()) {
-            std::cerr << Color::YELLOW << "Warning: No GPUs detected." << Color::RESET << "\n";
-            std::cerr << "This could mean:\n";
-            std::cerr << "  - No GPU is present in the system\n";
-            std::cerr << "  - GPU drivers are not installed\n";
-            std::cerr << "  - Insufficient permissions to access GPU information\n";
+            warn_no_gpus();
             return 1;
         }
         
-        // Parse arguments
-        if (argc == 1) {
-            // No arguments: show active GPU
+        if (index < 0 && arg.empty()) {
+            // If no active GPU, show first one
+            index = 0;
             for (const auto& gpu : gpus) {
                 if (gpu.is_active) {
-                    display_gpu(gpu);
-                    return 0;
-                }
-            }
-            // If no active GPU, show first one
-            display_gpu(gpus[0]);
-            
-        } else if (argc == 2) {
-            std::string arg = argv[1];
-            
-            if (arg == "help" || arg == "--help" || arg == "-h") {
-                display_help();
-                return 0;
-            } else if (arg == "all") {
-                display_all_gpus(gpus);
-                return 0;
-            } else {
-                // Try to parse as GPU index
-                try {
-                    int index = std::stoi(arg);
-                    if (index < 0 || index >= static_cast<int>(gpus.size())) {
-                        std::cerr << Color::YELLOW << "Error: GPU index " << index << " out of range." << Color::RESET << "\n";
-                        std::cerr << "Available GPUs: 0-" << (gpus.size() - 1) << "\n";
-                        return 1;
-                    }
-                    display_gpu(gpus[index]);
-                    return 0;
-                } catch (const std::exception&) {
-                    std::cerr << Color::YELLOW << "Error: Invalid argument '" << arg << "'." << Color::RESET << "\n";
-                    std::cerr << "Use 'whatsmy gpu help' for usage information.\n";
-                    return 1;
+                    index = gpu.index;
+                    break;
                 }
             }
-        } else {
-            std::cerr << Color::YELLOW << "Error: Too many arguments." << Color::RESET << "\n";
-            std::cerr << "Use 'whatsmy gpu help' for usage information.\n";
+        } else if (index < 0 || index >= static_cast<int>(gpus.size())) {
+            std::cerr << Color::WARN << "Error: GPU index " << index << " out of range." << Color::WARN_END << "\n";
+            std::cerr << "Available GPUs: 0-" << (gpus.size() - 1) << "\n";
             return 1;
         }
         
+        populate_gpu(gpus[index]);
+        TraceSpan span("output");
+        StatsPhaseScope phase(kPhaseOutput);
+        if (output_format != OutputFormat::Text) {
+            write_gpu(output_buffer(), gpus[index]);
+        } else {
+            display_gpu(output_buffer(), gpus[index]);
+        }
+        output_buffer().flush();
         return 0;
         
     } catch (const std::exception& e) {
-        std::cerr << Color::YELLOW << "Error: " << e.what() << Color::RESET << "\n";
+        std::cerr << Color::WARN << "Error: " << e.what() << Color::WARN_END << "\n";
         return 1;
     } catch (...) {
-        std::cerr << Color::YELLOW << "Error: Unknown exception occurred." << Color::RESET << "\n";
+        std::cerr << Color::WARN << "Error: Unknown exception occurred." << Color::WARN_END << "\n";
         return 1;
     }
 }
 
+// Plugin entry point (API v2)
+extern "C" WHATSMY_PLUGIN_EXPORT int plugin_run(int argc, char* argv[]) {
+    // Static initialization, and whatever the host did after dlopen, up to the first run
+    const int64_t entry_ns = trace_now_ns();
+    static bool first_run = true;
+    trace_init();
+    if (first_run) {
+        trace_complete("load", 0, entry_ns);
+        first_run = false;
+    }
+    
+#ifdef PLATFORM_LINUX
+    // Pipes and files (our collectors) get plain text
+    Color::init(::isatty(STDOUT_FILENO) == 1, ::isatty(STDERR_FILENO) == 1);
+    GPU_USDT(run__start, argc, argc >= 2 ? argv[1] : "");
+    const int64_t usdt_start = GPU_USDT_ACTIVE(run__done) ? trace_now_ns() : 0;
+#endif
+    int result;
+    {
+        TraceSpan span("plugin_run", -1, argc >= 2 ? argv[1] : "");
+        result = run_command(argc, argv);
+    }
+#ifdef PLATFORM_LINUX
+    // No reader thread may be left idling in plugin code once we return
+    if (probe_deadlines().enabled) {
+        AttributeReader::instance().stop();
+    }
+#endif
+    trace_flush();
+    stats_report();
+#ifdef PLATFORM_LINUX
+    GPU_USDT(run__done, result, usdt_start ? trace_now_ns() - usdt_start : 0);
+#endif
+    return result;
+}
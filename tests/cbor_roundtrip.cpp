@@ -0,0 +1,216 @@
+// CBOR round-trip test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Encodes GPU, inventory, channels and sample records with the plugin's
+// CborWriter and decodes them with tools/cbor_decode.h, field by field.
+// The decoder accepts only what docs/cbor-schema.md allows, so any
+// encoding outside the schema fails here too.
+
+#include "plugin.cpp"
+
+#include "check.h"
+#include "tools/cbor_decode.h"
+
+namespace {
+
+namespace wire = whatsmy_gpu_cbor;
+
+// The decoder's copy of the schema must match the encoder's
+static_assert(int(wire::kPciId) == kCborPciId && int(wire::kValues) == kCborValues &&
+              int(wire::kBusyPercent) == kCborBusyPercent, "CBOR keys out of sync");
+static_assert(int(wire::kSampleRecord) == kCborSampleRecord && int(wire::kPromptRecord) == kCborPromptRecord &&
+              int(wire::kSchemaVersion) == kCborSchemaVersion, "CBOR record types out of sync");
+
+GPUInfo make_gpu(int index, const char* node, const char* name, const char* vendor, const char* board,
+                 const char* driver, const char* version, const char* pci_id) {
+    GPUInfo gpu;
+    gpu.index = index;
+    gpu.is_active = index == 0;
+    gpu.node = node;
+    gpu.name = name;
+    gpu.vendor = vendor;
+    gpu.board = board;
+    gpu.driver = driver;
+    gpu.driver_version = version;
+    gpu.pci_id = pci_id;
+    return gpu;
+}
+
+// Identical models next to each other, a board partner, unknown fields
+// ("N/A" and empty) and text that needs a two-byte length
+std::vector<GPUInfo> sample_gpus() {
+    std::vector<GPUInfo> gpus;
+    gpus.push_back(make_gpu(0, "card0", "NVIDIA GH100 [H100 SXM5 80GB]", "NVIDIA", "", "nvidia", "550.54.15",
+                            "10DE:2330"));
+    gpus.push_back(make_gpu(1, "card1", "NVIDIA GH100 [H100 SXM5 80GB]", "NVIDIA", "", "nvidia", "550.54.15",
+                            "10DE:2330"));
+    gpus.push_back(make_gpu(2, "card2", "AMD Navi 31 [Radeon RX 7900 XTX]", "AMD",
+                            "ASUSTeK Computer Inc. TUF Gaming Radeon RX 7900 XTX", "amdgpu", "N/A", "1002:744C"));
+    gpus.push_back(make_gpu(3, "card3", std::string(300, 'x').c_str(), "Unknown", "", "", "N/A", "N/A"));
+    return gpus;
+}
+
+void check_gpu(const wire::CborGpu& decoded, const GPUInfo& gpu) {
+    check_context() = gpu.node;
+    CHECK(decoded.index == gpu.index);
+    CHECK(decoded.active == gpu.is_active);
+    CHECK(decoded.node == gpu.node);
+    CHECK(decoded.name == gpu.name);
+    CHECK(decoded.vendor == gpu.vendor);
+    CHECK(decoded.board == gpu.board);
+    CHECK(decoded.driver == gpu.driver);
+    CHECK(decoded.driver_version == known(gpu.driver_version));
+    CHECK(decoded.pci_id == known(gpu.pci_id));
+}
+
+void test_gpu_record(const GPUInfo& gpu) {
+    TextBuffer out;
+    write_gpu_cbor(out, gpu);
+    wire::CborReader reader(out.view().data(), out.view().size());
+    wire::CborRecordHead head;
+    CHECK(wire::read_record_head(reader, head));
+    CHECK(head.type == wire::kGpuRecord);
+    CHECK(head.fields == 9);
+    wire::CborGpu decoded;
+    CHECK(wire::read_gpu(reader, head.fields, decoded));
+    CHECK(reader.at_end());
+    check_gpu(decoded, gpu);
+}
+
+void test_inventory(const std::vector<GPUInfo>& gpus) {
+    TextBuffer out;
+    write_gpus_cbor(out, gpus);
+    wire::CborReader reader(out.view().data(), out.view().size());
+    wire::CborRecordHead head;
+    uint64_t key = 0, count = 0, pairs = 0;
+    check_context() = "inventory";
+    CHECK(wire::read_record_head(reader, head));
+    CHECK(head.type == wire::kInventoryRecord && head.fields == 1);
+    CHECK(reader.read_key(key) && key == wire::kGpus);
+    CHECK(reader.read_container(wire::CborItem::Array, count) && count == gpus.size());
+    for (uint64_t i = 0; i < count && i < gpus.size(); ++i) {
+        // A fresh CborGpu each time: every entry must stand on its own
+        wire::CborGpu decoded;
+        CHECK(reader.read_container(wire::CborItem::Map, pairs) && pairs == 9);
+        CHECK(wire::read_gpu(reader, pairs, decoded));
+        check_gpu(decoded, gpus[i]);
+    }
+    check_context() = "inventory";
+    CHECK(reader.at_end());
+}
+
+void test_channels_and_sample() {
+    int64_t values[3] = {45000, 250000000, kTelemetryMissing};
+    const int64_t vram_total = 68719476736;
+    std::vector<TelemetryRead> reads = {
+        {-1, &values[0], 0, SensorKind::Temperature, "edge", nullptr},
+        {-1, &values[1], 0, SensorKind::Power, "PPT", nullptr},
+        {-1, &values[2], 1, SensorKind::Memory, "vram", &vram_total},
+    };
+    TextBuffer out;
+    write_channels_cbor(out, reads);
+
+    check_context() = "channels";
+    wire::CborReader reader(out.view().data(), out.view().size());
+    wire::CborRecordHead head;
+    uint64_t key = 0, count = 0, pairs = 0;
+    CHECK(wire::read_record_head(reader, head));
+    CHECK(head.type == wire::kChannelsRecord && head.fields == 1);
+    CHECK(reader.read_key(key) && key == wire::kChannels);
+    CHECK(reader.read_container(wire::CborItem::Array, count) && count == reads.size());
+    for (uint64_t i = 0; i < count && i < reads.size(); ++i) {
+        int64_t gpu = -1, kind = -1, total = 0;
+        std::string_view name;
+        CHECK(reader.read_container(wire::CborItem::Map, pairs) && pairs == 4);
+        CHECK(reader.read_key(key) && key == wire::kGpu && reader.read_int(gpu));
+        CHECK(reader.read_key(key) && key == wire::kName && reader.read_text(name));
+        CHECK(reader.read_key(key) && key == wire::kKind && reader.read_int(kind));
+        CHECK(reader.read_key(key) && key == wire::kTotal && reader.read_int(total, -1));
+        CHECK(gpu == reads[i].gpu);
+        CHECK(name == reads[i].name);
+        CHECK(kind == static_cast<int>(reads[i].kind));
+        CHECK(total == (reads[i].total ? *reads[i].total : -1));
+    }
+    CHECK(reader.at_end());
+
+    TelemetrySample sample{};
+    sample.tick = 42;
+    sample.time_s = 1760000000;
+    sample.read_ns = 18500;
+    sample.jitter_ns = 120;
+    sample.jitter_mean_ns = 80;
+    sample.jitter_max_ns = 3000;
+    sample.count = 3;
+    std::copy(values, values + 3, sample.values);
+    out.clear();
+    write_sample_cbor(out, sample, 1.5, 7);
+
+    check_context() = "sample";
+    reader = wire::CborReader(out.view().data(), out.view().size());
+    wire::CborSample decoded;
+    wire::CborReader value_reader(nullptr, 0);
+    CHECK(wire::read_record_head(reader, head));
+    CHECK(head.type == wire::kSampleRecord);
+    CHECK(wire::read_sample(reader, head.fields, decoded, value_reader));
+    CHECK(reader.at_end());
+    CHECK(decoded.tick == 42);
+    CHECK(decoded.time == sample.time_s);
+    CHECK(decoded.read_ns == sample.read_ns);
+    CHECK(decoded.jitter_ns == sample.jitter_ns);
+    CHECK(decoded.jitter_mean_ns == sample.jitter_mean_ns);
+    CHECK(decoded.jitter_max_ns == sample.jitter_max_ns);
+    CHECK(decoded.cpu == 150);
+    CHECK(decoded.dropped == 7);
+    CHECK(decoded.count == 3);
+    for (uint64_t i = 0; i < decoded.count && i < 3; ++i) {
+        int64_t value = 0;
+        CHECK(value_reader.read_int(value, kTelemetryMissing));
+        CHECK(value == values[i]);
+    }
+
+    // The first tick has no CPU figure yet
+    out.clear();
+    write_sample_cbor(out, sample, -1, 0);
+    reader = wire::CborReader(out.view().data(), out.view().size());
+    CHECK(wire::read_record_head(reader, head));
+    CHECK(wire::read_sample(reader, head.fields, decoded, value_reader));
+    CHECK(decoded.cpu == -1);
+}
+
+// A stream is records back to back; a reader skips the ones it does not know
+void test_stream(const std::vector<GPUInfo>& gpus) {
+    TextBuffer out;
+    write_gpus_cbor(out, gpus);
+    write_gpu_cbor(out, gpus[2]);
+    write_gpus_cbor(out, {});
+
+    check_context() = "stream";
+    wire::CborReader reader(out.view().data(), out.view().size());
+    wire::CborRecordHead head;
+    uint64_t types[3] = {};
+    int records = 0;
+    while (wire::read_record_head(reader, head)) {
+        if (records < 3) {
+            types[records] = head.type;
+        }
+        ++records;
+        CHECK(wire::skip_fields(reader, head.fields));
+    }
+    CHECK(reader.at_end());
+    CHECK(records == 3);
+    CHECK(types[0] == wire::kInventoryRecord && types[1] == wire::kGpuRecord && types[2] == wire::kInventoryRecord);
+}
+
+} // namespace
+
+int main() {
+    const std::vector<GPUInfo> gpus = sample_gpus();
+    for (const auto& gpu : gpus) {
+        test_gpu_record(gpu);
+    }
+    test_inventory(gpus);
+    test_channels_and_sample();
+    test_stream(gpus);
+    return check_result("cbor_roundtrip");
+}
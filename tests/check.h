@@ -0,0 +1,45 @@
+// Minimal assertions for the tests
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Each test is its own executable registered with ctest. CHECK reports a
+// failed expectation and carries on, so one run lists every broken case;
+// main() returns check_result(). Table-driven tests set check_context()
+// to the case at hand so failures name it.
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+inline int& check_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline std::string& check_context() {
+    static std::string context;
+    return context;
+}
+
+inline void check_failed(const char* file, int line, const char* expression) {
+    ++check_failures();
+    std::fprintf(stderr, "%s:%d: %s%s%sCHECK(%s) failed\n", file, line, check_context().empty() ? "" : "[",
+                 check_context().c_str(), check_context().empty() ? "" : "] ", expression);
+}
+
+#define CHECK(condition)                                  \
+    do {                                                  \
+        if (!(condition)) {                               \
+            check_failed(__FILE__, __LINE__, #condition); \
+        }                                                 \
+    } while (0)
+
+inline int check_result(const char* test) {
+    if (check_failures() > 0) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", test, check_failures());
+        return 1;
+    }
+    std::printf("%s: ok\n", test);
+    return 0;
+}
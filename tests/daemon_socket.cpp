@@ -0,0 +1,127 @@
+// Daemon socket test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Serves a synthetic host's inventory with InventoryServer and queries it
+// the way the plugin does: every query must return the inventory the
+// server holds, the socket must be private to this user, a second server
+// must not take over a live path or anything that is not a socket, and
+// the path must be gone once the server is. A run under WHATSMY_GPU_ROOT
+// must not be answered by the daemon at the live system's default path.
+
+#include "plugin.cpp"
+
+#include "check.h"
+#include "plugin_child.h"
+#include "synthetic_host.h"
+
+namespace {
+
+bool same(const std::vector<GPUInfo>& a, const std::vector<GPUInfo>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].index != b[i].index || a[i].is_active != b[i].is_active || a[i].name != b[i].name ||
+            a[i].vendor != b[i].vendor || a[i].board != b[i].board || a[i].driver != b[i].driver ||
+            a[i].driver_version != b[i].driver_version || a[i].pci_id != b[i].pci_id || a[i].node != b[i].node) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_serve(const std::string& scratch) {
+    ResidentInventory inventory(scratch + "/host");
+    inventory.scan();
+    const std::string socket_path = scratch + "/gpu.sock";
+    std::vector<GPUInfo> gpus;
+    {
+        InventoryServer server(inventory, nullptr);
+        std::string error;
+        check_context() = "listen";
+        CHECK(server.listen(socket_path, error));
+        struct stat st;
+        CHECK(::lstat(socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode));
+        CHECK((st.st_mode & 0777) == 0600);
+        std::thread serving([&] { server.run(); });
+
+        check_context() = "query";
+        int wrong = 0;
+        for (int i = 0; i < 200; ++i) {
+            gpus.clear();
+            wrong += !query_daemon(gpus, socket_path) || !same(gpus, *inventory.snapshot());
+        }
+        CHECK(wrong == 0);
+        CHECK(gpus.size() == 6);
+
+        check_context() = "second server";
+        InventoryServer second(inventory, nullptr);
+        CHECK(!second.listen(socket_path, error));
+        CHECK(error.find("already serving") != std::string::npos);
+
+        server.stop();
+        serving.join();
+    }
+    check_context() = "stopped";
+    struct stat st;
+    CHECK(::lstat(socket_path.c_str(), &st) != 0);
+    CHECK(!query_daemon(gpus, socket_path));
+
+    // A regular file at the path is left alone
+    check_context() = "not a socket";
+    std::ofstream(socket_path) << "keep me\n";
+    InventoryServer server(inventory, nullptr);
+    std::string error;
+    CHECK(!server.listen(socket_path, error));
+    CHECK(::lstat(socket_path.c_str(), &st) == 0 && S_ISREG(st.st_mode));
+}
+
+// A daemon for the 6-card host at the default path of the live system, and
+// a run pointed at a 2-card tree: that run must probe its own tree
+void test_other_root(const std::string& scratch) {
+    check_context() = "other root";
+    SyntheticHostOptions options;
+    options.cards = 2;
+    build_synthetic_host(scratch + "/other", options);
+    const std::string runtime = scratch + "/run";
+    CHECK(::mkdir(runtime.c_str(), 0700) == 0);
+    ResidentInventory inventory(scratch + "/host");
+    inventory.scan();
+    InventoryServer server(inventory, nullptr);
+    std::string error;
+    CHECK(server.listen(runtime + "/whatsmy-gpu.sock", error));
+    std::thread serving([&] { server.run(); });
+
+    ChildRun run = run_plugin_child({"--json", "all"}, {{"WHATSMY_GPU_ROOT", scratch + "/other"},
+                                                        {"XDG_RUNTIME_DIR", runtime},
+                                                        {"WHATSMY_GPU_NO_DAEMON", ""},
+                                                        {"WHATSMY_GPU_SOCKET", ""},
+                                                        {"WHATSMY_GPU_NO_CACHE", "1"}});
+    CHECK(run.status == 0);
+    size_t cards = 0;
+    for (size_t at = run.out.find("{\"index\":"); at != std::string::npos; at = run.out.find("{\"index\":", at + 1)) {
+        ++cards;
+    }
+    CHECK(cards == 2);
+
+    server.stop();
+    serving.join();
+}
+
+} // namespace
+
+int main() {
+    ::unsetenv("WHATSMY_GPU_NO_DAEMON");
+    const std::string scratch = make_scratch_dir("daemon-socket");
+    // linux_root() is read once per process and inherited by the children
+    // of test_other_root, so it is set before anything can read it
+    ::setenv("WHATSMY_GPU_ROOT", (scratch + "/other").c_str(), 1);
+    SyntheticHostOptions options;
+    options.cards = 6;
+    build_synthetic_host(scratch + "/host", options);
+    test_serve(scratch);
+    test_other_root(scratch);
+    remove_tree(scratch);
+    return check_result("daemon_socket");
+}
@@ -0,0 +1,137 @@
+// Telemetry history test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Feeds TelemetryHistory 25 hours of 1 Hz samples with gaps and missing
+// values, keeping every sample raw as well, then holds window summaries
+// to a brute-force scan of the raw samples: min, max, sum and count must
+// be exact for every window that starts on a bucket boundary of the tier
+// chosen for it. Also covers the tier choice, late samples and the empty
+// and out-of-range cases.
+
+#include "plugin.cpp"
+
+#include "check.h"
+
+#include <random>
+
+namespace {
+
+// Hour-aligned, so every window below ends on a bucket boundary
+const int64_t kStart = 1700000000 - 1700000000 % 3600;
+
+struct RawSample {
+    int64_t time_s;
+    int64_t value;
+};
+
+bool brute_force(const std::vector<RawSample>& raw, int64_t from_s, int64_t to_s, HistoryBucket& out) {
+    out = HistoryBucket{from_s, INT64_MAX, INT64_MIN, 0, 0};
+    for (const auto& sample : raw) {
+        if (sample.time_s >= from_s && sample.time_s <= to_s) {
+            out.min = std::min(out.min, sample.value);
+            out.max = std::max(out.max, sample.value);
+            out.sum += sample.value;
+            ++out.count;
+        }
+    }
+    return out.count > 0;
+}
+
+void test_windows() {
+    const size_t kSeries = 3;
+    const int64_t kSeconds = 25 * 3600;
+    TelemetryHistory history(HistoryConfig(), kSeries);
+    std::vector<RawSample> raw[kSeries];
+    std::mt19937_64 rng(1);
+    for (int64_t t = 0; t < kSeconds; ++t) {
+        // A ten-minute gap every five hours, as when the sampler is stopped
+        if (t % 18000 < 600 && t >= 18000) {
+            continue;
+        }
+        for (size_t s = 0; s < kSeries; ++s) {
+            int64_t value = 200000000 + static_cast<int64_t>(rng() % 100000000) - int64_t(s) * 250000000;
+            if (rng() % 50 == 0) {
+                value = kTelemetryMissing;
+            }
+            history.record(s, kStart + t, value);
+            if (value != kTelemetryMissing) {
+                raw[s].push_back({kStart + t, value});
+            }
+        }
+    }
+
+    const int64_t now = kStart + kSeconds - 1;
+    static const struct {
+        int64_t seconds;
+        size_t tier;
+    } windows[] = {{60, 0}, {300, 0}, {600, 1}, {3600, 1}, {7200, 2}, {86400, 2}};
+    for (const auto& window : windows) {
+        const int64_t from = now - window.seconds + 1;
+        for (size_t s = 0; s < kSeries; ++s) {
+            check_context() = "series " + std::to_string(s) + ", last " + std::to_string(window.seconds) + " s";
+            HistoryBucket summary, expected;
+            CHECK(history.tier_for(s, from) == window.tier);
+            CHECK(history.summarize(s, from, now, summary));
+            CHECK(brute_force(raw[s], from, now, expected));
+            CHECK(summary.min == expected.min);
+            CHECK(summary.max == expected.max);
+            CHECK(summary.sum == expected.sum);
+            CHECK(summary.count == expected.count);
+        }
+    }
+
+    // Older than the coarsest tier retains: its 1440 minute buckets, which
+    // reach back 40 minutes further for the four gaps that have none
+    check_context() = "beyond retention";
+    HistoryBucket summary, expected;
+    CHECK(history.tier_for(0, kStart) == 2);
+    CHECK(history.summarize(0, kStart, now, summary));
+    CHECK(brute_force(raw[0], now + 1 - (1440 + 40) * 60, now, expected));
+    CHECK(summary.count == expected.count && summary.sum == expected.sum);
+
+    check_context() = "inside a gap";
+    CHECK(!history.summarize(0, kStart + 18000, kStart + 18000 + 599, summary));
+}
+
+void test_edges() {
+    HistoryConfig config;
+    config.tiers[0] = {1, 10};
+    config.tiers[1] = {5, 4};
+    config.tiers[2] = {0, 0};
+    CHECK(config.tier_count() == 2 && config.buckets_per_series() == 14);
+    CHECK(TelemetryHistory::memory_bytes(config, 3) == 3 * (14 * sizeof(HistoryBucket) + 2 * sizeof(uint32_t)));
+
+    TelemetryHistory history(config, 1);
+    HistoryBucket summary;
+    check_context() = "empty";
+    CHECK(!history.summarize(0, 0, 100, summary));
+    CHECK(!history.summarize(1, 0, 100, summary));
+
+    check_context() = "late and missing samples";
+    history.record(0, 100, 7);
+    history.record(0, 100, 3);
+    history.record(0, 99, 1000);   // Before the newest bucket of both tiers
+    history.record(0, 101, kTelemetryMissing);
+    history.record(1, 101, 1000);  // No such series
+    CHECK(history.summarize(0, 95, 100, summary));
+    CHECK(summary.min == 3 && summary.max == 7 && summary.sum == 10 && summary.count == 2);
+
+    // Negative times bucket down, not toward zero
+    check_context() = "negative time";
+    TelemetryHistory early(config, 1);
+    early.record(0, -3, 5);
+    early.record(0, -1, 9);
+    CHECK(early.summarize(0, -5, -1, summary) && summary.count == 2 && summary.sum == 14);
+    std::vector<int64_t> starts;
+    early.for_each_bucket(0, 1, -10, 0, [&](const HistoryBucket& bucket) { starts.push_back(bucket.start_s); });
+    CHECK(starts.size() == 1 && starts[0] == -5);
+}
+
+} // namespace
+
+int main() {
+    test_windows();
+    test_edges();
+    return check_result("history_rollup");
+}
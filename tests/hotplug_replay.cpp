@@ -0,0 +1,197 @@
+// Resident inventory replay test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Replays data/hotplug.uevents (udevadm monitor --kernel --property
+// output) through UeventSource into a ResidentInventory seeded from a
+// synthetic host of three cards, changing the host on disk as the kernel
+// would before each event. Every record's InventoryChange is held to the
+// table below, then rescan() is held to the diff of changes made with no
+// events at all, as after a receive queue overflow.
+//
+// Usage: gpu_test_hotplug_replay <hotplug.uevents>
+
+#include "plugin.cpp"
+
+#include "check.h"
+#include "synthetic_host.h"
+
+namespace {
+
+void write_text(const std::string& path, const std::string& text) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << text;
+}
+
+const char* kind_name(InventoryChange::Kind kind) {
+    switch (kind) {
+        case InventoryChange::Added: return "added";
+        case InventoryChange::Removed: return "removed";
+        case InventoryChange::Changed: return "changed";
+        default: return "none";
+    }
+}
+
+// One record of the fixture: what happens on disk first, and what apply() reports
+struct ReplayStep {
+    const char* event;
+    void (*before)(const std::string& root);
+    InventoryChange::Kind kind;
+    const char* node;         // Empty when the change names no card
+    size_t cards;             // Inventory size afterwards
+};
+
+std::string drm(const std::string& root) {
+    return root + "/sys/class/drm/";
+}
+
+const ReplayStep kSteps[] = {
+    {"card2 connector removed", nullptr, InventoryChange::None, "", 3},
+    {"card2 render node removed", nullptr, InventoryChange::None, "", 3},
+    {"card2 removed",
+     [](const std::string& root) { fs::rename(drm(root) + "card2", root + "/parked-card2"); },
+     InventoryChange::Removed, "card2", 2},
+    {"card2 added back",
+     [](const std::string& root) { fs::rename(root + "/parked-card2", drm(root) + "card2"); },
+     InventoryChange::Added, "card2", 3},
+    {"card2 connector added", nullptr, InventoryChange::None, "", 3},
+    {"card1 hotplug change", nullptr, InventoryChange::Changed, "card1", 3},
+    {"usb device added", nullptr, InventoryChange::None, "", 3},
+    {"card2 driver unbound",
+     [](const std::string& root) {
+         write_text(drm(root) + "card2/device/uevent", "PCI_CLASS=30000\nPCI_ID=8086:56A0\nPCI_SUBSYS_ID=8086:1020\n");
+     },
+     InventoryChange::Changed, "card2", 3},
+    {"i915 unloaded", nullptr, InventoryChange::None, "", 3},
+    {"i915 loaded, with a new version",
+     [](const std::string& root) { write_text(root + "/sys/module/i915/version", "2.0.0\n"); },
+     InventoryChange::None, "", 3},
+    {"card2 driver bound",
+     [](const std::string& root) {
+         write_text(drm(root) + "card2/device/uevent",
+                    "DRIVER=i915\nPCI_CLASS=30000\nPCI_ID=8086:56A0\nPCI_SUBSYS_ID=8086:1020\n");
+     },
+     InventoryChange::Changed, "card2", 3},
+    {"card3 added",
+     [](const std::string& root) {
+         fs::copy(drm(root) + "card0", drm(root) + "card3",
+                  fs::copy_options::recursive | fs::copy_options::copy_symlinks);
+     },
+     InventoryChange::Added, "card3", 4},
+    {"unknown card5 removed", nullptr, InventoryChange::None, "card5", 4},
+};
+constexpr size_t kStepCount = sizeof(kSteps) / sizeof(kSteps[0]);
+
+const GPUInfo* find_gpu(const std::vector<GPUInfo>& gpus, const std::string& node) {
+    for (const auto& gpu : gpus) {
+        if (gpu.node == node) {
+            return &gpu;
+        }
+    }
+    return nullptr;
+}
+
+void test_replay(const std::string& root, ResidentInventory& inventory, const char* fixture) {
+    UeventSource source;
+    check_context() = fixture;
+    CHECK(source.open_replay(fixture));
+    CHECK(source.replaying() && source.fd() < 0);
+
+    UeventMessage msg;
+    size_t step = 0;
+    for (; source.next(msg); ++step) {
+        if (step >= kStepCount) {
+            check_context() = "extra record " + msg.action + " " + msg.devpath;
+            CHECK(step < kStepCount);
+            continue;
+        }
+        const ReplayStep& expected = kSteps[step];
+        check_context() = expected.event;
+        CHECK(!msg.overflow);
+        if (expected.before) {
+            expected.before(root);
+        }
+        InventoryChange change = inventory.apply(msg);
+        CHECK(change.kind == expected.kind);
+        CHECK(change.node == expected.node);
+        if (change.kind != expected.kind || change.node != expected.node) {
+            std::fprintf(stderr, "  got %s \"%s\"\n", kind_name(change.kind), change.node.c_str());
+        }
+
+        auto gpus = inventory.snapshot();
+        CHECK(gpus->size() == expected.cards);
+        for (size_t i = 0; i < gpus->size(); ++i) {
+            CHECK((*gpus)[i].index == static_cast<int>(i) && (*gpus)[i].populated);
+        }
+        const GPUInfo* card2 = find_gpu(*gpus, "card2");
+        if (std::strcmp(expected.event, "card2 driver unbound") == 0) {
+            CHECK(card2 && card2->driver.empty() && card2->driver_version.empty());
+        } else if (std::strcmp(expected.event, "card2 driver bound") == 0) {
+            // The module event dropped the cached version, so the new one shows
+            CHECK(card2 && card2->driver == "i915" && card2->driver_version == "2.0.0");
+        }
+    }
+    check_context() = "replay";
+    CHECK(step == kStepCount);
+
+    // The eGPU sorts after the cards that were there first
+    auto gpus = inventory.snapshot();
+    CHECK(gpus->size() == 4 && (*gpus)[3].node == "card3" && (*gpus)[0].is_active);
+}
+
+// Changes made with no uevents at all, found by one rescan
+void test_rescan(const std::string& root, ResidentInventory& inventory) {
+    check_context() = "rescan, nothing changed";
+    CHECK(inventory.rescan().empty());
+
+    fs::remove_all(drm(root) + "card3");
+    write_text(drm(root) + "card1/device/label", "AMD Instinct MI250X OAM\n");
+    fs::copy(drm(root) + "card0", drm(root) + "card12",
+             fs::copy_options::recursive | fs::copy_options::copy_symlinks);
+    fs::copy(drm(root) + "card0", drm(root) + "card4",
+             fs::copy_options::recursive | fs::copy_options::copy_symlinks);
+
+    check_context() = "rescan";
+    std::vector<InventoryChange> changes = inventory.rescan();
+    const std::pair<InventoryChange::Kind, const char*> expected[] = {
+        {InventoryChange::Changed, "card1"},
+        {InventoryChange::Removed, "card3"},
+        {InventoryChange::Added, "card4"},
+        {InventoryChange::Added, "card12"},
+    };
+    CHECK(changes.size() == 4);
+    for (size_t i = 0; i < changes.size() && i < 4; ++i) {
+        CHECK(changes[i].kind == expected[i].first && changes[i].node == expected[i].second);
+    }
+    auto gpus = inventory.snapshot();
+    CHECK(gpus->size() == 5 && gpus->back().node == "card12");
+    const GPUInfo* card1 = find_gpu(*gpus, "card1");
+    CHECK(card1 && card1->name == "AMD Instinct MI250X OAM");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <hotplug.uevents>\n", argv[0]);
+        return 2;
+    }
+    ::setenv("WHATSMY_GPU_PCI_IDS", "", 1);
+    const std::string root = make_scratch_dir("hotplug-replay");
+    SyntheticHostOptions options;
+    options.cards = 3;
+    build_synthetic_host(root, options);
+
+    ResidentInventory inventory(root);
+    inventory.scan();
+    check_context() = "scan";
+    auto seeded = inventory.snapshot();
+    CHECK(seeded->size() == 3);
+    const GPUInfo* card2 = find_gpu(*seeded, "card2");
+    CHECK(card2 && card2->driver == "i915" && card2->driver_version == "6.8.0-synthetic");
+
+    test_replay(root, inventory, argv[1]);
+    test_rescan(root, inventory);
+    remove_tree(root);
+    return check_result("hotplug_replay");
+}
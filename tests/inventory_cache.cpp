@@ -0,0 +1,89 @@
+// Inventory cache test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Runs the plugin against a synthetic host with the inventory cache on and
+// checks which runs are served from it. After the cache is filled, names
+// on disk are changed in a way the cache key does not see (a new label
+// file), so a run that shows the old name came from the cache and one
+// that shows the new name probed. A default `whatsmy gpu` on a cold
+// cache probes only the card it shows and leaves the cache alone; `all`
+// fills it for the runs after it, the default view and `<index>`
+// included; a changed uevent must invalidate it.
+
+#include "plugin.cpp"
+
+#include "check.h"
+#include "plugin_child.h"
+#include "synthetic_host.h"
+
+namespace {
+
+void write_text(const std::string& path, const std::string& text) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << text;
+}
+
+} // namespace
+
+int main() {
+    const std::string scratch = make_scratch_dir("inventory-cache");
+    const std::string root = scratch + "/host";
+    SyntheticHostOptions options;
+    options.cards = 4;
+    build_synthetic_host(root, options);
+    const std::string cache = scratch + "/cache/whatsmy/gpu-inventory.bin";
+    const ChildEnv env = isolated_env(root, scratch + "/cache");
+    const std::string drm = root + "/sys/class/drm/";
+    struct stat st;
+
+    check_context() = "cold default run";
+    ChildRun first = run_plugin_child({}, env);
+    CHECK(first.status == 0);
+    CHECK(contains(first.out, "GPU 0"));
+    CHECK(::stat(cache.c_str(), &st) != 0);
+
+    check_context() = "cold all";
+    ChildRun filled = run_plugin_child({"all"}, env);
+    CHECK(filled.status == 0);
+    CHECK(contains(filled.out, "4 detected"));
+    CHECK(::stat(cache.c_str(), &st) == 0);
+
+    // Invisible to the key: only card and uevent mtimes and names count
+    write_text(drm + "card0/device/label", "Relabeled Card Zero\n");
+    write_text(drm + "card1/device/label", "Relabeled Card One\n");
+    ChildRun probed = run_plugin_child({"all"}, isolated_env(root));
+    check_context() = "uncached";
+    CHECK(probed.status == 0);
+    CHECK(contains(probed.out, "Relabeled Card Zero") && contains(probed.out, "Relabeled Card One"));
+
+    check_context() = "warm default run";
+    ChildRun second = run_plugin_child({}, env);
+    CHECK(second.status == 0);
+    CHECK(second.out == first.out);
+
+    check_context() = "warm index run";
+    ChildRun one = run_plugin_child({"1"}, env);
+    CHECK(one.status == 0);
+    CHECK(contains(one.out, "GPU 1") && !contains(one.out, "Relabeled"));
+
+    check_context() = "warm all";
+    ChildRun all = run_plugin_child({"all"}, env);
+    CHECK(all.status == 0);
+    CHECK(contains(all.out, "4 detected") && !contains(all.out, "Relabeled"));
+
+    // A device re-registered after the cache was written
+    check_context() = "uevent changed";
+    timespec times[2] = {{0, UTIME_NOW}, {0, UTIME_NOW}};
+    times[1].tv_sec = 1;
+    times[1].tv_nsec = 0;
+    CHECK(::utimensat(AT_FDCWD, (drm + "card1/device/uevent").c_str(), times, 0) == 0);
+    ChildRun changed = run_plugin_child({"1"}, env);
+    CHECK(changed.status == 0);
+    CHECK(contains(changed.out, "Relabeled Card One"));
+    ChildRun refilled = run_plugin_child({"all"}, env);
+    CHECK(contains(refilled.out, "Relabeled Card Zero") && contains(refilled.out, "Relabeled Card One"));
+
+    remove_tree(scratch);
+    return check_result("inventory_cache");
+}
@@ -0,0 +1,424 @@
+// JSON output test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Runs the plugin with --json and --ndjson against a synthetic host and
+// parses every line it writes with a strict parser: no raw control
+// characters in strings, nothing after the value. Each record must open
+// with the current "schema" and its "type", and carry exactly the fields
+// the JsonWriter comment lists, in that order, with null for what is
+// unknown. One card's sysfs label holds quotes, backslashes and control
+// characters, which must come back unchanged once unescaped.
+
+#include "plugin.cpp"
+
+#include "check.h"
+#include "plugin_child.h"
+#include "synthetic_host.h"
+
+namespace {
+
+// A parsed JSON value. Objects keep their members in document order.
+struct Json {
+    enum Kind { Null, Bool, Number, String, Array, Object };
+    Kind kind = Null;
+    bool flag = false;
+    std::string text;   // A string's unescaped text, or a number as written
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    const Json* get(const char* name) const {
+        for (const auto& member : members) {
+            if (member.first == name) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+
+    bool is(Kind k) const { return kind == k; }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text) : text_(text) {}
+
+    // One whole value, with nothing but whitespace around it
+    bool document(Json& value) {
+        if (!parse(value)) {
+            return false;
+        }
+        skip_space();
+        return at_ == text_.size();
+    }
+
+private:
+    bool parse(Json& value) {
+        skip_space();
+        if (at_ >= text_.size()) {
+            return false;
+        }
+        char c = text_[at_];
+        if (c == '{') {
+            return object(value);
+        }
+        if (c == '[') {
+            return array(value);
+        }
+        if (c == '"') {
+            value.kind = Json::String;
+            return string(value.text);
+        }
+        if (literal("null")) {
+            value.kind = Json::Null;
+            return true;
+        }
+        if (literal("true") || literal("false")) {
+            value.kind = Json::Bool;
+            value.flag = text_[at_ - 1] == 'e' && text_[at_ - 2] == 'u';
+            return true;
+        }
+        return number(value);
+    }
+
+    bool object(Json& value) {
+        value.kind = Json::Object;
+        ++at_;
+        skip_space();
+        if (at_ < text_.size() && text_[at_] == '}') {
+            ++at_;
+            return true;
+        }
+        for (;;) {
+            std::pair<std::string, Json> member;
+            skip_space();
+            if (at_ >= text_.size() || text_[at_] != '"' || !string(member.first)) {
+                return false;
+            }
+            skip_space();
+            if (at_ >= text_.size() || text_[at_++] != ':' || !parse(member.second)) {
+                return false;
+            }
+            value.members.push_back(std::move(member));
+            skip_space();
+            if (at_ >= text_.size()) {
+                return false;
+            }
+            char c = text_[at_++];
+            if (c == '}') {
+                return true;
+            }
+            if (c != ',') {
+                return false;
+            }
+        }
+    }
+
+    bool array(Json& value) {
+        value.kind = Json::Array;
+        ++at_;
+        skip_space();
+        if (at_ < text_.size() && text_[at_] == ']') {
+            ++at_;
+            return true;
+        }
+        for (;;) {
+            value.items.emplace_back();
+            if (!parse(value.items.back())) {
+                return false;
+            }
+            skip_space();
+            if (at_ >= text_.size()) {
+                return false;
+            }
+            char c = text_[at_++];
+            if (c == ']') {
+                return true;
+            }
+            if (c != ',') {
+                return false;
+            }
+        }
+    }
+
+    // Only what the writer can produce: single-byte \u escapes
+    bool string(std::string& out) {
+        ++at_;
+        while (at_ < text_.size()) {
+            unsigned char c = static_cast<unsigned char>(text_[at_++]);
+            if (c == '"') {
+                return true;
+            }
+            if (c < 0x20) {
+                return false;
+            }
+            if (c != '\\') {
+                out.push_back(static_cast<char>(c));
+                continue;
+            }
+            if (at_ >= text_.size()) {
+                return false;
+            }
+            char escape = text_[at_++];
+            switch (escape) {
+                case '"': case '\\': case '/': out.push_back(escape); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    unsigned code = 0;
+                    if (at_ + 4 > text_.size() ||
+                        std::from_chars(text_.data() + at_, text_.data() + at_ + 4, code, 16).ptr !=
+                            text_.data() + at_ + 4 ||
+                        code >= 0x80) {
+                        return false;
+                    }
+                    at_ += 4;
+                    out.push_back(static_cast<char>(code));
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+
+    bool number(Json& value) {
+        size_t start = at_;
+        if (at_ < text_.size() && text_[at_] == '-') {
+            ++at_;
+        }
+        size_t digits = at_;
+        while (at_ < text_.size() && (std::isdigit(static_cast<unsigned char>(text_[at_])) || text_[at_] == '.')) {
+            ++at_;
+        }
+        if (at_ == digits) {
+            return false;
+        }
+        value.kind = Json::Number;
+        value.text = std::string(text_.substr(start, at_ - start));
+        return true;
+    }
+
+    bool literal(const char* word) {
+        std::string_view w(word);
+        if (text_.substr(at_, w.size()) != w) {
+            return false;
+        }
+        at_ += w.size();
+        return true;
+    }
+
+    void skip_space() {
+        while (at_ < text_.size() && (text_[at_] == ' ' || text_[at_] == '\n' || text_[at_] == '\t' ||
+                                      text_[at_] == '\r')) {
+            ++at_;
+        }
+    }
+
+    std::string_view text_;
+    size_t at_ = 0;
+};
+
+// Every line of `output` as a JSON document; false if any is not one
+bool parse_lines(const std::string& output, std::vector<Json>& records) {
+    std::string_view text = output;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        if (end == std::string_view::npos) {
+            return false;   // Every record ends its line
+        }
+        records.emplace_back();
+        if (!JsonParser(text.substr(0, end)).document(records.back())) {
+            return false;
+        }
+        text.remove_prefix(end + 1);
+    }
+    return true;
+}
+
+std::vector<std::string> keys(const Json& object) {
+    std::vector<std::string> names;
+    for (const auto& member : object.members) {
+        names.push_back(member.first);
+    }
+    return names;
+}
+
+// `base` followed by `more`
+std::vector<std::string> fields(std::vector<std::string> base, const std::vector<std::string>& more) {
+    base.insert(base.end(), more.begin(), more.end());
+    return base;
+}
+
+const std::vector<std::string> kGpuFields = {"index", "active", "node", "name", "vendor",
+                                             "board", "driver", "driver_version", "pci_id"};
+
+// Opens with the current schema and `type`
+bool is_record(const Json& record, const char* type) {
+    const Json* schema = record.get("schema");
+    const Json* kind = record.get("type");
+    return record.is(Json::Object) && record.members.size() >= 2 && record.members[0].first == "schema" &&
+           record.members[1].first == "type" && schema->is(Json::Number) &&
+           schema->text == std::to_string(kJsonSchema) && kind->is(Json::String) && kind->text == type;
+}
+
+// The label written to card2, as its name must read once unescaped
+const char* const kAwkwardLabel = "Quote \" Back \\ Tab\t Bell\x07 Esc\x1b\x01 end";
+
+// GPU fields of the synthetic host: card1 has a board partner, the others
+// no subsystem, so board is unknown
+void check_gpu(const Json& gpu, int index) {
+    const Json* value = gpu.get("index");
+    CHECK(value && value->is(Json::Number) && value->text == std::to_string(index));
+    CHECK(gpu.get("active")->is(Json::Bool) && gpu.get("active")->flag == (index == 0));
+    CHECK(gpu.get("node")->text == "card" + std::to_string(index));
+    CHECK(gpu.get("board")->is(index == 1 ? Json::String : Json::Null));
+    for (const char* name : {"name", "vendor", "driver", "driver_version", "pci_id"}) {
+        CHECK(gpu.get(name)->is(Json::String));
+    }
+    if (index == 2) {
+        CHECK(gpu.get("name")->text == kAwkwardLabel);
+    }
+}
+
+void check_inventory(const std::string& output) {
+    std::vector<Json> records;
+    CHECK(parse_lines(output, records));
+    CHECK(records.size() == 1);
+    if (records.size() != 1) {
+        return;
+    }
+    const Json& inventory = records[0];
+    CHECK(is_record(inventory, "inventory"));
+    CHECK(keys(inventory) == fields({"schema", "type"}, {"gpus"}));
+    const Json* gpus = inventory.get("gpus");
+    CHECK(gpus && gpus->is(Json::Array) && gpus->items.size() == 3);
+    for (size_t i = 0; gpus && i < gpus->items.size(); ++i) {
+        CHECK(keys(gpus->items[i]) == kGpuFields);
+        check_gpu(gpus->items[i], static_cast<int>(i));
+    }
+}
+
+// "gpu" records for `indices`, one per line
+void check_gpu_records(const std::string& output, const std::vector<int>& indices) {
+    std::vector<Json> records;
+    CHECK(parse_lines(output, records));
+    CHECK(records.size() == indices.size());
+    for (size_t i = 0; i < records.size() && i < indices.size(); ++i) {
+        CHECK(is_record(records[i], "gpu"));
+        CHECK(keys(records[i]) == fields({"schema", "type"}, kGpuFields));
+        check_gpu(records[i], indices[i]);
+    }
+}
+
+void check_sample(const Json& sample, int tick) {
+    CHECK(is_record(sample, "sample"));
+    CHECK(keys(sample) == fields({"schema", "type"}, {"tick", "time", "read_ns", "jitter_ns", "jitter_mean_ns",
+                                                      "jitter_max_ns", "cpu_percent", "dropped", "values"}));
+    CHECK(sample.get("tick")->text == std::to_string(tick));
+    // No interval to average CPU use over before the second tick
+    CHECK(sample.get("cpu_percent")->is(tick == 0 ? Json::Null : Json::Number));
+    const Json* values = sample.get("values");
+    CHECK(values && values->is(Json::Array) && !values->items.empty());
+    size_t totals = 0;
+    for (size_t i = 0; values && i < values->items.size(); ++i) {
+        const Json& value = values->items[i];
+        CHECK(keys(value) == std::vector<std::string>({"gpu", "name", "kind", "unit", "value", "total"}));
+        CHECK(value.get("value")->is(Json::Number));
+        // Only memory has a total; anything else is unknown there
+        const bool memory = value.get("kind")->text == "memory";
+        CHECK(value.get("total")->is(memory ? Json::Number : Json::Null));
+        totals += memory;
+    }
+    CHECK(totals > 0);
+}
+
+void check_history(const Json& history) {
+    CHECK(is_record(history, "history"));
+    CHECK(keys(history) == fields({"schema", "type"}, {"series"}));
+    const Json* series = history.get("series");
+    CHECK(series && series->is(Json::Array) && !series->items.empty());
+    for (size_t i = 0; series && i < series->items.size(); ++i) {
+        const Json& one = series->items[i];
+        CHECK(keys(one) == std::vector<std::string>({"gpu", "name", "kind", "unit", "windows"}));
+        const Json* windows = one.get("windows");
+        CHECK(windows && windows->items.size() == 3);
+        for (size_t w = 0; windows && w < windows->items.size(); ++w) {
+            CHECK(keys(windows->items[w]) ==
+                  std::vector<std::string>({"window", "seconds", "min", "mean", "max"}));
+        }
+    }
+}
+
+// Two ticks and the history summary, a record per line either way
+void check_watch(const std::string& output) {
+    std::vector<Json> records;
+    CHECK(parse_lines(output, records));
+    CHECK(records.size() == 3);
+    if (records.size() == 3) {
+        check_sample(records[0], 0);
+        check_sample(records[1], 1);
+        check_history(records[2]);
+    }
+}
+
+} // namespace
+
+int main() {
+    const std::string root = make_scratch_dir("json-output");
+    SyntheticHostOptions options;
+    options.cards = 3;
+    build_synthetic_host(root, options);
+    std::ofstream(root + "/sys/class/drm/card2/device/label") << kAwkwardLabel << "\n";
+    const ChildEnv env = isolated_env(root);
+    auto run = [&](const std::vector<std::string>& args) {
+        ChildRun child = run_plugin_child(args, env);
+        CHECK(child.status == 0 && child.err.empty());
+        return child.out;
+    };
+
+    check_context() = "--json all";
+    const std::string all = run({"--json", "all"});
+    check_inventory(all);
+    // Escaped as the writer does it, not just in some equivalent form
+    CHECK(all.find("\"name\":\"Quote \\\" Back \\\\ Tab\\t Bell\\u0007 Esc\\u001b\\u0001 end\"") !=
+          std::string::npos);
+
+    check_context() = "--json <index>";
+    check_gpu_records(run({"--json", "2"}), {2});
+    check_gpu_records(run({"1", "--format=json"}), {1});
+
+    check_context() = "--ndjson all";
+    check_gpu_records(run({"--ndjson", "all"}), {0, 1, 2});
+
+    check_context() = "watch --json";
+    check_watch(run({"watch", "--count", "2", "--interval", "10", "--history", "--json"}));
+    check_context() = "watch --ndjson";
+    check_watch(run({"watch", "--count", "2", "--interval", "10", "--history", "--ndjson"}));
+
+    // NVIDIA has no busy attribute, so the reading is unknown
+    check_context() = "prompt --json";
+    std::vector<Json> records;
+    CHECK(parse_lines(run({"prompt", "--json"}), records) && records.size() == 1);
+    if (records.size() == 1) {
+        CHECK(is_record(records[0], "prompt"));
+        CHECK(keys(records[0]) ==
+              fields({"schema", "type"}, {"index", "name", "temperature_c", "busy_percent"}));
+        CHECK(records[0].get("temperature_c")->is(Json::Number));
+        CHECK(records[0].get("busy_percent")->is(Json::Null));
+    }
+
+    // An index that is not a whole number in range selects nothing, rather
+    // than GPU 0 or a truncated value
+    check_context() = "prompt <bad index>";
+    for (const char* index : {"", "x", "-1", "4294967296"}) {
+        ChildRun child = run_plugin_child({"prompt", index, "--json"}, env);
+        CHECK(child.status == 1 && child.out.empty() && contains(child.err, "Invalid argument"));
+    }
+
+    remove_tree(root);
+    return check_result("json_output");
+}
@@ -0,0 +1,417 @@
+// Detection over MemorySysfs
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Table-driven tests of enumerate_gpus_linux() and probe_card() over trees
+// built in memory, one case per sysfs shape worth keeping right: missing
+// and malformed uevent keys, name attributes, board partners, vendors the
+// short names or the PCI tables do not know, driver versions and hwmon
+// layouts. Then a sweep of generated layouts, and one synthetic host read
+// from disk and from a MemorySysfs copy, which must agree.
+//
+// PCI names come from the tables compiled from data/pci.ids.display only;
+// the system pci.ids is switched off so results do not depend on the host.
+
+#include "plugin.cpp"
+
+#include "check.h"
+#include "synthetic_host.h"
+
+#include <random>
+
+namespace {
+
+const char* const kDevice = "sys/devices/pci0000:00/0000:00:01.0";
+
+// One card's sysfs, as a case describes it. A null attribute has no file.
+struct CardTree {
+    const char* uevent;
+    const char* label;
+    const char* product_name;
+    const char* driver;           // Bound driver and its module
+    const char* module_version;   // sys/module/<driver>/version
+    const char* nvidia_proc;      // /proc/driver/nvidia/version
+};
+
+void build_card(MemorySysfs& fs, const CardTree& tree) {
+    const std::string dev = kDevice;
+    fs.add_link("sys/class/drm/card0", "../../devices/pci0000:00/0000:00:01.0/drm/card0");
+    fs.add_link("sys/class/drm/card0-DP-1", "../../devices/pci0000:00/0000:00:01.0/drm/card0/card0-DP-1");
+    fs.add_link("sys/class/drm/renderD128", "../../devices/pci0000:00/0000:00:01.0/drm/renderD128");
+    fs.add_link(dev + "/drm/card0/device", "../../../0000:00:01.0");
+    fs.add_file("proc/sys/kernel/osrelease", "6.8.0-memory\n");
+    if (tree.uevent) {
+        fs.add_file(dev + "/uevent", tree.uevent);
+    }
+    if (tree.label) {
+        fs.add_file(dev + "/label", tree.label);
+    }
+    if (tree.product_name) {
+        fs.add_file(dev + "/product_name", tree.product_name);
+    }
+    if (tree.driver) {
+        const std::string driver = tree.driver;
+        fs.add_link(dev + "/driver", "../../../bus/pci/drivers/" + driver);
+        fs.add_link("sys/bus/pci/drivers/" + driver + "/module", "../../../../module/" + driver);
+        fs.add_dir("sys/module/" + driver);
+        if (tree.module_version) {
+            fs.add_file("sys/module/" + driver + "/version", tree.module_version);
+        }
+    }
+    if (tree.nvidia_proc) {
+        fs.add_file("proc/driver/nvidia/version", tree.nvidia_proc);
+    }
+}
+
+struct ProbeCase {
+    const char* name;
+    CardTree tree;
+    // What detection reports for card0
+    const char* gpu_name;
+    const char* vendor;
+    const char* board;
+    const char* pci_id;
+    const char* driver;
+    const char* driver_version;
+};
+
+const char* const kNvidiaProc =
+    "NVRM version: NVIDIA UNIX x86_64 Kernel Module  550.54.15  Tue Mar  5 22:23:56 UTC 2024\n";
+
+const ProbeCase kProbeCases[] = {
+    {"vendor subsystem names the SKU",
+     {"DRIVER=nvidia\nPCI_CLASS=30200\nPCI_ID=10DE:2330\nPCI_SUBSYS_ID=10DE:16C1\n", nullptr, nullptr, "nvidia",
+      nullptr, kNvidiaProc},
+     "NVIDIA H100 SXM5 80GB", "NVIDIA", "", "10DE:2330", "nvidia", "550.54.15"},
+    {"board partner with a subsystem entry",
+     {"DRIVER=nvidia\nPCI_ID=10DE:2204\nPCI_SUBSYS_ID=1043:87B3\n", nullptr, nullptr, "nvidia", nullptr, kNvidiaProc},
+     "NVIDIA GA102 [GeForce RTX 3090]", "NVIDIA", "ASUSTeK Computer Inc. ROG Strix GeForce RTX 3090", "10DE:2204",
+     "nvidia", "550.54.15"},
+    {"board partner without a subsystem entry",
+     {"DRIVER=amdgpu\nPCI_ID=1002:744C\nPCI_SUBSYS_ID=1458:2400\n", nullptr, nullptr, "amdgpu", nullptr, nullptr},
+     "AMD Navi 31 [Radeon RX 7900 XT/7900 XTX/7900 GRE/7900M]", "AMD", "Gigabyte Technology Co., Ltd", "1002:744C",
+     "amdgpu", "6.8.0-memory"},
+    {"board partner the tables do not know",
+     {"DRIVER=amdgpu\nPCI_ID=1002:744C\nPCI_SUBSYS_ID=1EAE:7901\n", nullptr, nullptr, "amdgpu", nullptr, nullptr},
+     "AMD Navi 31 [Radeon RX 7900 XT/7900 XTX/7900 GRE/7900M]", "AMD", "", "1002:744C", "amdgpu", "6.8.0-memory"},
+    {"missing uevent",
+     {nullptr, nullptr, nullptr, "i915", "1.6.0\n", nullptr},
+     "Unknown GPU", "Unknown", "", "", "", ""},
+    {"missing uevent, label still names the card",
+     {nullptr, "Board 7\n", nullptr, nullptr, nullptr, nullptr},
+     "Board 7", "Unknown", "", "", "", ""},
+    {"empty uevent",
+     {"", nullptr, nullptr, nullptr, nullptr, nullptr},
+     "Unknown GPU", "Unknown", "", "", "", ""},
+    {"PCI_SUBSYS_ID with a dash",
+     {"DRIVER=nvidia\nPCI_ID=10DE:2330\nPCI_SUBSYS_ID=10DE-16C1\n", nullptr, nullptr, "nvidia", nullptr, kNvidiaProc},
+     "NVIDIA GH100 [H100 SXM5 80GB]", "NVIDIA", "", "10DE:2330", "nvidia", "550.54.15"},
+    {"PCI_SUBSYS_ID too short",
+     {"DRIVER=nvidia\nPCI_ID=10DE:2204\nPCI_SUBSYS_ID=1043:87B\n", nullptr, nullptr, "nvidia", nullptr, kNvidiaProc},
+     "NVIDIA GA102 [GeForce RTX 3090]", "NVIDIA", "", "10DE:2204", "nvidia", "550.54.15"},
+    {"PCI_SUBSYS_ID not hex",
+     {"DRIVER=nvidia\nPCI_ID=10DE:2204\nPCI_SUBSYS_ID=1043:87G3\n", nullptr, nullptr, "nvidia", nullptr, kNvidiaProc},
+     "NVIDIA GA102 [GeForce RTX 3090]", "NVIDIA", "", "10DE:2204", "nvidia", "550.54.15"},
+    {"PCI_SUBSYS_ID empty",
+     {"DRIVER=nvidia\nPCI_ID=10DE:2204\nPCI_SUBSYS_ID=\n", nullptr, nullptr, "nvidia", nullptr, kNvidiaProc},
+     "NVIDIA GA102 [GeForce RTX 3090]", "NVIDIA", "", "10DE:2204", "nvidia", "550.54.15"},
+    {"PCI_ID without a colon",
+     {"DRIVER=nvidia\nPCI_ID=10DE2330\n", nullptr, nullptr, "nvidia", nullptr, kNvidiaProc},
+     "Unknown GPU [10DE2330]", "Unknown", "", "10DE2330", "nvidia", "550.54.15"},
+    {"lowercase ids",
+     {"DRIVER=nvidia\nPCI_ID=10de:2330\nPCI_SUBSYS_ID=10de:16c1\n", nullptr, nullptr, "nvidia", nullptr, kNvidiaProc},
+     "NVIDIA H100 SXM5 80GB", "NVIDIA", "", "10de:2330", "nvidia", "550.54.15"},
+    {"no uevent trailing newline",
+     {"PCI_ID=8086:56A0\nDRIVER=i915", nullptr, nullptr, "i915", "1.6.0\n", nullptr},
+     "Intel DG2 [Arc A770]", "Intel", "", "8086:56A0", "i915", "1.6.0"},
+    {"no label, device the tables do not know",
+     {"DRIVER=nvidia\nPCI_ID=10DE:FFFE\n", nullptr, nullptr, "nvidia", nullptr, kNvidiaProc},
+     "NVIDIA GPU [10DE:FFFE]", "NVIDIA", "", "10DE:FFFE", "nvidia", "550.54.15"},
+    {"label wins over the PCI names",
+     {"DRIVER=nvidia\nPCI_ID=10DE:2330\n", "Custom Board\n", nullptr, "nvidia", nullptr, kNvidiaProc},
+     "Custom Board", "NVIDIA", "", "10DE:2330", "nvidia", "550.54.15"},
+    {"empty label falls through to product_name",
+     {"DRIVER=amdgpu\nPCI_ID=1002:74A1\n", "\n", "AMD Instinct MI300X OAM\n", "amdgpu", nullptr, nullptr},
+     "AMD Instinct MI300X OAM", "AMD", "", "1002:74A1", "amdgpu", "6.8.0-memory"},
+    {"vendor named by the PCI tables",
+     {"DRIVER=ast\nPCI_ID=1A03:2000\nPCI_SUBSYS_ID=15D9:1B95\n", nullptr, nullptr, "ast", nullptr, nullptr},
+     "ASPEED Technology, Inc. ASPEED Graphics Family", "ASPEED Technology, Inc.", "Super Micro Computer Inc",
+     "1A03:2000", "ast", "6.8.0-memory"},
+    {"vendor nobody knows",
+     {"DRIVER=msm\nPCI_ID=5143:0001\n", nullptr, nullptr, "msm", nullptr, nullptr},
+     "Unknown GPU [5143:0001]", "Unknown", "", "5143:0001", "msm", "6.8.0-memory"},
+    {"vendor nobody knows, with a label",
+     {"DRIVER=msm\nPCI_ID=5143:0001\n", "Adreno 690\n", nullptr, "msm", nullptr, nullptr},
+     "Adreno 690", "Unknown", "", "5143:0001", "msm", "6.8.0-memory"},
+    {"module version",
+     {"DRIVER=xe\nPCI_ID=8086:7D55\n", nullptr, nullptr, "xe", "2.1.0\n", nullptr},
+     "Intel Meteor Lake-P [Intel Arc Graphics]", "Intel", "", "8086:7D55", "xe", "2.1.0"},
+    {"nvidia without /proc/driver/nvidia",
+     {"DRIVER=nvidia\nPCI_ID=10DE:27B8\n", nullptr, nullptr, "nvidia", "550.54.15\n", nullptr},
+     "NVIDIA AD104GL [L4]", "NVIDIA", "", "10DE:27B8", "nvidia", "550.54.15"},
+    {"no driver bound",
+     {"PCI_ID=1AF4:1050\n", nullptr, nullptr, nullptr, nullptr, nullptr},
+     "Red Hat, Inc. Virtio 1.0 GPU", "Red Hat, Inc.", "", "1AF4:1050", "", ""},
+};
+
+void test_probe_cases() {
+    for (const auto& test : kProbeCases) {
+        check_context() = test.name;
+        MemorySysfs fs;
+        build_card(fs, test.tree);
+        std::vector<GPUInfo> gpus = detect_gpus_linux(fs, "", 1);
+        CHECK(gpus.size() == 1);
+        if (gpus.size() != 1) {
+            continue;
+        }
+        const GPUInfo& gpu = gpus[0];
+        CHECK(gpu.populated && gpu.node == "card0" && gpu.index == 0 && gpu.is_active);
+        CHECK(gpu.name == test.gpu_name);
+        CHECK(gpu.vendor == test.vendor);
+        CHECK(gpu.board == test.board);
+        CHECK(gpu.pci_id == test.pci_id);
+        CHECK(gpu.driver == test.driver);
+        CHECK(gpu.driver_version == test.driver_version);
+        if (gpu.name != test.gpu_name || gpu.vendor != test.vendor || gpu.board != test.board) {
+            std::fprintf(stderr, "  got name \"%s\" vendor \"%s\" board \"%s\"\n", gpu.name.c_str(),
+                         gpu.vendor.c_str(), gpu.board.c_str());
+        }
+    }
+}
+
+struct EnumerateCase {
+    const char* name;
+    std::vector<std::string> entries;
+    std::vector<std::string> cards;   // In index order
+};
+
+void test_enumerate_cases() {
+    const EnumerateCase cases[] = {
+        {"no cards", {"version"}, {}},
+        {"connectors and render nodes are not cards",
+         {"card0", "card0-DP-1", "card0-HDMI-A-1", "renderD128", "version"}, {"card0"}},
+        {"card numbers, not names, set the order",
+         {"card0", "card1", "card10", "card2", "renderD128", "renderD129"}, {"card0", "card1", "card2", "card10"}},
+        {"gaps keep their card numbers in order", {"card3", "card1-DP-2", "card1"}, {"card1", "card3"}},
+    };
+    for (const auto& test : cases) {
+        check_context() = test.name;
+        std::vector<GPUInfo> gpus = enumerate_gpus_linux(test.entries);
+        CHECK(gpus.size() == test.cards.size());
+        for (size_t i = 0; i < gpus.size() && i < test.cards.size(); ++i) {
+            CHECK(gpus[i].node == test.cards[i]);
+            CHECK(gpus[i].index == static_cast<int>(i));
+            CHECK(gpus[i].is_active == (i == 0));
+            CHECK(!gpus[i].populated);
+        }
+    }
+}
+
+// hwmon directories below the device: the prompt's temperature comes from
+// the first (in name order) that has a temp1_input
+struct HwmonCase {
+    const char* name;
+    std::vector<std::pair<std::string, std::string>> files;   // Below device/hwmon, and contents
+    const char* temperature;   // temp1_input read, or null for none
+};
+
+void test_hwmon_cases() {
+    const HwmonCase cases[] = {
+        {"no hwmon directory", {}, nullptr},
+        {"empty hwmon directory", {{"", ""}}, nullptr},
+        {"one hwmon", {{"hwmon3/name", "amdgpu\n"}, {"hwmon3/temp1_input", "45000\n"}}, "45000"},
+        {"first hwmon has no temperature",
+         {{"hwmon0/name", "nvme\n"}, {"hwmon0/in0_input", "900\n"}, {"hwmon1/temp1_input", "61000\n"}},
+         "61000"},
+        {"two with temperatures, first by name",
+         {{"hwmon4/temp1_input", "38000\n"}, {"hwmon5/temp1_input", "52000\n"}}, "38000"},
+        {"other entries beside hwmonN are skipped",
+         {{"power/control", "auto\n"}, {"temp1_input", "99000\n"}, {"hwmon2/temp1_input", "47000\n"}}, "47000"},
+        {"only temp2", {{"hwmon0/temp2_input", "47000\n"}, {"hwmon0/temp2_label", "junction\n"}}, nullptr},
+    };
+    for (const auto& test : cases) {
+        check_context() = test.name;
+        MemorySysfs fs;
+        build_card(fs, {"DRIVER=amdgpu\nPCI_ID=1002:744C\n", nullptr, nullptr, "amdgpu", nullptr, nullptr});
+        for (const auto& file : test.files) {
+            if (file.first.empty()) {
+                fs.add_dir(std::string(kDevice) + "/hwmon");
+            } else {
+                fs.add_file(std::string(kDevice) + "/hwmon/" + file.first, file.second);
+            }
+        }
+        SysfsDir root_dir(fs, "");
+        SysfsDir device(root_dir, "sys/class/drm/card0/device");
+        CHECK(device.valid());
+        SysfsAttr attr;
+        bool found = read_prompt_temperature(device, "card0", attr);
+        CHECK(found == (test.temperature != nullptr));
+        if (found && test.temperature) {
+            CHECK(attr.line() == test.temperature);
+        }
+        // hwmon never changes what detection reports
+        std::vector<GPUInfo> gpus = detect_gpus_linux(fs, "", 1);
+        CHECK(gpus.size() == 1 && gpus[0].name == "AMD Navi 31 [Radeon RX 7900 XT/7900 XTX/7900 GRE/7900M]");
+    }
+}
+
+// The prompt's readings are parsed from the attribute buffer, which holds
+// exactly what read() returned and no terminator
+void test_prompt_values() {
+    struct Case {
+        const char* name;
+        std::string contents;
+        bool parses;
+        long long value;
+    };
+    const Case cases[] = {
+        {"millicelsius", "45000\n", true, 45000},
+        {"no newline", "87", true, 87},
+        {"negative", "-5000\n", true, -5000},
+        {"only the first line", "12\n34\n", true, 12},
+        {"empty", "", false, 0},
+        {"blank line", "\n", false, 0},
+        {"not a number", "N/A\n", false, 0},
+        {"trailing text", "45000 mC\n", false, 0},
+        {"out of range", "99999999999999999999\n", false, 0},
+        {"buffer full of digits", std::string(sizeof(SysfsAttr::data), '7'), false, 0},
+    };
+    for (const auto& test : cases) {
+        check_context() = test.name;
+        SysfsAttr attr;
+        // Whatever the last read left past the end must not be parsed
+        std::memset(attr.data, '9', sizeof(attr.data));
+        std::memcpy(attr.data, test.contents.data(), test.contents.size());
+        attr.size = test.contents.size();
+        long long value = 0;
+        CHECK(parse_attr_number(attr, value) == test.parses);
+        CHECK(!test.parses || value == test.value);
+    }
+}
+
+// A generated single-card layout, and so what detection must report
+struct Layout {
+    uint16_t vendor, device, subvendor, subdevice;
+    bool uevent, pci_id, subsystem, malformed_subsystem;
+    std::string label;       // Empty: no label file
+    std::string driver;      // Empty: no driver bound
+    std::string version;     // Empty: module carries no version
+};
+
+Layout random_layout(std::mt19937& rng) {
+    static const uint16_t vendors[] = {0x10de, 0x1002, 0x8086, 0x1a03, 0x5143, 0x1234};
+    static const char* const drivers[] = {"nvidia", "amdgpu", "i915", "xe", "ast", ""};
+    Layout layout;
+    layout.vendor = vendors[rng() % 6];
+    layout.device = static_cast<uint16_t>(rng());
+    layout.subvendor = rng() % 2 ? layout.vendor : 0x1043;
+    layout.subdevice = static_cast<uint16_t>(rng());
+    layout.uevent = rng() % 10 != 0;
+    layout.pci_id = rng() % 8 != 0;
+    layout.subsystem = rng() % 2 == 0;
+    layout.malformed_subsystem = layout.subsystem && rng() % 5 == 0;
+    if (rng() % 3 == 0) {
+        layout.label = rng() % 4 ? "Board " + std::to_string(rng() % 1000) : "";
+    }
+    layout.driver = drivers[rng() % 6];
+    if (!layout.driver.empty() && rng() % 3) {
+        layout.version = std::to_string(rng() % 600) + "." + std::to_string(rng() % 100);
+    }
+    return layout;
+}
+
+void build_layout(MemorySysfs& fs, const Layout& layout) {
+    std::string uevent;
+    char line[64];
+    if (!layout.driver.empty()) {
+        uevent += "DRIVER=" + layout.driver + "\n";
+    }
+    if (layout.pci_id) {
+        std::snprintf(line, sizeof(line), "PCI_ID=%04X:%04X\n", layout.vendor, layout.device);
+        uevent += line;
+    }
+    if (layout.subsystem) {
+        std::snprintf(line, sizeof(line), layout.malformed_subsystem ? "PCI_SUBSYS_ID=%04X-%04X\n"
+                                                                     : "PCI_SUBSYS_ID=%04X:%04X\n",
+                      layout.subvendor, layout.subdevice);
+        uevent += line;
+    }
+    const std::string label = layout.label.empty() ? "" : layout.label + "\n";
+    const std::string version = layout.version.empty() ? "" : layout.version + "\n";
+    build_card(fs, {layout.uevent ? uevent.c_str() : nullptr, label.empty() ? nullptr : label.c_str(), nullptr,
+                    layout.driver.empty() ? nullptr : layout.driver.c_str(),
+                    version.empty() ? nullptr : version.c_str(), nullptr});
+}
+
+// Expectations that follow from the layout alone, whatever the PCI names say
+void check_layout(const Layout& layout, const std::vector<GPUInfo>& gpus) {
+    CHECK(gpus.size() == 1 && gpus[0].populated);
+    if (gpus.size() != 1) {
+        return;
+    }
+    const GPUInfo& gpu = gpus[0];
+    char pci_id[16];
+    std::snprintf(pci_id, sizeof(pci_id), "%04X:%04X", layout.vendor, layout.device);
+    CHECK(gpu.pci_id == (layout.uevent && layout.pci_id ? pci_id : ""));
+    CHECK(!gpu.name.empty() && gpu.name.front() != ' ');
+    CHECK(layout.label.empty() || gpu.name == layout.label);
+    CHECK(!gpu.vendor.empty());
+    const std::string driver = layout.uevent ? layout.driver : "";
+    CHECK(gpu.driver == driver);
+    // nvidia without /proc/driver/nvidia or a module version falls back further
+    const std::string version = driver.empty() ? "" : layout.version.empty() ? "6.8.0-memory" : layout.version;
+    CHECK(gpu.driver_version == version || (driver == "nvidia" && layout.version.empty()));
+    CHECK(!layout.malformed_subsystem || gpu.board.empty());
+}
+
+void test_generated_layouts() {
+    std::mt19937 rng(7);
+    for (int i = 0; i < 500; ++i) {
+        check_context() = "layout " + std::to_string(i);
+        Layout layout = random_layout(rng);
+        MemorySysfs fs;
+        build_layout(fs, layout);
+        check_layout(layout, detect_gpus_linux(fs, "", 1));
+    }
+}
+
+// The same synthetic host from disk and from memory
+void test_posix_matches_memory() {
+    check_context() = "posix vs memory";
+    const std::string root = make_scratch_dir("memory-backend");
+    SyntheticHostOptions options;
+    options.cards = 8;
+    build_synthetic_host(root, options);
+    MemorySysfs memory;
+    memory.load(root);
+    std::vector<GPUInfo> on_disk = detect_gpus_linux(posix_sysfs(), root, 1);
+    std::vector<GPUInfo> in_memory = detect_gpus_linux(memory, "", 1);
+    CHECK(on_disk.size() == 8 && in_memory.size() == on_disk.size());
+    for (size_t i = 0; i < on_disk.size() && i < in_memory.size(); ++i) {
+        check_context() = "posix vs memory, " + on_disk[i].node;
+        CHECK(in_memory[i].node == on_disk[i].node);
+        CHECK(in_memory[i].name == on_disk[i].name);
+        CHECK(in_memory[i].vendor == on_disk[i].vendor);
+        CHECK(in_memory[i].board == on_disk[i].board);
+        CHECK(in_memory[i].pci_id == on_disk[i].pci_id);
+        CHECK(in_memory[i].driver == on_disk[i].driver);
+        CHECK(in_memory[i].driver_version == on_disk[i].driver_version);
+        CHECK(in_memory[i].is_active == on_disk[i].is_active);
+    }
+    remove_tree(root);
+}
+
+} // namespace
+
+int main() {
+    // Names from the compiled tables only, and no prompt cache to write
+    ::setenv("WHATSMY_GPU_PCI_IDS", "", 1);
+    ::setenv("WHATSMY_GPU_NO_CACHE", "1", 1);
+    test_probe_cases();
+    test_enumerate_cases();
+    test_hwmon_cases();
+    test_prompt_values();
+    test_generated_layouts();
+    test_posix_matches_memory();
+    return check_result("memory_backend");
+}
@@ -0,0 +1,127 @@
+// pci.ids index test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Builds the binary index from a pci.ids written here, then holds lookups
+// to what the text says: every vendor, device and subsystem entry found
+// under its own name, nothing found that the text does not have. Then the
+// cache: a second index maps the file the first stored, a changed source
+// is reindexed, and without a cache path there is no index at all.
+
+#include "plugin.cpp"
+
+#include "check.h"
+#include "synthetic_host.h"
+
+#include <random>
+
+namespace {
+
+struct Entry {
+    uint64_t key;
+    std::string name;
+};
+
+// The vendored display subset followed by `vendors` synthetic vendors with
+// devices and subsystems, with the class section pci.ids ends with
+std::vector<Entry> write_pci_ids(const std::string& path, const std::string& subset, int vendors) {
+    std::ifstream in(subset);
+    std::ofstream out(path, std::ios::trunc);
+    out << in.rdbuf();
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(42);
+    char line[128];
+    for (int v = 0; v < vendors; ++v) {
+        uint16_t vendor = static_cast<uint16_t>(0x2000 + v);
+        std::string name = "Synthetic Semiconductor " + std::to_string(v);
+        std::snprintf(line, sizeof(line), "%04x  %s\n", vendor, name.c_str());
+        out << line;
+        entries.push_back({pci_key(vendor, kPciAny, kPciAny, kPciAny), name});
+        for (int d = 0; d < 1 + static_cast<int>(rng() % 6); ++d) {
+            uint16_t device = static_cast<uint16_t>(0x1000 + d * 7);
+            name = "SY" + std::to_string(v) + "-" + std::to_string(d) + " [Series " + std::to_string(v % 9) + "]";
+            std::snprintf(line, sizeof(line), "\t%04x  %s\n", device, name.c_str());
+            out << line;
+            entries.push_back({pci_key(vendor, device, kPciAny, kPciAny), name});
+            for (int s = 0; s < static_cast<int>(rng() % 3); ++s) {
+                uint16_t subdevice = static_cast<uint16_t>(0x0100 + s);
+                name = "Board Partner Edition " + std::to_string(s);
+                std::snprintf(line, sizeof(line), "\t\t%04x %04x  %s\n", vendor, subdevice, name.c_str());
+                out << line;
+                entries.push_back({pci_key(vendor, device, vendor, subdevice), name});
+            }
+        }
+    }
+    out << "# List of known device classes\nC 03  Display controller\n\t00  VGA compatible controller\n";
+    return entries;
+}
+
+void check_entries(const PciIdsIndex& index, const std::vector<Entry>& entries) {
+    size_t wrong = 0;
+    for (const auto& entry : entries) {
+        std::string_view name;
+        wrong += !index.lookup(entry.key, name) || name != entry.name;
+    }
+    CHECK(wrong == 0);
+}
+
+void test_index(const std::string& scratch, const std::string& subset) {
+    const std::string source = scratch + "/pci.ids";
+    const std::string cache = scratch + "/cache/pci-ids.idx";
+    std::vector<Entry> entries = write_pci_ids(source, subset, 300);
+
+    check_context() = "built";
+    struct stat st;
+    {
+        PciIdsIndex index(source, cache);
+        CHECK(index.available());
+        check_entries(index, entries);
+        std::string_view name;
+        CHECK(index.lookup(pci_key(0x10de, kPciAny, kPciAny, kPciAny), name) && name == "NVIDIA Corporation");
+        CHECK(!index.lookup(pci_key(0x2000 + 300, kPciAny, kPciAny, kPciAny), name));
+        CHECK(!index.lookup(pci_key(0x2000, 0x1000, 0x2000, 0x0fff), name));
+        // The class section is not read as a vendor
+        CHECK(!index.lookup(pci_key(0x0000, kPciAny, kPciAny, kPciAny), name));
+        CHECK(::stat(cache.c_str(), &st) == 0 && st.st_size > 0);
+    }
+
+    check_context() = "cached";
+    {
+        PciIdsIndex index(source, cache);
+        CHECK(index.available());
+        check_entries(index, entries);
+        struct stat again;
+        CHECK(::stat(cache.c_str(), &again) == 0 && again.st_ino == st.st_ino);
+    }
+
+    // A different source invalidates the cached index
+    check_context() = "source changed";
+    entries = write_pci_ids(source, subset, 40);
+    {
+        PciIdsIndex index(source, cache);
+        CHECK(index.available());
+        check_entries(index, entries);
+        std::string_view name;
+        CHECK(!index.lookup(pci_key(0x2000 + 200, kPciAny, kPciAny, kPciAny), name));
+    }
+
+    check_context() = "no cache";
+    PciIdsIndex uncached(source, "");
+    CHECK(!uncached.available());
+    PciIdsIndex missing(scratch + "/absent.ids", scratch + "/cache/absent.idx");
+    CHECK(!missing.available());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <pci.ids.display>\n", argv[0]);
+        return 2;
+    }
+    const std::string scratch = make_scratch_dir("pciids-index");
+    test_index(scratch, argv[1]);
+    remove_tree(scratch);
+    return check_result("pciids_index");
+}
@@ -0,0 +1,114 @@
+// Run the plugin in a child process
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// For tests that compile plugin.cpp in and need whole runs of it: each run
+// is a fork, so whatever it changes in process-wide state (the caches, the
+// reader pool, the options) dies with it. What this process already set up
+// is inherited, linux_root() included, so a test that touches it before
+// forking must set WHATSMY_GPU_ROOT first. Include after plugin.cpp.
+
+#pragma once
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct ChildRun {
+    std::string out;    // Everything written to stdout
+    std::string err;    // ... and to stderr
+    int status = -1;    // Exit status, or -1 if the child did not exit
+};
+
+typedef std::vector<std::pair<const char*, std::string>> ChildEnv;
+
+inline bool contains(const std::string& text, const std::string& needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+// Environment for a run that sees the synthetic host at `root` and nothing
+// of this machine: no daemon, no shared-memory snapshot, no system pci.ids.
+// The inventory cache lives under `cache_home`, or is off if that is empty.
+inline ChildEnv isolated_env(const std::string& root, const std::string& cache_home = "") {
+    ChildEnv env = {
+        {"WHATSMY_GPU_ROOT", root},
+        {"WHATSMY_GPU_NO_DAEMON", "1"},
+        {"WHATSMY_GPU_SHM", "/whatsmy-gpu-test-none"},
+        {"WHATSMY_GPU_PCI_IDS", ""},
+    };
+    if (cache_home.empty()) {
+        env.push_back({"WHATSMY_GPU_NO_CACHE", "1"});
+    } else {
+        env.push_back({"WHATSMY_GPU_NO_CACHE", ""});
+        env.push_back({"XDG_CACHE_HOME", cache_home});
+    }
+    return env;
+}
+
+// Read `fd` to end of file into `text`
+inline void drain_fd(int fd, std::string& text) {
+    char buffer[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        text.append(buffer, static_cast<size_t>(n));
+    }
+}
+
+// `gpu <args>` with `env` set on top of this process's environment; an
+// empty value unsets the variable. `after`, if given, runs in the child
+// once plugin_run has returned, to look at what the run left behind.
+inline ChildRun run_plugin_child(const std::vector<std::string>& args, const ChildEnv& env = {},
+                                 void (*after)() = nullptr) {
+    ChildRun run;
+    int out_pipe[2], err_pipe[2];
+    if (::pipe(out_pipe) != 0 || ::pipe(err_pipe) != 0) {
+        return run;
+    }
+    // Whatever this process has buffered would otherwise go out twice
+    std::cout.flush();
+    std::fflush(nullptr);
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        ::dup2(out_pipe[1], STDOUT_FILENO);
+        ::dup2(err_pipe[1], STDERR_FILENO);
+        ::close(out_pipe[0]);
+        ::close(err_pipe[0]);
+        for (const auto& var : env) {
+            if (var.second.empty()) {
+                ::unsetenv(var.first);
+            } else {
+                ::setenv(var.first, var.second.c_str(), 1);
+            }
+        }
+        std::vector<std::string> storage = {"gpu"};
+        storage.insert(storage.end(), args.begin(), args.end());
+        std::vector<char*> argv;
+        for (auto& arg : storage) {
+            argv.push_back(&arg[0]);
+        }
+        argv.push_back(nullptr);
+        int status = plugin_run(static_cast<int>(storage.size()), argv.data());
+        if (after) {
+            after();
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        ::_exit(status);
+    }
+    ::close(out_pipe[1]);
+    ::close(err_pipe[1]);
+    // Small outputs only: stdout is drained first, so stderr must fit its pipe
+    drain_fd(out_pipe[0], run.out);
+    drain_fd(err_pipe[0], run.err);
+    ::close(out_pipe[0]);
+    ::close(err_pipe[0]);
+    int status = 0;
+    if (pid > 0 && ::waitpid(pid, &status, 0) == pid && WIFEXITED(status)) {
+        run.status = WEXITSTATUS(status);
+    }
+    return run;
+}
@@ -0,0 +1,170 @@
+// Probe deadline test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Wedges one attribute on a synthetic host and probes it under --deadline
+// and --attr-deadline. The attribute is proc/driver/nvidia/version made a
+// FIFO whose write end this process holds open and never writes, so a
+// read of it blocks until the test exits, as a wedged driver's would. The
+// run must still finish in time and exit 0 with that card's driver version
+// reading "unavailable (timeout)"; under --attr-deadline every other field
+// of every card must be reported. Once plugin_run has returned, the reader
+// that was written off may still be blocked, but the idle readers must
+// have been joined. A second host wedges a card's sysfs label instead:
+// the name falls back to the PCI tables without any placeholder, and the
+// inventory cache must still not be stored. Last, plugin_run is called
+// twice in one process: the plain second run must not inherit the first
+// one's deadline, output format or --stats.
+
+#include "plugin.cpp"
+
+#include "check.h"
+#include "plugin_child.h"
+#include "synthetic_host.h"
+
+namespace {
+
+size_t count(const std::string& text, const std::string& needle) {
+    size_t n = 0;
+    for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+// Runs in the child after plugin_run: the threads left in the process
+void report_threads() {
+    size_t threads = 0;
+    if (DIR* dir = ::opendir("/proc/self/task")) {
+        while (dirent* entry = ::readdir(dir)) {
+            threads += entry->d_name[0] != '.';
+        }
+        ::closedir(dir);
+    }
+    std::cerr << "threads " << threads << "\n";
+}
+
+// `gpu --json all` with `options`; checks what every deadline guarantees
+ChildRun run_wedged(const std::string& root, const std::vector<std::string>& options) {
+    std::vector<std::string> args = {"--json", "all"};
+    args.insert(args.end(), options.begin(), options.end());
+    auto start = std::chrono::steady_clock::now();
+    ChildRun run = run_plugin_child(args, isolated_env(root), report_threads);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%s: %lld ms\n", check_context().c_str(),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+
+    CHECK(run.status == 0);
+    CHECK(elapsed < std::chrono::seconds(5));
+    CHECK(contains(run.out, "{\"index\":0,") && contains(run.out, "{\"index\":1,") &&
+          contains(run.out, "{\"index\":2,"));
+    CHECK(contains(run.out, "\"node\":\"card0\",\"name\":\"NVIDIA GH100 [H100 SXM5 80GB]\",\"vendor\":\"NVIDIA\""));
+    CHECK(contains(run.out, "\"driver\":\"nvidia\",\"driver_version\":\"unavailable (timeout)\""));
+    // The main thread and the written-off reader; stop() joined the rest
+    CHECK(contains(run.err, "threads 2\n"));
+    return run;
+}
+
+void test_attribute_deadline(const std::string& root) {
+    // The per-attribute bound wins over a far overall deadline, so the
+    // wedge costs 50 ms and nothing else misses
+    check_context() = "--attr-deadline 50ms";
+    ChildRun run = run_wedged(root, {"--attr-deadline", "50ms", "--deadline", "10s"});
+    CHECK(count(run.out, kProbeTimeout) == 1);
+    CHECK(contains(run.out, "\"pci_id\":\"10DE:2330\""));
+    CHECK(contains(run.out, "\"name\":\"AMD Aldebaran/MI200 [Instinct MI250X/MI250]\""));
+    CHECK(contains(run.out, "\"driver\":\"amdgpu\",\"driver_version\":\"5D4C1B0F3E2A9876F01A2B3\",\"pci_id\":\"1002:740C\""));
+    CHECK(contains(run.out, "\"name\":\"Intel Arc A770\""));
+    CHECK(contains(run.out, "\"driver\":\"i915\",\"driver_version\":\"6.8.0-synthetic\",\"pci_id\":\"8086:56A0\""));
+}
+
+void test_overall_deadline(const std::string& root) {
+    // Alone, --deadline bounds each read by what is left of the command
+    // too: the wedge may use all of it, so later fields can miss as well
+    check_context() = "--deadline 200ms";
+    run_wedged(root, {"--deadline", "200ms"});
+}
+
+// Wedge `path` as a FIFO; returns the write end to hold open, or -1
+int wedge(const std::string& path) {
+    ::unlink(path.c_str());
+    if (::mkfifo(path.c_str(), 0644) != 0) {
+        return -1;
+    }
+    // Holding a write end open makes an empty FIFO block readers instead of
+    // returning end of file
+    return ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+}
+
+void test_wedged_label(const std::string& scratch) {
+    check_context() = "wedged label";
+    const std::string root = scratch + "/host";
+    SyntheticHostOptions options;
+    options.cards = 3;
+    build_synthetic_host(root, options);
+    int writer = wedge(root + "/sys/class/drm/card2/device/label");
+    CHECK(writer >= 0);
+
+    const std::string cache = scratch + "/cache/whatsmy/gpu-inventory.bin";
+    ChildRun run = run_plugin_child({"--json", "all", "--attr-deadline", "50ms"},
+                                    isolated_env(root, scratch + "/cache"));
+    CHECK(run.status == 0);
+    CHECK(!contains(run.out, kProbeTimeout));
+    CHECK(contains(run.out, "\"node\":\"card2\"") && !contains(run.out, "Intel Arc A770"));
+    CHECK(::access(cache.c_str(), F_OK) != 0);
+
+    ::close(writer);
+}
+
+// Runs in the child after a `--json --stats --deadline` run: a plain `all`
+// once the first run's overall deadline has passed
+void run_plain_again() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::string command = "gpu", mode = "all";
+    char* argv[] = {&command[0], &mode[0], nullptr};
+    const int status = plugin_run(2, argv);
+    std::cerr << "second run " << status << "\n";
+}
+
+void test_second_run(const std::string& scratch) {
+    check_context() = "second run";
+    const std::string root = scratch + "/clean";
+    SyntheticHostOptions options;
+    options.cards = 3;
+    build_synthetic_host(root, options);
+    ChildRun run = run_plugin_child({"--json", "--stats", "--deadline", "50ms", "all"}, isolated_env(root),
+                                    run_plain_again);
+    CHECK(run.status == 0);
+    CHECK(contains(run.err, "second run 0\n"));
+    CHECK(count(run.err, "stats: total") == 1);
+    const size_t first_end = run.out.find('\n');
+    CHECK(first_end != std::string::npos && run.out[0] == '{');
+    const std::string second = first_end == std::string::npos ? "" : run.out.substr(first_end + 1);
+    CHECK(contains(second, "Intel Arc A770") && second.find('{') == std::string::npos);
+    CHECK(!contains(second, kProbeTimeout));
+}
+
+} // namespace
+
+int main() {
+    const std::string root = make_scratch_dir("probe-deadline");
+    SyntheticHostOptions options;
+    options.cards = 3;
+    build_synthetic_host(root, options);
+
+    check_context() = "setup";
+    int writer = wedge(root + "/proc/driver/nvidia/version");
+    CHECK(writer >= 0);
+
+    test_attribute_deadline(root);
+    test_overall_deadline(root);
+
+    ::close(writer);
+    remove_tree(root);
+
+    const std::string scratch = make_scratch_dir("probe-deadline-label");
+    test_wedged_label(scratch);
+    test_second_run(scratch);
+    remove_tree(scratch);
+    return check_result("probe_deadline");
+}
@@ -0,0 +1,148 @@
+// Sampler/output handoff test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Holds the SPSC ring and SamplerThread to their contract: every record
+// the consumer gets is whole and newer than the last one, and every
+// record pushed is either delivered or counted in dropped(). Covered for
+// a ring overrun with no consumer, a producer and consumer racing on
+// threads, and a SamplerThread on a synthetic host drained as run_watch
+// does, keeping up and stalling.
+
+#include "plugin.cpp"
+
+#include "check.h"
+#include "synthetic_host.h"
+
+namespace {
+
+using Ring = SpscRing<TelemetrySample, SamplerThread::kRingRecords>;
+
+// Every value carries the tick, so a record copied while it was being
+// rewritten shows as mixed values
+void fill(TelemetrySample& sample, uint64_t tick) {
+    sample.tick = tick;
+    sample.count = kTelemetrySampleValues;
+    for (auto& value : sample.values) {
+        value = static_cast<int64_t>(tick);
+    }
+}
+
+bool whole(const TelemetrySample& sample) {
+    for (auto value : sample.values) {
+        if (value != static_cast<int64_t>(sample.tick)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_overrun() {
+    check_context() = "overrun";
+    std::unique_ptr<Ring> ring(new Ring());
+    TelemetrySample sample{};
+    const uint64_t kPushed = 3 * SamplerThread::kRingRecords + 5;
+    for (uint64_t tick = 0; tick < kPushed; ++tick) {
+        fill(sample, tick);
+        ring->push(sample);
+    }
+    // Drop-oldest: the newest kRingRecords survive, in order
+    uint64_t expected = kPushed - SamplerThread::kRingRecords, popped = 0;
+    while (ring->pop(sample)) {
+        CHECK(sample.tick == expected && whole(sample));
+        ++expected;
+        ++popped;
+    }
+    CHECK(popped == SamplerThread::kRingRecords);
+    CHECK(popped + ring->dropped() == kPushed);
+    CHECK(ring->pushed() == kPushed);
+}
+
+void test_race() {
+    check_context() = "race";
+    std::unique_ptr<Ring> ring(new Ring());
+    const uint64_t kPushed = 200000;
+    std::atomic<bool> done{false};
+    std::thread producer([&] {
+        TelemetrySample sample{};
+        for (uint64_t tick = 0; tick < kPushed; ++tick) {
+            fill(sample, tick);
+            ring->push(sample);
+        }
+        done = true;
+    });
+    TelemetrySample sample{};
+    uint64_t popped = 0, torn = 0, reordered = 0;
+    bool first = true;
+    uint64_t last = 0;
+    for (bool finished = false; !finished;) {
+        finished = done.load();
+        while (ring->pop(sample)) {
+            torn += !whole(sample);
+            reordered += !first && sample.tick <= last;
+            first = false;
+            last = sample.tick;
+            ++popped;
+        }
+    }
+    producer.join();
+    CHECK(torn == 0);
+    CHECK(reordered == 0);
+    CHECK(last == kPushed - 1);
+    CHECK(popped + ring->dropped() == kPushed);
+}
+
+// Run `ticks` ticks at 1 kHz and drain them as run_watch does, sleeping
+// `stall_ms` after each batch
+void test_sampler(TelemetrySampler& sampler, uint64_t ticks, int stall_ms) {
+    check_context() = "sampler, stall " + std::to_string(stall_ms) + " ms";
+    SamplerThread thread(sampler, nullptr, std::chrono::milliseconds(1), ticks);
+    CHECK(thread.start());
+    TelemetrySample sample{};
+    uint64_t delivered = 0, reordered = 0, last = 0, mismatched = 0;
+    bool done = false;
+    while (!done) {
+        pollfd pfd{thread.ready_fd(), POLLIN, 0};
+        ::poll(&pfd, 1, -1);
+        thread.acknowledge();
+        done = thread.finished();
+        while (thread.pop(sample)) {
+            reordered += delivered > 0 && sample.tick <= last;
+            mismatched += sample.count != std::min(sampler.reads().size(), kTelemetrySampleValues);
+            last = sample.tick;
+            ++delivered;
+        }
+        if (stall_ms > 0 && !done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(stall_ms));
+        }
+    }
+    thread.stop();
+    std::printf("stall %d ms: %llu delivered, %llu dropped\n", stall_ms, static_cast<unsigned long long>(delivered),
+                static_cast<unsigned long long>(thread.dropped()));
+    CHECK(reordered == 0 && mismatched == 0);
+    CHECK(last == ticks - 1);
+    CHECK(delivered + thread.dropped() == ticks);
+    // A stall spans more ticks than the ring holds
+    CHECK(stall_ms == 0 || thread.dropped() > 0);
+}
+
+} // namespace
+
+int main() {
+    test_overrun();
+    test_race();
+
+    const std::string root = make_scratch_dir("sampler-handoff");
+    SyntheticHostOptions options;
+    options.cards = 4;
+    build_synthetic_host(root, options);
+    std::vector<GPUInfo> gpus = detect_gpus_linux(posix_sysfs(), root, 1);
+    TelemetrySampler sampler(root);
+    sampler.discover(gpus);
+    check_context() = "discover";
+    CHECK(!sampler.reads().empty());
+    test_sampler(sampler, 200, 0);
+    test_sampler(sampler, 400, 150);
+    remove_tree(root);
+    return check_result("sampler_handoff");
+}
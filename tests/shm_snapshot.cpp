@@ -0,0 +1,149 @@
+// Shared-memory inventory test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// A writer thread republishes two inventories of different sizes as fast
+// as it can while the main thread reads snapshots; every snapshot that
+// read() accepts must equal one of the two field by field, so a torn read
+// the seqlock failed to catch shows up here. Also covers a segment before
+// its first publish, an inventory too large for the segment, and a
+// segment whose publisher has gone, cleanly or not.
+
+#include "plugin.cpp"
+
+#include "check.h"
+
+#include <sys/wait.h>
+
+namespace {
+
+std::vector<GPUInfo> make_inventory(int cards, const char* tag) {
+    std::vector<GPUInfo> gpus(cards);
+    for (int i = 0; i < cards; ++i) {
+        gpus[i].index = i;
+        gpus[i].is_active = i == 1;
+        gpus[i].name = std::string(tag) + " GPU " + std::to_string(i);
+        gpus[i].vendor = tag;
+        gpus[i].board = i % 2 ? std::string(tag) + " Board" : "";
+        gpus[i].driver = "nvidia";
+        gpus[i].driver_version = std::string(tag) + ".54.15";
+        gpus[i].pci_id = "10DE:2330";
+        gpus[i].node = "card" + std::to_string(i);
+    }
+    return gpus;
+}
+
+bool same(const std::vector<GPUInfo>& a, const std::vector<GPUInfo>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].index != b[i].index || a[i].is_active != b[i].is_active || a[i].name != b[i].name ||
+            a[i].vendor != b[i].vendor || a[i].board != b[i].board || a[i].driver != b[i].driver ||
+            a[i].driver_version != b[i].driver_version || a[i].pci_id != b[i].pci_id || a[i].node != b[i].node) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_concurrent(const std::string& name) {
+    const std::vector<GPUInfo> even = make_inventory(8, "Even");
+    const std::vector<GPUInfo> odd = make_inventory(9, "Oddly");
+    ShmInventoryPublisher publisher;
+    std::string error;
+    check_context() = "concurrent";
+    CHECK(publisher.create(name, error));
+
+    ShmInventoryReader reader;
+    std::vector<GPUInfo> gpus;
+    CHECK(reader.open(name));
+    CHECK(!reader.read(gpus));   // Nothing published yet
+    publisher.publish(even);
+    CHECK(reader.read(gpus) && same(gpus, even));
+
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> publishes{0};
+    std::thread writer([&] {
+        for (uint64_t n = 0; !done.load(std::memory_order_relaxed); ++n) {
+            publisher.publish(n & 1 ? odd : even);
+            publishes.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    int accepted = 0, torn = 0;
+    for (int i = 0; i < 50000; ++i) {
+        if (!reader.read(gpus)) {
+            continue;
+        }
+        ++accepted;
+        torn += !same(gpus, even) && !same(gpus, odd);
+    }
+    done = true;
+    writer.join();
+    std::printf("%d of 50000 reads accepted against %llu publishes\n", accepted,
+                static_cast<unsigned long long>(publishes.load()));
+    CHECK(torn == 0);
+    CHECK(accepted > 0);
+}
+
+void test_overflow(const std::string& name) {
+    ShmInventoryPublisher publisher;
+    ShmInventoryReader reader;
+    std::string error;
+    std::vector<GPUInfo> gpus;
+    check_context() = "overflow";
+    CHECK(publisher.create(name, error) && reader.open(name));
+    publisher.publish(make_inventory(kShmRecordCapacity + 1, "Many"));
+    CHECK(!reader.read(gpus));
+
+    // Names that do not fit the string pool are refused the same way
+    std::vector<GPUInfo> long_names = make_inventory(2, "Long");
+    long_names[1].name.assign(kShmStringsCapacity, 'x');
+    publisher.publish(long_names);
+    CHECK(!reader.read(gpus));
+
+    publisher.publish(make_inventory(3, "Few"));
+    CHECK(reader.read(gpus) && gpus.size() == 3);
+}
+
+void test_gone(const std::string& name) {
+    check_context() = "publisher gone";
+    {
+        ShmInventoryPublisher publisher;
+        std::string error;
+        CHECK(publisher.create(name, error));
+        publisher.publish(make_inventory(2, "Old"));
+    }
+    ShmInventoryReader reader;
+    CHECK(!reader.open(name));
+    
+    // Killed without cleaning up: the segment stays, its lock goes
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        ShmInventoryPublisher publisher;
+        std::string error;
+        if (publisher.create(name, error)) {
+            publisher.publish(make_inventory(2, "Old"));
+        }
+        ::_exit(0);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    CHECK(fd >= 0);
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    CHECK(!reader.open(name));
+    ::shm_unlink(name.c_str());
+}
+
+} // namespace
+
+int main() {
+    const std::string name = "/whatsmy-gpu-test-" + std::to_string(::getpid());
+    test_concurrent(name);
+    test_overflow(name);
+    test_gone(name);
+    return check_result("shm_snapshot");
+}
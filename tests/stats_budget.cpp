@@ -0,0 +1,177 @@
+// --stats budget test
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Loads the test build of the plugin, which counts its own allocations,
+// the way whatsmycli loads the shipped one, and runs it with --stats
+// against synthetic hosts of 1 and 16 cards, then holds the counters it
+// reports to budgets:
+//   - `all`: opens, reads, stats and heap allocations for each card
+//     beyond the first;
+//   - the default view, which populates only the active card: its I/O
+//     must not grow with the number of cards at all, apart from stats of
+//     each card for the inventory cache key when the cache is on.
+// Every run is a fresh child process, so the counters start from zero and
+// nothing is served from the daemon or a warm inventory cache.
+//
+// Usage: gpu_test_stats_budget <plugin.so>
+
+#include "check.h"
+#include "synthetic_host.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// Per-card budgets for `all`, measured as (cost of 16 cards - cost of 1) / 15.
+// A card costs about 4.8 opens, 1.5 reads, 0.1 stats and 1.1 allocations
+// today; raise a budget only with a reason in the commit.
+const double kOpensPerCard = 6;
+const double kReadsPerCard = 2;
+const double kStatsPerCard = 0.5;
+const double kAllocsPerCard = 2;
+
+struct Stats {
+    unsigned long long opens = 0, reads = 0, stats = 0, bytes = 0;
+    unsigned long long allocs = 0, alloc_bytes = 0, frees = 0;
+    bool parsed = false;
+};
+
+// Run `gpu <args> --stats` in a child against the host at `root`; the
+// "stats:" lines come back on a pipe from the child's stderr. The inventory
+// cache lives under `cache_home` if given, and is off otherwise.
+Stats run_plugin(const char* plugin, const std::string& root, const char* mode,
+                 const std::string& cache_home = "") {
+    int pipe_fds[2];
+    if (::pipe(pipe_fds) != 0) {
+        return Stats();
+    }
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        int null_fd = ::open("/dev/null", O_WRONLY);
+        ::dup2(null_fd, STDOUT_FILENO);
+        ::dup2(pipe_fds[1], STDERR_FILENO);
+        ::close(pipe_fds[0]);
+        ::setenv("WHATSMY_GPU_ROOT", root.c_str(), 1);
+        ::setenv("WHATSMY_GPU_NO_DAEMON", "1", 1);
+        if (cache_home.empty()) {
+            ::setenv("WHATSMY_GPU_NO_CACHE", "1", 1);
+        } else {
+            ::unsetenv("WHATSMY_GPU_NO_CACHE");
+            ::setenv("XDG_CACHE_HOME", cache_home.c_str(), 1);
+        }
+        ::unsetenv("WHATSMY_GPU_IO");
+        void* handle = ::dlopen(plugin, RTLD_NOW | RTLD_LOCAL);
+        auto run = handle ? reinterpret_cast<int (*)(int, char**)>(::dlsym(handle, "plugin_run")) : nullptr;
+        if (!run) {
+            std::fprintf(stderr, "cannot load %s: %s\n", plugin, ::dlerror());
+            ::_exit(127);
+        }
+        std::string command = "gpu", mode_arg = mode, stats = "--stats";
+        std::vector<char*> args = {&command[0]};
+        if (!mode_arg.empty()) {
+            args.push_back(&mode_arg[0]);
+        }
+        args.push_back(&stats[0]);
+        args.push_back(nullptr);
+        ::_exit(run(static_cast<int>(args.size()) - 1, args.data()));
+    }
+    ::close(pipe_fds[1]);
+    std::string output;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = ::read(pipe_fds[0], buffer, sizeof(buffer))) > 0) {
+        output.append(buffer, static_cast<size_t>(n));
+    }
+    ::close(pipe_fds[0]);
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+
+    Stats stats;
+    bool io = false, heap = false;
+    for (size_t pos = 0; pos < output.size();) {
+        size_t end = output.find('\n', pos);
+        std::string line = output.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        pos = end == std::string::npos ? output.size() : end + 1;
+        io |= std::sscanf(line.c_str(), "stats: total opens %llu reads %llu stats %llu bytes %llu", &stats.opens,
+                          &stats.reads, &stats.stats, &stats.bytes) == 4;
+        heap |= std::sscanf(line.c_str(), "stats: heap allocs %llu bytes %llu frees %llu", &stats.allocs,
+                            &stats.alloc_bytes, &stats.frees) == 3;
+    }
+    stats.parsed = io && heap && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (!stats.parsed) {
+        std::fprintf(stderr, "gpu %s --stats failed:\n%s", mode, output.c_str());
+    }
+    return stats;
+}
+
+double per_card(unsigned long long small, unsigned long long large, int extra_cards) {
+    return (double(large) - double(small)) / extra_cards;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <plugin.so>\n", argv[0]);
+        return 2;
+    }
+    const char* plugin = argv[1];
+    const int kCards = 16;
+    const std::string scratch = make_scratch_dir("stats-budget");
+    SyntheticHostOptions options;
+    options.cards = 1;
+    build_synthetic_host(scratch + "/one", options);
+    options.cards = kCards;
+    build_synthetic_host(scratch + "/many", options);
+
+    check_context() = "all";
+    Stats one = run_plugin(plugin, scratch + "/one", "all");
+    Stats many = run_plugin(plugin, scratch + "/many", "all");
+    CHECK(one.parsed && many.parsed);
+    const double opens = per_card(one.opens, many.opens, kCards - 1);
+    const double reads = per_card(one.reads, many.reads, kCards - 1);
+    const double stats = per_card(one.stats, many.stats, kCards - 1);
+    const double allocs = per_card(one.allocs, many.allocs, kCards - 1);
+    std::printf("all, per card: opens %.2f reads %.2f stats %.2f allocs %.2f\n", opens, reads, stats, allocs);
+    CHECK(opens <= kOpensPerCard);
+    CHECK(reads <= kReadsPerCard);
+    CHECK(stats <= kStatsPerCard);
+    CHECK(allocs <= kAllocsPerCard);
+    CHECK(many.reads > one.reads);   // The counters do see the probe
+
+    // Listing a larger /sys/class/drm may take one more getdents64
+    check_context() = "default view";
+    one = run_plugin(plugin, scratch + "/one", "");
+    many = run_plugin(plugin, scratch + "/many", "");
+    CHECK(one.parsed && many.parsed);
+    std::printf("default view, 1 vs %d cards: opens %llu/%llu reads %llu/%llu\n", kCards, one.opens, many.opens,
+                one.reads, many.reads);
+    CHECK(many.opens == one.opens);
+    CHECK(many.reads <= one.reads + 1);
+    CHECK(many.stats == one.stats);
+
+    // With the cache on and cold, the default view still probes the active
+    // card only, and leaves filling the cache to a full probe
+    check_context() = "default view, cache on";
+    one = run_plugin(plugin, scratch + "/one", "", scratch + "/cache-one");
+    many = run_plugin(plugin, scratch + "/many", "", scratch + "/cache-many");
+    CHECK(one.parsed && many.parsed);
+    std::printf("default view with cache, 1 vs %d cards: opens %llu/%llu reads %llu/%llu stats %llu/%llu\n", kCards,
+                one.opens, many.opens, one.reads, many.reads, one.stats, many.stats);
+    CHECK(many.opens == one.opens);
+    CHECK(many.reads <= one.reads + 1);
+    // The cache key stats each card node and its uevent
+    CHECK(many.stats == one.stats + 2 * (kCards - 1));
+    CHECK(::access((scratch + "/cache-many/whatsmy/gpu-inventory.bin").c_str(), F_OK) != 0);
+
+    remove_tree(scratch);
+    return check_result("stats_budget");
+}
@@ -0,0 +1,293 @@
+// Decoder for the GPU plugin's --format=cbor output
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Header-only and allocation-free: CborReader walks a buffer in place and
+// text comes back as string_views into it. Only what the plugin writes is
+// accepted (definite lengths, integers, text, true/false/null, tags); see
+// docs/cbor-schema.md for the records. Typical use:
+//
+//     using namespace whatsmy_gpu_cbor;
+//     CborReader reader(data, size);
+//     CborRecordHead head;
+//     while (read_record_head(reader, head)) {
+//         if (head.type == kGpuRecord) {
+//             CborGpu gpu;
+//             read_gpu(reader, head.fields, gpu);
+//         } else {
+//             skip_fields(reader, head.fields);
+//         }
+//     }
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace whatsmy_gpu_cbor {
+
+// Keys and record types, as in docs/cbor-schema.md
+enum Key : uint64_t {
+    kSchema, kType, kIndex, kActive, kNode, kName, kVendor, kBoard, kDriver, kDriverVersion, kPciId,
+    kGpus, kTick, kTime, kReadNs, kJitterNs, kJitterMeanNs, kJitterMaxNs, kCpu, kDropped, kValues,
+    kChannels, kGpu, kKind, kTotal, kSeries, kChannel, kWindows, kSeconds, kMin, kMean, kMax, kTimeMs,
+    kSocket, kShm, kGpuCount, kHotplug, kTemperatureC, kBusyPercent,
+};
+
+enum Record : uint64_t {
+    kGpuRecord = 1, kInventoryRecord, kChannelsRecord, kSampleRecord, kHistoryRecord, kChangeRecord,
+    kDaemonRecord, kPromptRecord,
+};
+
+constexpr uint64_t kSchemaVersion = 1;
+constexpr uint64_t kSelfDescribeTag = 55799;
+
+struct CborItem {
+    enum Type { Unsigned, Negative, Text, Array, Map, Tag, Bool, Null } type;
+    uint64_t argument;       // Value, length or tag number
+    std::string_view text;   // Text only
+
+    bool is_int() const { return type == Unsigned || type == Negative; }
+    int64_t as_int() const {
+        return type == Negative ? -1 - static_cast<int64_t>(argument) : static_cast<int64_t>(argument);
+    }
+};
+
+class CborReader {
+public:
+    CborReader(const void* data, size_t size)
+        : at_(static_cast<const uint8_t*>(data)), end_(at_ + size) {}
+
+    bool at_end() const { return at_ == end_; }
+
+    // One head, plus the bytes of a text string. False on malformed or
+    // unsupported input, after which the reader stays failed.
+    bool next(CborItem& item) {
+        if (failed_ || at_ == end_) {
+            return false;
+        }
+        const uint8_t major = *at_ >> 5;
+        const uint8_t info = *at_ & 31;
+        ++at_;
+        uint64_t argument = info;
+        if (info >= 24) {
+            if (info > 27) {
+                return fail();
+            }
+            const size_t width = size_t(1) << (info - 24);
+            if (static_cast<size_t>(end_ - at_) < width) {
+                return fail();
+            }
+            argument = 0;
+            for (size_t i = 0; i < width; ++i) {
+                argument = argument << 8 | *at_++;
+            }
+        }
+        item.argument = argument;
+        switch (major) {
+            case 0: item.type = CborItem::Unsigned; return true;
+            case 1: item.type = CborItem::Negative; return argument <= INT64_MAX || fail();
+            case 3:
+                if (static_cast<uint64_t>(end_ - at_) < argument) {
+                    return fail();
+                }
+                item.type = CborItem::Text;
+                item.text = std::string_view(reinterpret_cast<const char*>(at_), argument);
+                at_ += argument;
+                return true;
+            case 4: item.type = CborItem::Array; return true;
+            case 5: item.type = CborItem::Map; return true;
+            case 6: item.type = CborItem::Tag; return true;
+            case 7:
+                if (info == 20 || info == 21) {
+                    item.type = CborItem::Bool;
+                    item.argument = info == 21;
+                    return true;
+                }
+                if (info == 22) {
+                    item.type = CborItem::Null;
+                    return true;
+                }
+                return fail();
+            default:
+                return fail();   // Byte strings are never written
+        }
+    }
+
+    // Skip one whole item, nested containers included, without recursion
+    bool skip() {
+        uint64_t pending = 1;
+        CborItem item;
+        while (pending > 0) {
+            if (!next(item)) {
+                return false;
+            }
+            --pending;
+            if (item.type == CborItem::Array || item.type == CborItem::Tag) {
+                pending += item.type == CborItem::Tag ? 1 : item.argument;
+            } else if (item.type == CborItem::Map) {
+                pending += 2 * item.argument;
+            }
+        }
+        return true;
+    }
+
+    // Typed reads of one item; null reads as `missing`
+    bool read_int(int64_t& value, int64_t missing = INT64_MIN) {
+        CborItem item;
+        if (!next(item) || !(item.is_int() || item.type == CborItem::Null)) {
+            return fail();
+        }
+        value = item.type == CborItem::Null ? missing : item.as_int();
+        return true;
+    }
+
+    // Text, null as empty
+    bool read_text(std::string_view& text) {
+        CborItem item;
+        if (!next(item) || !(item.type == CborItem::Text || item.type == CborItem::Null)) {
+            return fail();
+        }
+        text = item.type == CborItem::Null ? std::string_view() : item.text;
+        return true;
+    }
+
+    bool read_bool(bool& value) {
+        CborItem item;
+        if (!next(item) || item.type != CborItem::Bool) {
+            return fail();
+        }
+        value = item.argument != 0;
+        return true;
+    }
+
+    // Head of an array or map: its item or pair count
+    bool read_container(CborItem::Type type, uint64_t& count) {
+        CborItem item;
+        if (!next(item) || item.type != type) {
+            return fail();
+        }
+        count = item.argument;
+        return true;
+    }
+
+    bool read_key(uint64_t& key) {
+        CborItem item;
+        if (!next(item) || item.type != CborItem::Unsigned) {
+            return fail();
+        }
+        key = item.argument;
+        return true;
+    }
+
+private:
+    bool fail() {
+        failed_ = true;
+        return false;
+    }
+
+    const uint8_t* at_;
+    const uint8_t* end_;
+    bool failed_ = false;
+};
+
+// Start of a record: the self-describe tag, the map head, schema and type.
+// `fields` counts the pairs still to read.
+struct CborRecordHead {
+    uint64_t schema;
+    uint64_t type;
+    uint64_t fields;
+};
+
+inline bool read_record_head(CborReader& reader, CborRecordHead& head) {
+    CborItem item;
+    uint64_t pairs, key;
+    if (!reader.next(item) || item.type != CborItem::Tag || item.argument != kSelfDescribeTag ||
+        !reader.read_container(CborItem::Map, pairs) || pairs < 2) {
+        return false;
+    }
+    int64_t schema, type;
+    if (!reader.read_key(key) || key != kSchema || !reader.read_int(schema) ||
+        !reader.read_key(key) || key != kType || !reader.read_int(type)) {
+        return false;
+    }
+    head.schema = static_cast<uint64_t>(schema);
+    head.type = static_cast<uint64_t>(type);
+    head.fields = pairs - 2;
+    return head.schema == kSchemaVersion;
+}
+
+// Skip the remaining pairs of a map
+inline bool skip_fields(CborReader& reader, uint64_t fields) {
+    uint64_t key;
+    for (uint64_t i = 0; i < fields; ++i) {
+        if (!reader.read_key(key) || !reader.skip()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A GPU map (a "gpu" record, or an entry of "gpus"); text views point into
+// the input and are empty when unknown
+struct CborGpu {
+    int64_t index = -1;
+    bool active = false;
+    std::string_view node, name, vendor, board, driver, driver_version, pci_id;
+};
+
+inline bool read_gpu(CborReader& reader, uint64_t fields, CborGpu& gpu) {
+    for (uint64_t i = 0; i < fields; ++i) {
+        uint64_t key;
+        if (!reader.read_key(key)) {
+            return false;
+        }
+        std::string_view* text = key == kNode ? &gpu.node : key == kName ? &gpu.name :
+                                 key == kVendor ? &gpu.vendor : key == kBoard ? &gpu.board :
+                                 key == kDriver ? &gpu.driver : key == kDriverVersion ? &gpu.driver_version :
+                                 key == kPciId ? &gpu.pci_id : nullptr;
+        bool ok = text ? reader.read_text(*text) :
+                  key == kIndex ? reader.read_int(gpu.index) :
+                  key == kActive ? reader.read_bool(gpu.active) : reader.skip();
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A "sample" record. `values` is left positioned on the value array
+// (`count` ints or nulls), to be read in place with read_int().
+struct CborSample {
+    int64_t tick = 0, time = 0, read_ns = 0, jitter_ns = 0, jitter_mean_ns = 0, jitter_max_ns = 0;
+    int64_t cpu = -1;       // Hundredths of a percent, -1 when not measured
+    int64_t dropped = 0;
+    uint64_t count = 0;
+};
+
+inline bool read_sample(CborReader& reader, uint64_t fields, CborSample& sample, CborReader& values) {
+    for (uint64_t i = 0; i < fields; ++i) {
+        uint64_t key;
+        if (!reader.read_key(key)) {
+            return false;
+        }
+        if (key == kValues) {
+            values = reader;
+            if (!values.read_container(CborItem::Array, sample.count) || !reader.skip()) {
+                return false;
+            }
+            continue;
+        }
+        int64_t* field = key == kTick ? &sample.tick : key == kTime ? &sample.time :
+                         key == kReadNs ? &sample.read_ns : key == kJitterNs ? &sample.jitter_ns :
+                         key == kJitterMeanNs ? &sample.jitter_mean_ns : key == kJitterMaxNs ? &sample.jitter_max_ns :
+                         key == kCpu ? &sample.cpu : key == kDropped ? &sample.dropped : nullptr;
+        if (!(field ? reader.read_int(*field, -1) : reader.skip())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace whatsmy_gpu_cbor
@@ -0,0 +1,265 @@
+// PCI name table generator for the GPU plugin
+// Copyright (C) 2025 enXov
+// License: GPLv3
+//
+// Reads a pci.ids-format file and writes a C++ include with:
+//   - a minimal perfect hash (hash-and-displace) over
+//     (vendor, device, subvendor, subdevice) keys, so a lookup is two
+//     hashes and one key compare with no allocation;
+//   - every distinct name, sorted and front-coded in blocks of
+//     PciTable::kBlockSize (each block starts with a full string, the rest
+//     store only the suffix after the prefix shared with their predecessor).
+//
+// Vendor entries use device/subvendor/subdevice 0xffff and device entries
+// use subvendor/subdevice 0xffff. 0xffff is never a valid PCI vendor ID, so
+// these keys cannot collide with real subsystem entries.
+//
+// Usage: pciids_gen <pci.ids> <output.inc>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint32_t kBlockSize = 16;
+const size_t kMaxNameLength = 255;
+
+// Keep in sync with the copy emitted into the generated file below
+uint64_t mix(uint64_t key, uint32_t seed) {
+    uint64_t x = key + 0x9e3779b97f4a7c15ull * (seed + 1ull);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+uint64_t make_key(uint32_t vendor, uint32_t device, uint32_t subvendor, uint32_t subdevice) {
+    return (uint64_t(vendor) << 48) | (uint64_t(device) << 32) | (uint64_t(subvendor) << 16) | subdevice;
+}
+
+bool parse_hex(const std::string& text, size_t pos, uint32_t& value) {
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    char* end = nullptr;
+    std::string digits = text.substr(pos, 4);
+    value = static_cast<uint32_t>(std::strtoul(digits.c_str(), &end, 16));
+    return end == digits.c_str() + 4;
+}
+
+// Name after the ID columns (separated by two spaces in pci.ids)
+std::string name_after(const std::string& line, size_t pos) {
+    size_t start = line.find_first_not_of(' ', pos);
+    return start == std::string::npos ? "" : line.substr(start);
+}
+
+void put_varint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+[[noreturn]] void fail(const std::string& message) {
+    std::cerr << "pciids_gen: " << message << "\n";
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fail("usage: pciids_gen <pci.ids> <output.inc>");
+    }
+    std::ifstream input(argv[1]);
+    if (!input) {
+        fail(std::string("cannot read ") + argv[1]);
+    }
+
+    // Parse vendor, device and subsystem lines; stop at the class section
+    std::map<uint64_t, std::string> entries;
+    uint32_t vendor = 0, device = 0;
+    bool have_vendor = false, have_device = false;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(input, line)) {
+        ++line_number;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line.compare(0, 2, "C ") == 0) {
+            break;
+        }
+
+        uint64_t key;
+        std::string name;
+        uint32_t subvendor, subdevice;
+        if (line.compare(0, 2, "\t\t") == 0) {
+            if (!have_device || !parse_hex(line, 2, subvendor) || !parse_hex(line, 7, subdevice)) {
+                fail("bad subsystem line " + std::to_string(line_number));
+            }
+            key = make_key(vendor, device, subvendor, subdevice);
+            name = name_after(line, 11);
+        } else if (line[0] == '\t') {
+            if (!have_vendor || !parse_hex(line, 1, device)) {
+                fail("bad device line " + std::to_string(line_number));
+            }
+            have_device = true;
+            key = make_key(vendor, device, 0xffff, 0xffff);
+            name = name_after(line, 5);
+        } else {
+            if (!parse_hex(line, 0, vendor)) {
+                fail("bad vendor line " + std::to_string(line_number));
+            }
+            have_vendor = true;
+            have_device = false;
+            key = make_key(vendor, 0xffff, 0xffff, 0xffff);
+            name = name_after(line, 4);
+        }
+        if (name.empty() || name.size() > kMaxNameLength) {
+            fail("missing or overlong name on line " + std::to_string(line_number));
+        }
+        if (!entries.emplace(key, name).second) {
+            fail("duplicate entry on line " + std::to_string(line_number));
+        }
+    }
+    if (entries.empty()) {
+        fail("no entries found");
+    }
+
+    // Sorted distinct names, front-coded in blocks
+    std::vector<std::string> names;
+    for (const auto& entry : entries) {
+        names.push_back(entry.second);
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    if (names.size() > 0xffff) {
+        fail("too many distinct names");
+    }
+
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> block_offsets;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (i % kBlockSize == 0) {
+            block_offsets.push_back(static_cast<uint32_t>(data.size()));
+            put_varint(data, static_cast<uint32_t>(names[i].size()));
+            data.insert(data.end(), names[i].begin(), names[i].end());
+            continue;
+        }
+        const std::string& prev = names[i - 1];
+        size_t shared = 0;
+        while (shared < prev.size() && shared < names[i].size() && prev[shared] == names[i][shared]) {
+            ++shared;
+        }
+        put_varint(data, static_cast<uint32_t>(shared));
+        put_varint(data, static_cast<uint32_t>(names[i].size() - shared));
+        data.insert(data.end(), names[i].begin() + shared, names[i].end());
+    }
+
+    // Hash and displace: place the biggest buckets first, searching for a
+    // seed that sends all of a bucket's keys to free slots
+    const uint32_t count = static_cast<uint32_t>(entries.size());
+    const uint32_t buckets = std::max<uint32_t>(1, count / 4);
+    std::vector<std::vector<uint64_t>> bucket_keys(buckets);
+    for (const auto& entry : entries) {
+        bucket_keys[mix(entry.first, 0) % buckets].push_back(entry.first);
+    }
+    std::vector<uint32_t> order(buckets);
+    for (uint32_t b = 0; b < buckets; ++b) {
+        order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return bucket_keys[a].size() > bucket_keys[b].size();
+    });
+
+    std::vector<uint16_t> seeds(buckets, 0);
+    std::vector<bool> taken(count, false);
+    std::vector<uint64_t> slot_keys(count, 0);
+    for (uint32_t b : order) {
+        if (bucket_keys[b].empty()) {
+            continue;
+        }
+        bool placed = false;
+        for (uint32_t seed = 1; seed <= 0xffff && !placed; ++seed) {
+            std::vector<uint32_t> slots;
+            for (uint64_t key : bucket_keys[b]) {
+                uint32_t slot = static_cast<uint32_t>(mix(key, seed) % count);
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (slots.size() != bucket_keys[b].size()) {
+                continue;
+            }
+            for (size_t k = 0; k < slots.size(); ++k) {
+                taken[slots[k]] = true;
+                slot_keys[slots[k]] = bucket_keys[b][k];
+            }
+            seeds[b] = static_cast<uint16_t>(seed);
+            placed = true;
+        }
+        if (!placed) {
+            fail("no perfect hash seed found");
+        }
+    }
+
+    std::ofstream out(argv[2], std::ios::trunc);
+    if (!out) {
+        fail(std::string("cannot write ") + argv[2]);
+    }
+    std::string source = argv[1];
+    source = source.substr(source.find_last_of('/') + 1);
+    out << "// Generated by tools/pciids_gen.cpp from " << source << "\n"
+        << "// Do not edit: " << count << " entries, " << names.size() << " names, "
+        << data.size() << " bytes of front-coded name data\n\n"
+        << "namespace PciTable {\n"
+        << "    constexpr uint32_t kCount = " << count << ";\n"
+        << "    constexpr uint32_t kBuckets = " << buckets << ";\n"
+        << "    constexpr uint32_t kNames = " << names.size() << ";\n"
+        << "    constexpr uint32_t kBlockSize = " << kBlockSize << ";\n\n"
+        << "    constexpr uint64_t mix(uint64_t key, uint32_t seed) {\n"
+        << "        uint64_t x = key + 0x9e3779b97f4a7c15ull * (seed + 1ull);\n"
+        << "        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;\n"
+        << "        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;\n"
+        << "        return x ^ (x >> 31);\n"
+        << "    }\n";
+
+    auto emit = [&](const char* decl, size_t size, auto value, int per_line) {
+        out << "\n    " << decl << "[" << size << "] = {";
+        for (size_t i = 0; i < size; ++i) {
+            out << (i % per_line == 0 ? "\n        " : " ") << value(i) << ",";
+        }
+        out << "\n    };\n";
+    };
+    emit("constexpr uint16_t kSeeds", buckets, [&](size_t i) { return std::to_string(seeds[i]); }, 16);
+    emit("constexpr uint64_t kKeys", count, [&](size_t i) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "0x%016llxull", static_cast<unsigned long long>(slot_keys[i]));
+        return std::string(buffer);
+    }, 4);
+    emit("constexpr uint16_t kNameIds", count, [&](size_t i) {
+        size_t id = std::lower_bound(names.begin(), names.end(), entries[slot_keys[i]]) - names.begin();
+        return std::to_string(id);
+    }, 16);
+    emit("constexpr uint32_t kBlockOffsets", block_offsets.size(),
+         [&](size_t i) { return std::to_string(block_offsets[i]); }, 12);
+    emit("constexpr unsigned char kNameData", data.size(), [&](size_t i) {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "0x%02x", data[i]);
+        return std::string(buffer);
+    }, 16);
+    out << "}\n";
+    return 0;
+}